@@ -0,0 +1,274 @@
+#ifndef SIK_UDP_ADDRESS_MAP_H
+#define SIK_UDP_ADDRESS_MAP_H
+
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <netinet/in.h>
+
+namespace sik {
+    /// Packed IPv4 address and port - 48 significant bits.
+    using address_t = uint64_t;
+
+    /**
+     * Packs IPv4 address and port into a single integer. Both parts are kept
+     * in network byte order.
+     * @param address socket address.
+     * @return packed address.
+     */
+    inline address_t pack_address(const sockaddr_in &address) noexcept {
+        return ((address_t) address.sin_addr.s_addr << 16u)
+               | (address_t) address.sin_port;
+    }
+
+    /**
+     * Converts packed address back to socket address.
+     * @param packed packed address.
+     * @return socket address.
+     */
+    inline sockaddr_in unpack_address(address_t packed) noexcept {
+        sockaddr_in address = sockaddr_in();
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = (in_addr_t) (packed >> 16u);
+        address.sin_port = (in_port_t) (packed & 0xffffu);
+        return address;
+    }
+
+    /**
+     * Flat open addressing hash map from packed addresses to values, using
+     * Robin Hood linear probing with backward shift deletion. All entries
+     * live in a single array, so lookups touch one or two cache lines.
+     * @tparam V type of value.
+     */
+    template<typename V>
+    class AddressMap {
+    private:
+        /// Key marking an empty bucket, never a valid packed address.
+        static const address_t EMPTY = ~(address_t) 0;
+        /// Minimal number of buckets.
+        static const std::size_t MIN_CAPACITY = 16u;
+
+        struct Bucket {
+            /// Packed address or EMPTY.
+            address_t key = EMPTY;
+            /// Mapped value.
+            V value = V();
+        };
+
+        /// Buckets, size is always a power of two.
+        std::vector<Bucket> buckets;
+        /// Number of stored entries.
+        std::size_t length = 0u;
+        /// Bucket index mask.
+        std::size_t mask = 0u;
+
+        /**
+         * Mixes key bits, so consecutive ports and addresses spread evenly.
+         * @param key packed address.
+         * @return hash.
+         */
+        static inline uint64_t hash(address_t key) noexcept {
+            key ^= key >> 33u;
+            key *= 0xff51afd7ed558ccdull;
+            key ^= key >> 33u;
+            key *= 0xc4ceb9fe1a85ec53ull;
+            key ^= key >> 33u;
+            return key;
+        }
+
+        /**
+         * @param key packed address.
+         * @return bucket the key wants to occupy.
+         */
+        inline std::size_t home(address_t key) const noexcept {
+            return (std::size_t) hash(key) & mask;
+        }
+
+        /**
+         * @param index bucket index.
+         * @return distance of the bucket entry from its home bucket.
+         */
+        inline std::size_t distance(std::size_t index) const noexcept {
+            return (index - home(buckets[index].key)) & mask;
+        }
+
+        /**
+         * Finds bucket holding the key.
+         * @param key packed address.
+         * @return bucket index or buckets.size() if key is missing.
+         */
+        std::size_t find_index(address_t key) const noexcept {
+            if (length == 0) {
+                return buckets.size();
+            }
+            std::size_t index = home(key);
+            for (std::size_t dist = 0u;; dist++) {
+                const Bucket &bucket = buckets[index];
+                if (bucket.key == key) {
+                    return index;
+                }
+                if (bucket.key == EMPTY || distance(index) < dist) {
+                    return buckets.size();
+                }
+                index = (index + 1) & mask;
+            }
+        }
+
+        /**
+         * Places entry known to be missing from the map.
+         * @param key packed address.
+         * @param value mapped value.
+         * @return bucket index where the key was placed.
+         */
+        std::size_t place(address_t key, V value) noexcept {
+            std::size_t index = home(key);
+            std::size_t placed = buckets.size();
+            for (std::size_t dist = 0u;; dist++) {
+                Bucket &bucket = buckets[index];
+                if (bucket.key == EMPTY) {
+                    bucket.key = key;
+                    bucket.value = std::move(value);
+                    length++;
+                    return placed == buckets.size() ? index : placed;
+                }
+                std::size_t existing = distance(index);
+                if (existing < dist) {
+                    // Take from the rich, continue with the evicted entry.
+                    std::swap(key, bucket.key);
+                    std::swap(value, bucket.value);
+                    if (placed == buckets.size()) {
+                        placed = index;
+                    }
+                    dist = existing;
+                }
+                index = (index + 1) & mask;
+            }
+        }
+
+        /**
+         * Rebuilds the table with given number of buckets.
+         * @param capacity new number of buckets, power of two.
+         */
+        void rehash(std::size_t capacity) {
+            std::vector<Bucket> old(capacity);
+            std::swap(old, buckets);
+            mask = capacity - 1;
+            length = 0u;
+            for (Bucket &bucket: old) {
+                if (bucket.key != EMPTY) {
+                    place(bucket.key, std::move(bucket.value));
+                }
+            }
+        }
+
+    public:
+        AddressMap() {
+            rehash(MIN_CAPACITY);
+        }
+
+        /**
+         * Prepares map to hold given number of entries without rehashing.
+         * @param count number of entries.
+         */
+        void reserve(std::size_t count) {
+            std::size_t capacity = buckets.size();
+            while (count > capacity / 8u * 7u) {
+                capacity *= 2u;
+            }
+            if (capacity != buckets.size()) {
+                rehash(capacity);
+            }
+        }
+
+        /**
+         * Finds value stored for the key.
+         * @param key packed address.
+         * @return pointer to value or nullptr if key is missing.
+         */
+        V *find(address_t key) noexcept {
+            std::size_t index = find_index(key);
+            return index == buckets.size() ? nullptr : &buckets[index].value;
+        }
+
+        /**
+         * Finds value stored for the key.
+         * @param key packed address.
+         * @return pointer to value or nullptr if key is missing.
+         */
+        const V *find(address_t key) const noexcept {
+            std::size_t index = find_index(key);
+            return index == buckets.size() ? nullptr : &buckets[index].value;
+        }
+
+        /**
+         * Inserts value if the key is missing.
+         * @param key packed address.
+         * @param value value to insert.
+         * @return pointer to value stored for the key and whether it was
+         * inserted.
+         */
+        std::pair<V *, bool> insert(address_t key, V value) {
+            std::size_t index = find_index(key);
+            if (index != buckets.size()) {
+                return std::make_pair(&buckets[index].value, false);
+            }
+            reserve(length + 1);
+            index = place(key, std::move(value));
+            return std::make_pair(&buckets[index].value, true);
+        }
+
+        /**
+         * Removes the key from the map.
+         * @param key packed address.
+         * @return whether the key was removed.
+         */
+        bool erase(address_t key) noexcept {
+            std::size_t index = find_index(key);
+            if (index == buckets.size()) {
+                return false;
+            }
+            // Shift following entries back, so no tombstones are needed.
+            std::size_t next = (index + 1) & mask;
+            while (buckets[next].key != EMPTY && distance(next) > 0) {
+                buckets[index] = std::move(buckets[next]);
+                index = next;
+                next = (next + 1) & mask;
+            }
+            buckets[index] = Bucket();
+            length--;
+            return true;
+        }
+
+        /**
+         * Calls function for every entry, in no particular order.
+         * @param f function called with key and value.
+         */
+        template<typename F>
+        void visit(F &&f) const {
+            for (const Bucket &bucket: buckets) {
+                if (bucket.key != EMPTY) {
+                    f(bucket.key, bucket.value);
+                }
+            }
+        }
+
+        /**
+         * @return number of entries.
+         */
+        std::size_t size() const noexcept {
+            return length;
+        }
+
+        /**
+         * @return number of buckets.
+         */
+        std::size_t capacity() const noexcept {
+            return buckets.size();
+        }
+    };
+}
+
+#endif //SIK_UDP_ADDRESS_MAP_H
@@ -0,0 +1,317 @@
+#ifndef SIK_UDP_ARENA_H
+#define SIK_UDP_ARENA_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace sik {
+    /// Size of the first block of a MonotonicArena.
+    const std::size_t ARENA_BLOCK_SIZE = 128u * 1024u;
+
+    /**
+     * Bump allocator for data living no longer than a single server loop
+     * iteration. Memory is never freed one allocation at a time, reset()
+     * makes the whole arena available again. Blocks are kept after reset, so
+     * once the arena grew to the iteration's needs it no longer allocates.
+     */
+    class MonotonicArena {
+    private:
+        /// Memory blocks, filled in order.
+        std::vector<std::unique_ptr<char[]>> blocks;
+        /// Sizes of the blocks.
+        std::vector<std::size_t> sizes;
+        /// Index of the block being filled.
+        std::size_t current = 0u;
+        /// Bytes used in the block being filled.
+        std::size_t used = 0u;
+
+        /**
+         * Moves to the next block big enough for the allocation, allocating
+         * it if needed.
+         * @param bytes number of bytes needed.
+         * @param alignment alignment of the allocation.
+         */
+        void next_block(std::size_t bytes, std::size_t alignment) {
+            std::size_t needed = bytes + alignment;
+            while (++current < blocks.size()) {
+                if (sizes[current] >= needed) {
+                    used = 0u;
+                    return;
+                }
+            }
+            std::size_t size = sizes.empty() ? ARENA_BLOCK_SIZE
+                                             : sizes.back() * 2u;
+            while (size < needed) {
+                size *= 2u;
+            }
+            blocks.emplace_back(new char[size]);
+            sizes.push_back(size);
+            current = blocks.size() - 1u;
+            used = 0u;
+        }
+
+    public:
+        /**
+         * Constructs arena with a single block.
+         * @param capacity size of the first block.
+         */
+        explicit MonotonicArena(std::size_t capacity = ARENA_BLOCK_SIZE) {
+            blocks.emplace_back(new char[capacity]);
+            sizes.push_back(capacity);
+        }
+
+        MonotonicArena(const MonotonicArena &) = delete;
+
+        MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+        /**
+         * Allocates memory valid until the next reset.
+         * @param bytes number of bytes.
+         * @param alignment alignment, power of two.
+         * @return allocated memory.
+         */
+        void *allocate(std::size_t bytes,
+                       std::size_t alignment = alignof(std::max_align_t)) {
+            for (;;) {
+                uintptr_t base = (uintptr_t) blocks[current].get();
+                uintptr_t start = (base + used + alignment - 1u)
+                                  & ~(uintptr_t) (alignment - 1u);
+                if (start + bytes <= base + sizes[current]) {
+                    used = start + bytes - base;
+                    return (void *) start;
+                }
+                next_block(bytes, alignment);
+            }
+        }
+
+        /**
+         * Makes all memory available again. Pointers returned by allocate
+         * become invalid.
+         */
+        void reset() noexcept {
+            current = 0u;
+            used = 0u;
+        }
+
+        /**
+         * @return total size of the blocks.
+         */
+        std::size_t capacity() const noexcept {
+            std::size_t result = 0u;
+            for (std::size_t size: sizes) {
+                result += size;
+            }
+            return result;
+        }
+    };
+
+    /**
+     * Pool of equally sized memory chunks kept on a free list. Chunks are
+     * carved from blocks which are never returned to the system, so objects
+     * created and destroyed at a steady rate stop allocating once the pool
+     * holds the peak number of them.
+     * @tparam chunk_size size of a chunk.
+     * @tparam chunk_alignment alignment of a chunk.
+     * @tparam chunks_per_block number of chunks allocated at once.
+     */
+    template<std::size_t chunk_size, std::size_t chunk_alignment,
+            std::size_t chunks_per_block = 256u>
+    class ObjectPool {
+        static_assert(chunks_per_block > 0, "Block must hold a chunk");
+    private:
+        union Chunk {
+            /// Next free chunk.
+            Chunk *next;
+            /// Chunk memory.
+            alignas(chunk_alignment) unsigned char storage[chunk_size];
+        };
+
+        /// Memory blocks.
+        std::vector<std::unique_ptr<Chunk[]>> blocks;
+        /// First free chunk.
+        Chunk *free = nullptr;
+        /// Number of chunks in use.
+        std::size_t used = 0u;
+
+    public:
+        ObjectPool() = default;
+
+        ObjectPool(const ObjectPool &) = delete;
+
+        ObjectPool &operator=(const ObjectPool &) = delete;
+
+        /**
+         * @return memory for a single object.
+         * @throws std::bad_alloc when a new block cannot be allocated.
+         */
+        void *allocate() {
+            if (free == nullptr) {
+                Chunk *block = new Chunk[chunks_per_block];
+                blocks.emplace_back(block);
+                for (std::size_t i = chunks_per_block; i-- > 0;) {
+                    block[i].next = free;
+                    free = &block[i];
+                }
+            }
+            Chunk *chunk = free;
+            free = chunk->next;
+            used++;
+            return chunk;
+        }
+
+        /**
+         * Returns chunk to the pool.
+         * @param pointer memory returned by allocate.
+         */
+        void deallocate(void *pointer) noexcept {
+            Chunk *chunk = (Chunk *) pointer;
+            chunk->next = free;
+            free = chunk;
+            used--;
+        }
+
+        /**
+         * @return number of chunks in use.
+         */
+        std::size_t size() const noexcept {
+            return used;
+        }
+
+        /**
+         * @return number of chunks allocated from the system.
+         */
+        std::size_t capacity() const noexcept {
+            return blocks.size() * chunks_per_block;
+        }
+    };
+
+    /**
+     * Standard allocator taking memory for single objects from a pool of
+     * the type, for objects allocated one at a time, like control blocks of
+     * shared pointers. Arrays are allocated as usual.
+     * @tparam T type of allocated objects.
+     */
+    template<typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+
+        PoolAllocator() noexcept = default;
+
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+        /**
+         * @return pool objects of the type are allocated from.
+         */
+        static ObjectPool<sizeof(T), alignof(T)> &pool() {
+            // Never destroyed, objects may outlive static objects at exit.
+            static auto *pool = new ObjectPool<sizeof(T), alignof(T)>();
+            return *pool;
+        }
+
+        T *allocate(std::size_t count) {
+            if (count != 1u) {
+                return (T *) ::operator new(count * sizeof(T));
+            }
+            return (T *) pool().allocate();
+        }
+
+        void deallocate(T *pointer, std::size_t count) noexcept {
+            if (count != 1u) {
+                ::operator delete(pointer);
+                return;
+            }
+            pool().deallocate(pointer);
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U> &) const noexcept {
+            return true;
+        }
+
+        template<typename U>
+        bool operator!=(const PoolAllocator<U> &) const noexcept {
+            return false;
+        }
+    };
+
+    /**
+     * Strings kept with their memory once released, so buffers of similar
+     * length are filled again instead of allocated. Strings beyond the limits
+     * are freed.
+     */
+    class StringPool {
+    private:
+        /// Released strings, the latest last.
+        std::vector<std::string *> free;
+        /// Maximum number of kept strings.
+        std::size_t max_strings;
+        /// Maximum total capacity of kept strings.
+        std::size_t max_bytes;
+        /// Total capacity of kept strings.
+        std::size_t bytes = 0u;
+
+    public:
+        /**
+         * @param max_strings maximum number of kept strings.
+         * @param max_bytes maximum total capacity of kept strings.
+         */
+        StringPool(std::size_t max_strings, std::size_t max_bytes)
+                : max_strings(max_strings), max_bytes(max_bytes) {
+            free.reserve(max_strings);
+        }
+
+        StringPool(const StringPool &) = delete;
+
+        StringPool &operator=(const StringPool &) = delete;
+
+        ~StringPool() {
+            for (std::string *string: free) {
+                delete string;
+            }
+        }
+
+        /**
+         * @return empty string, with memory of the last released one if any.
+         */
+        std::string *acquire() {
+            if (free.empty()) {
+                return new std::string();
+            }
+            std::string *string = free.back();
+            free.pop_back();
+            bytes -= string->capacity();
+            return string;
+        }
+
+        /**
+         * Keeps string for reuse or frees it.
+         * @param string string returned by acquire or created with new.
+         */
+        void release(std::string *string) noexcept {
+            if (free.size() >= max_strings
+                || bytes + string->capacity() > max_bytes) {
+                delete string;
+                return;
+            }
+            string->clear();
+            bytes += string->capacity();
+            free.push_back(string);
+        }
+
+        /**
+         * @return number of kept strings.
+         */
+        std::size_t size() const noexcept {
+            return free.size();
+        }
+    };
+}
+
+#endif //SIK_UDP_ARENA_H
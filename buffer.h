@@ -4,11 +4,78 @@
 
 #include <memory>
 #include <array>
+#include <limits>
+#include <stdexcept>
+
+#include "memory.h"
+
+/// Buffer size meaning that the capacity is chosen at runtime.
+const std::size_t DYNAMIC_BUFFER_SIZE = std::numeric_limits<std::size_t>::max();
+
+/**
+ * Storage of buffer elements with capacity known at compile time.
+ * @tparam T type of element.
+ * @tparam buffer_size number of elements.
+ */
+template<typename T, std::size_t buffer_size>
+class BufferStorage {
+private:
+    /// Elements.
+    std::array<T, buffer_size> data;
+public:
+    /**
+     * Constructs storage.
+     * @param capacity number of elements, must be equal to buffer_size.
+     * @throws std::invalid_argument when capacity differs from buffer_size.
+     */
+    explicit BufferStorage(std::size_t capacity = buffer_size) {
+        if (capacity != buffer_size) {
+            throw std::invalid_argument("Capacity must match buffer_size");
+        }
+    }
+
+    T &operator[](std::size_t index) noexcept {
+        return data[index];
+    }
+
+    constexpr std::size_t capacity() const noexcept {
+        return buffer_size;
+    }
+};
+
+/**
+ * Storage of buffer elements with capacity chosen at runtime, allocated from
+ * huge pages, so large buffers do not thrash the TLB.
+ * @tparam T type of element.
+ */
+template<typename T>
+class BufferStorage<T, DYNAMIC_BUFFER_SIZE> {
+private:
+    /// Elements.
+    sik::HugePageArray<T> data;
+public:
+    /**
+     * Constructs storage.
+     * @param capacity number of elements.
+     * @throws std::invalid_argument when capacity is zero.
+     * @throws std::bad_alloc when memory cannot be allocated.
+     */
+    explicit BufferStorage(std::size_t capacity) : data(capacity) {}
+
+    T &operator[](std::size_t index) noexcept {
+        return data[index];
+    }
+
+    std::size_t capacity() const noexcept {
+        return data.size();
+    }
+};
 
 /**
  * Cyclic buffer with specified size.
  * @tparam T type of element.
- * @tparam buffer_size maximum buffer size.
+ * @tparam buffer_size maximum buffer size or DYNAMIC_BUFFER_SIZE if the size
+ * is passed to the constructor.
  */
 template<typename T, std::size_t buffer_size>
 class Buffer {
@@ -16,7 +83,7 @@ class Buffer {
                   "Buffer buffer_size must be greater than zero");
 private:
     /// Elements in the buffer.
-    std::array<T, buffer_size> data;
+    BufferStorage<T, buffer_size> data;
     /// Starting index.
     std::size_t start = 0u;
     /// Number of items in the buffer.
@@ -26,22 +93,33 @@ private:
      * Increases the starting index by one.
      */
     void increase_index() noexcept {
-        start = (start + 1) % buffer_size;
+        start = get_index(1);
     }
 
     /**
      * Returns the mapping of abstract buffer index to the actual index in the
      * data array.
-     * @param index index in the buffer.
+     * @param index index in the buffer, must not exceed capacity.
      * @return index in the data array.
      */
     inline std::size_t get_index(std::size_t index) const noexcept {
-        return (start + index) % buffer_size;
+        // Both start and index are at most capacity, so a single subtraction
+        // replaces the division, which is not free for runtime capacity.
+        std::size_t i = start + index;
+        return i >= data.capacity() ? i - data.capacity() : i;
     }
 
 public:
     Buffer() = default;
 
+    /**
+     * Constructs buffer with given capacity.
+     * @param capacity maximum buffer size.
+     * @throws std::invalid_argument when capacity is not valid.
+     * @throws std::bad_alloc when memory cannot be allocated.
+     */
+    explicit Buffer(std::size_t capacity) : data(capacity) {}
+
     Buffer(const Buffer &) = delete;
 
     /**
@@ -63,13 +141,20 @@ public:
         return length;
     }
 
+    /**
+     * @return maximum number of elements in the buffer.
+     */
+    std::size_t capacity() const noexcept {
+        return data.capacity();
+    }
+
     /**
      * Inserts new item at the end of the buffer.
      * If the buffer is full removes the first item.
      * @param item item to insert.
      */
     void push(T item) noexcept {
-        if (length == buffer_size) {
+        if (length == data.capacity()) {
             increase_index();
         } else {
             length++;
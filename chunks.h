@@ -0,0 +1,247 @@
+#ifndef SIK_UDP_CHUNKS_H
+#define SIK_UDP_CHUNKS_H
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+#include "protocol.h"
+
+namespace sik {
+    /// Chunk size meaning messages are never split.
+    const std::size_t NO_CHUNKS = 0u;
+    /// Smallest chunk size: UDP payload every IPv4 path carries without
+    /// fragmentation, 576 bytes of a minimal datagram without headers.
+    const std::size_t MIN_CHUNK_SIZE = 548u;
+    /// Number of messages reassembled at the same time by default.
+    const std::size_t REASSEMBLY_SLOTS = 16u;
+
+    /**
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @return whether datagram is a chunk of a long message.
+     */
+    inline bool is_chunk(const char *bytes, std::size_t length) noexcept {
+        return length > 0u && bytes[0] == CHUNK_MARKER;
+    }
+
+    /**
+     * @param length message length.
+     * @param count number of chunks.
+     * @return number of message bytes in every chunk but the last one.
+     */
+    inline std::size_t chunk_payload(std::size_t length,
+                                     std::size_t count) noexcept {
+        return (length + count - 1u) / count;
+    }
+
+    /**
+     * Splits message into chunks of at most chunk_size bytes, for clients
+     * which announced FEATURE_CHUNKS:
+     * - 1 byte CHUNK_MARKER
+     * - 4 bytes as message identifier (uint32_t in big endian)
+     * - 2 bytes as chunk index (uint16_t in big endian)
+     * - 2 bytes as number of chunks (uint16_t in big endian)
+     * - 4 bytes as message length (uint32_t in big endian)
+     * - bytes of the message, equally many in every chunk but the last one
+     * @param datagram message exactly as it would be sent alone.
+     * @param id message identifier, distinct for messages sent one after
+     * another.
+     * @param chunk_size maximum chunk length, at least MIN_CHUNK_SIZE.
+     * @return chunks, in order.
+     * @throws std::length_error when message is longer than
+     * MAX_MESSAGE_LENGTH or chunks are too small.
+     */
+    inline std::vector<Datagram> split_into_chunks(const Datagram &datagram,
+                                                   uint32_t id,
+                                                   std::size_t chunk_size) {
+        std::size_t length = datagram.length();
+        if (length == 0u || length > MAX_MESSAGE_LENGTH
+            || chunk_size <= CHUNK_HEADER_SIZE) {
+            throw std::length_error("Message cannot be split into chunks");
+        }
+        std::size_t count = chunk_payload(length,
+                                          chunk_size - CHUNK_HEADER_SIZE);
+        if (count > UINT16_MAX) {
+            throw std::length_error("Message cannot be split into chunks");
+        }
+        std::size_t payload = chunk_payload(length, count);
+
+        std::vector<Datagram> chunks;
+        chunks.reserve(count);
+        for (std::size_t index = 0u, begin = 0u; begin < length;
+             index++, begin += payload) {
+            std::size_t part = std::min(payload, length - begin);
+            std::string bytes(CHUNK_HEADER_SIZE + part, '\0');
+            ChunkSchema::encode(&bytes[0], CHUNK_MARKER, id, (uint16_t) index,
+                                (uint16_t) count, (uint32_t) length);
+            std::memcpy(&bytes[CHUNK_HEADER_SIZE], datagram.data() + begin,
+                        part);
+            chunks.emplace_back(std::move(bytes));
+        }
+        return chunks;
+    }
+
+    /**
+     * Reassembles messages split into chunks. At most capacity messages are
+     * reassembled at the same time, a chunk of yet another message evicts
+     * the one which waited longest for a chunk, so lost chunks do not hold
+     * memory forever.
+     */
+    class ChunkAssembler {
+    private:
+        /**
+         * Message being reassembled.
+         */
+        struct Reassembly {
+            /// Whether slot holds a message.
+            bool active = false;
+            /// Message identifier.
+            uint32_t id = 0u;
+            /// Number of chunks.
+            uint16_t count = 0u;
+            /// Number of chunks received.
+            uint16_t received = 0u;
+            /// Whether chunk of every index was received.
+            std::vector<bool> arrived;
+            /// Message bytes.
+            std::string bytes;
+            /// Time of the last chunk, in chunks received by the assembler.
+            uint64_t used = 0u;
+        };
+
+        /// Messages being reassembled.
+        std::vector<Reassembly> slots;
+        /// Number of chunks received.
+        uint64_t clock = 0u;
+        /// Last message reassembled.
+        std::string completed;
+        /// Number of messages evicted before all their chunks came.
+        uint64_t dropped = 0u;
+
+        /**
+         * Finds slot of the message, taking a free or the least recently
+         * used one for a new message.
+         * @param id message identifier.
+         * @param count number of chunks.
+         * @param length message length.
+         * @return slot of the message.
+         * @throws std::invalid_argument when chunk disagrees with chunks of
+         * the message received before.
+         */
+        Reassembly &find(uint32_t id, uint16_t count, std::size_t length) {
+            Reassembly *victim = &slots[0];
+            for (Reassembly &slot: slots) {
+                if (slot.active && slot.id == id) {
+                    if (slot.count != count || slot.bytes.length() != length) {
+                        throw std::invalid_argument("Inconsistent chunk");
+                    }
+                    return slot;
+                }
+                if (victim->active
+                    && (!slot.active || slot.used < victim->used)) {
+                    victim = &slot;
+                }
+            }
+            if (victim->active) {
+                dropped++;
+            }
+            victim->active = true;
+            victim->id = id;
+            victim->count = count;
+            victim->received = 0u;
+            victim->arrived.assign(count, false);
+            victim->bytes.assign(length, '\0');
+            return *victim;
+        }
+
+    public:
+        /**
+         * Constructs assembler.
+         * @param capacity number of messages reassembled at the same time.
+         * @throws std::invalid_argument when capacity is 0.
+         */
+        explicit ChunkAssembler(std::size_t capacity = REASSEMBLY_SLOTS)
+                : slots(capacity) {
+            if (capacity == 0u) {
+                throw std::invalid_argument("Capacity must be positive");
+            }
+        }
+
+        /**
+         * Adds chunk, duplicates are ignored.
+         * @param bytes chunk.
+         * @param length chunk length.
+         * @param message set to the reassembled message, valid until the
+         * next call, once its last chunk came.
+         * @return whether the message is complete.
+         * @throws std::invalid_argument when datagram is not a valid chunk.
+         */
+        bool add(const char *bytes, std::size_t length,
+                 boost::string_view &message) {
+            if (length < CHUNK_HEADER_SIZE || !is_chunk(bytes, length)) {
+                throw std::invalid_argument("Invalid chunk");
+            }
+            uint32_t id = ChunkSchema::get<CHUNK_MESSAGE_ID>(bytes);
+            uint16_t index = ChunkSchema::get<CHUNK_INDEX>(bytes);
+            uint16_t count = ChunkSchema::get<CHUNK_COUNT>(bytes);
+            std::size_t total = ChunkSchema::get<CHUNK_MESSAGE_LENGTH>(bytes);
+            if (index >= count || total > MAX_MESSAGE_LENGTH
+                || total < count) {
+                throw std::invalid_argument("Invalid chunk");
+            }
+            std::size_t payload = chunk_payload(total, count);
+            std::size_t begin = index * payload;
+            std::size_t part = length - CHUNK_HEADER_SIZE;
+            if (begin >= total || part != std::min(payload, total - begin)) {
+                throw std::invalid_argument("Invalid chunk length");
+            }
+            const char *data = bytes + CHUNK_HEADER_SIZE;
+            if (count == 1u) {
+                message = boost::string_view(data, part);
+                return true;
+            }
+
+            Reassembly &slot = find(id, count, total);
+            slot.used = ++clock;
+            if (slot.arrived[index]) {
+                return false;
+            }
+            slot.arrived[index] = true;
+            std::memcpy(&slot.bytes[begin], data, part);
+            if (++slot.received < count) {
+                return false;
+            }
+            completed.swap(slot.bytes);
+            slot.active = false;
+            message = completed;
+            return true;
+        }
+
+        /**
+         * @return number of messages being reassembled.
+         */
+        std::size_t pending() const noexcept {
+            std::size_t count = 0u;
+            for (const Reassembly &slot: slots) {
+                count += slot.active ? 1u : 0u;
+            }
+            return count;
+        }
+
+        /**
+         * @return number of messages evicted before all their chunks came.
+         */
+        uint64_t get_dropped() const noexcept {
+            return dropped;
+        }
+    };
+}
+
+#endif //SIK_UDP_CHUNKS_H
@@ -19,6 +19,8 @@ char character;
 std::string host;
 // Port given as first parameter.
 int port = DEFAULT_PORT;
+// Protocol extensions announced to the server.
+sik::features_t features = sik::NO_FEATURES;
 
 /// Client instance
 std::unique_ptr<sik::Client> client;
@@ -27,12 +29,16 @@ std::unique_ptr<sik::Client> client;
  * Prints usage.
  */
 void usage() {
-    std::cerr << "Usage: " << executable << " timestamp c host [port]\n\n"
+    std::cerr << "Usage: " << executable
+              << " timestamp c host [port] [--extensions]\n\n"
             "Parameters:\n"
             " - timestamp   Timestamp sent in packet\n"
             " - c           Character sent in packet\n"
             " - host        Server to connect to\n"
-            " - port        Optional server port (default: 20160)\n";
+            " - port        Optional server port (default: 20160)\n"
+            " - --extensions\n"
+            "               Announce supported protocol extensions, servers\n"
+            "               not knowing them refuse the request\n";
 }
 
 /**
@@ -40,10 +46,22 @@ void usage() {
  * @param argc arguments count.
  * @param argv argument values.
  */
-void parse_arguments(const int argc, char * const argv[]) {
+void parse_arguments(int argc, char * const argv[]) {
     // Save executable for `usage` function.
     executable = std::move(argv[0]);
 
+    // Options follow positional arguments.
+    for (; argc > 1 && std::string(argv[argc - 1]).compare(0, 2, "--") == 0;
+           argc--) {
+        std::string option = argv[argc - 1];
+        if (option == "--extensions") {
+            features = sik::SUPPORTED_FEATURES;
+        } else {
+            usage();
+            fatal("Unknown option " + option, Status::ERROR_ARGS);
+        }
+    }
+
     if (argc < 4 || argc > 5) {
         usage();
         fatal("Invalid arguments count", Status::ERROR_ARGS);
@@ -66,7 +84,7 @@ int main(int argc, char * argv[]) {
     parse_arguments(argc, argv);
 
     try {
-        client = std::make_unique<sik::Client>(host, port);
+        client = std::make_unique<sik::Client>(host, port, features);
     } catch (const sik::ClientException &e) {
         fatal(e.what(), Status::ERROR_ARGS);
     }
@@ -2,17 +2,24 @@
 #define SIK_UDP_CLIENT_H
 
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
+#include <ctime>
+#include <iostream>
 
 #include <sys/socket.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 #include <unistd.h>
 
+#include "chunks.h"
 #include "error.h"
 #include "protocol.h"
+#include "compression.h"
 #include "communication.h"
+#include "parity.h"
+#include "sequence.h"
 
 namespace sik {
 
@@ -39,6 +46,179 @@ namespace sik {
         std::unique_ptr<Sender> sender;
         /// Message receiver
         std::unique_ptr<Receiver> receiver;
+        /// Extensions announced to the server, NO_FEATURES for none.
+        features_t features;
+        /// Memory compressed messages are decompressed into
+        std::string decompressed;
+        /// Whether content was received and cached.
+        bool cached = false;
+        /// Last content received in full.
+        std::string cached_content;
+        /// Identifier of cached_content.
+        content_id_t cached_id = 0u;
+        /// Time the content was last acknowledged.
+        std::time_t acknowledged_at = 0;
+        /// Messages being reassembled from chunks.
+        ChunkAssembler chunks;
+        /// Timestamp of the request sent to the server.
+        timestamp_t request_timestamp = 0u;
+        /// Character of the request sent to the server.
+        char request_character = '\0';
+        /// Cookie last offered by the server.
+        cookie_t cookie = NO_COOKIE;
+        /// Datagrams lost or reordered, from their sequence numbers.
+        SequenceTracker sequence;
+        /// Time of the last loss report.
+        std::time_t reported_at = 0;
+        /// Latest datagrams, rebuilding a lost one from parity.
+        ParityDecoder parity;
+
+        /**
+         * Reports datagrams missing just before the received one, so the
+         * server may send them again. Datagrams too old to be told from
+         * duplicates are not reported.
+         * @param number sequence number of the received datagram.
+         * @param missing number of datagrams missing before it.
+         */
+        void report_missing(uint32_t number, uint32_t missing) {
+            missing = std::min(missing, SEQUENCE_WINDOW - 1u);
+            try {
+                sender->send_datagram(address, Datagram(
+                        nack(number - missing, (uint16_t) missing)));
+            } catch (const std::exception &) {
+                std::cerr << "Error occurred while sending report of missing"
+                             " datagrams to server" << std::endl;
+            }
+        }
+
+        /**
+         * Strips the sequence number from the datagram and records it,
+         * reporting loss to stderr at most every LOSS_REPORT_INTERVAL
+         * seconds.
+         * @param datagram datagram, set to the part after the number.
+         * @return whether datagram should be printed, false for duplicates.
+         */
+        bool track(boost::string_view &datagram) {
+            uint32_t number;
+            if (!read_sequence(datagram.data(), datagram.length(), number)) {
+                return true;
+            }
+            datagram.remove_prefix(SEQUENCE_HEADER_SIZE);
+            uint32_t missing;
+            if (!sequence.record(number, missing)) {
+                return false;
+            }
+            parity.keep(number, datagram);
+            if (missing > 0u) {
+                report_missing(number, missing);
+            }
+            std::time_t now = std::time(0);
+            if (sequence.get_lost() == 0u
+                || now < reported_at + LOSS_REPORT_INTERVAL) {
+                return true;
+            }
+            reported_at = now;
+            std::cerr << "Datagrams received: " << sequence.get_received()
+                      << ", lost: " << sequence.get_lost()
+                      << " (" << 100.0 * sequence.loss_rate() << "%)"
+                      << ", reordered: " << sequence.get_reordered()
+                      << std::endl;
+            return true;
+        }
+
+        /**
+         * Sends request to the server. Extensions, if any, are announced
+         * after the header, with the cookie if the server offered one.
+         * Without extensions the request is in the original format, which
+         * servers not knowing them accept.
+         */
+        void send_request() {
+            try {
+                sender->send_datagram(address, Datagram(
+                        Message(request_timestamp, request_character, ""),
+                        features == NO_FEATURES
+                        ? std::string() : request_extension(features, cookie),
+                        false));
+            } catch (const std::exception&) {
+                std::cerr << "Error occurred while sending message to server"
+                          << std::endl;
+            }
+        }
+
+        /**
+         * Decodes single message sent by the server.
+         * @param datagram message, either plain or compressed.
+         * @return message with text, valid until the next call.
+         * @throws std::invalid_argument if data is not a valid message.
+         */
+        MessageView decode(boost::string_view datagram) {
+            if (is_compressed(datagram.data(), datagram.length())) {
+                return decompress_message(datagram.data(), datagram.length(),
+                                          decompressed);
+            }
+            return MessageView::with_text(datagram.data(), datagram.length());
+        }
+
+        /**
+         * Caches content received in full and acknowledges it, at most once
+         * a second, so the server may send only its identifier. Content
+         * keeps coming until an acknowledgement gets through. Nothing is
+         * acknowledged unless content identifiers were announced, servers
+         * not knowing them would take it for an invalid request.
+         * @param content message text.
+         */
+        void remember(boost::string_view content) {
+            if (!(features & FEATURE_CONTENT_ID)) {
+                return;
+            }
+            if (!cached || content != cached_content) {
+                cached_content.assign(content.data(), content.length());
+                cached_id = content_id(content);
+                cached = true;
+            }
+            std::time_t now = std::time(0);
+            if (now == acknowledged_at) {
+                return;
+            }
+            acknowledged_at = now;
+            try {
+                sender->send_datagram(address,
+                                      Datagram(acknowledgement(cached_id)));
+            } catch (const std::exception &) {
+                std::cerr << "Error occurred while sending acknowledgement to"
+                             " server" << std::endl;
+            }
+        }
+
+        /**
+         * Prints single message sent by the server, without a new line.
+         * Content identifiers are replaced by the cached content. Chunks are
+         * collected until the whole message came.
+         * @param datagram message or its chunk.
+         * @return whether anything was printed.
+         * @throws std::invalid_argument if data is not a valid message.
+         */
+        bool print(boost::string_view datagram) {
+            if (is_chunk(datagram.data(), datagram.length())
+                && !chunks.add(datagram.data(), datagram.length(),
+                               datagram)) {
+                return false;
+            }
+            if (is_reference(datagram.data(), datagram.length())) {
+                content_id_t id;
+                MessageView header = read_reference(datagram.data(),
+                                                    datagram.length(), id);
+                if (!cached || id != cached_id) {
+                    throw std::invalid_argument("Unknown content identifier");
+                }
+                std::cout << header << cached_content;
+                return true;
+            }
+            MessageView message = decode(datagram);
+            std::cout << message;
+            remember(message.get_message());
+            return true;
+        }
 
         /**
          * Opens new UDP socket and saves it to the sock.
@@ -77,7 +257,14 @@ namespace sik {
         }
 
     public:
-        Client(const std::string &host, uint16_t port) {
+        /**
+         * @param host server host.
+         * @param port server port.
+         * @param features extensions announced to the server, NO_FEATURES
+         * for the original protocol.
+         */
+        Client(const std::string &host, uint16_t port,
+               features_t features = NO_FEATURES) : features(features) {
             setup_address(host, port);
             open_socket();
 
@@ -90,28 +277,59 @@ namespace sik {
         }
 
         /**
-         * Sends given message to server.
+         * Sends given message to server, announcing extensions of the
+         * client. Message is sent again if the server offers a cookie.
          * @param message message to send.
          */
         void send(const std::unique_ptr<Message> &message) {
-            try {
-                sender->send_message(address, message);
-            } catch (const std::exception&) {
-                std::cerr << "Error occurred while sending message to server"
-                          << std::endl;
-            }
+            request_timestamp = message->get_timestamp();
+            request_character = message->get_character();
+            send_request();
         }
 
         /**
-         * Receives data from server and prints it to the stdout. If given
-         * data is not a valid message prints warning to stderr and.
+         * Receives data from server and prints it to the stdout, every
+         * message of a frame in order. If given data is not a valid message
+         * prints warning to stderr and.
          */
         void receive() {
             sockaddr_in server_address = sockaddr_in();
             try {
-                std::unique_ptr<Message> message
-                        = receiver->receive_message(server_address, true);
-                std::cout << *message << std::endl;
+                boost::string_view datagram
+                        = receiver->receive_datagram(server_address);
+                cookie_t offered;
+                if (read_cookie_offer(datagram.data(), datagram.length(),
+                                      offered)) {
+                    // Cookie equal to the echoed one would be refused again.
+                    if (offered != cookie) {
+                        cookie = offered;
+                        send_request();
+                    }
+                    return;
+                }
+                // Lost datagram is rebuilt as if it came now.
+                if (is_parity(datagram.data(), datagram.length())
+                    && !parity.rebuild(datagram.data(), datagram.length(),
+                                       datagram)) {
+                    return;
+                }
+                if (!track(datagram)) {
+                    return;
+                }
+                if (!is_frame(datagram.data(), datagram.length())) {
+                    if (print(datagram)) {
+                        std::cout << std::endl;
+                    }
+                    return;
+                }
+                FrameReader frame(datagram.data(), datagram.length());
+                boost::string_view message;
+                while (frame.next(message)) {
+                    if (print(message)) {
+                        std::cout << "\n";
+                    }
+                }
+                std::cout << std::flush;
             } catch (const std::invalid_argument& e) {
                 print_error(address, e.what());
             } catch (const ConnectionException&) {
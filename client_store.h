@@ -0,0 +1,502 @@
+#ifndef SIK_UDP_CLIENT_STORE_H
+#define SIK_UDP_CLIENT_STORE_H
+
+
+#include <ctime>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "address_map.h"
+#include "simd.h"
+
+namespace sik {
+    /// Returned by Bitmap::find_next when there are no more set bits.
+    const std::size_t NO_BIT = ~(std::size_t) 0;
+    /// Marks missing neighbour in the list of recently active clients.
+    const uint32_t NO_SLOT = ~(uint32_t) 0;
+
+    /**
+     * Fixed size set of bits stored in 64-bit words.
+     */
+    class Bitmap {
+    private:
+        /// Bits, bit i is stored in words[i / 64] at position i % 64.
+        std::vector<uint64_t> words;
+        /// Number of bits.
+        std::size_t length = 0u;
+    public:
+        /**
+         * Changes number of bits. New bits are cleared.
+         * @param bits number of bits.
+         */
+        void resize(std::size_t bits) {
+            words.resize((bits + 63u) / 64u);
+            if (bits < length && bits % 64u != 0u) {
+                words.back() &= ~(uint64_t) 0 >> (64u - bits % 64u);
+            }
+            length = bits;
+        }
+
+        /**
+         * @return number of bits.
+         */
+        std::size_t size() const noexcept {
+            return length;
+        }
+
+        /**
+         * @return words holding the bits.
+         */
+        uint64_t *data() noexcept {
+            return words.data();
+        }
+
+        bool test(std::size_t bit) const noexcept {
+            return (words[bit / 64u] >> (bit % 64u)) & 1u;
+        }
+
+        void set(std::size_t bit) noexcept {
+            words[bit / 64u] |= (uint64_t) 1 << (bit % 64u);
+        }
+
+        void reset(std::size_t bit) noexcept {
+            words[bit / 64u] &= ~((uint64_t) 1 << (bit % 64u));
+        }
+
+        /**
+         * Finds first set bit not before given one.
+         * @param bit first bit to check.
+         * @return index of set bit or NO_BIT.
+         */
+        std::size_t find_next(std::size_t bit) const noexcept {
+            if (bit >= length) {
+                return NO_BIT;
+            }
+            std::size_t word = bit / 64u;
+            uint64_t bits = words[word] & (~(uint64_t) 0 << (bit % 64u));
+            while (bits == 0u) {
+                if (++word == words.size()) {
+                    return NO_BIT;
+                }
+                bits = words[word];
+            }
+            return word * 64u + (std::size_t) __builtin_ctzll(bits);
+        }
+
+        /**
+         * @return number of set bits.
+         */
+        std::size_t count() const noexcept {
+            std::size_t result = 0u;
+            for (uint64_t word: words) {
+                result += (std::size_t) __builtin_popcountll(word);
+            }
+            return result;
+        }
+    };
+
+    /**
+     * Queue of connection intervals keeping up to INLINE_CAPACITY intervals
+     * inside the object. Only clients reconnecting more often than that make
+     * it move the intervals to the heap.
+     */
+    class IntervalRing {
+    public:
+        /// Connection interval (first second, last second).
+        using Interval = std::pair<std::time_t, std::time_t>;
+        /// Number of intervals stored without allocation.
+        static const std::size_t INLINE_CAPACITY = 2u;
+
+    private:
+        /// Intervals stored inline, as a ring starting at first.
+        Interval intervals[INLINE_CAPACITY];
+        /// Intervals moved to the heap, used instead of the inline ones.
+        std::unique_ptr<std::deque<Interval>> spilled;
+        /// Index of the first inline interval.
+        uint8_t first = 0u;
+        /// Number of inline intervals.
+        uint8_t length = 0u;
+
+    public:
+        IntervalRing() = default;
+
+        IntervalRing(IntervalRing &&) = default;
+
+        IntervalRing &operator=(IntervalRing &&) = default;
+
+        /**
+         * @return number of intervals.
+         */
+        std::size_t size() const noexcept {
+            return spilled ? spilled->size() : length;
+        }
+
+        /**
+         * @return whether there are no intervals.
+         */
+        bool empty() const noexcept {
+            return size() == 0u;
+        }
+
+        /**
+         * @param index interval index, less than size().
+         * @return interval at the index, counting from the oldest.
+         */
+        const Interval &operator[](std::size_t index) const noexcept {
+            if (spilled) {
+                return (*spilled)[index];
+            }
+            return intervals[(first + index) % INLINE_CAPACITY];
+        }
+
+        /**
+         * @return oldest interval.
+         */
+        const Interval &front() const noexcept {
+            return (*this)[0];
+        }
+
+        /**
+         * Adds interval after all others.
+         * @param interval interval to add.
+         */
+        void push_back(const Interval &interval) {
+            if (!spilled && length == INLINE_CAPACITY) {
+                std::unique_ptr<std::deque<Interval>> heap(
+                        new std::deque<Interval>());
+                for (std::size_t i = 0u; i < length; i++) {
+                    heap->push_back((*this)[i]);
+                }
+                spilled = std::move(heap);
+                length = 0u;
+            }
+            if (spilled) {
+                spilled->push_back(interval);
+                return;
+            }
+            intervals[(first + length) % INLINE_CAPACITY] = interval;
+            length++;
+        }
+
+        /**
+         * Removes oldest interval.
+         */
+        void pop_front() noexcept {
+            if (spilled) {
+                spilled->pop_front();
+                return;
+            }
+            first = (uint8_t) ((first + 1u) % INLINE_CAPACITY);
+            length--;
+        }
+
+        /**
+         * Removes all intervals, releasing the heap memory.
+         */
+        void clear() noexcept {
+            spilled.reset();
+            first = 0u;
+            length = 0u;
+        }
+    };
+
+    /**
+     * Client records stored as a structure of arrays. Every client occupies a
+     * slot, an index into arrays of addresses and connection interval
+     * bounds, so scans over all clients read only the dense arrays they need.
+     * Slots of removed clients are reused, slots never move.
+     */
+    class ClientStore {
+    public:
+        /// Index of a client record.
+        using slot_t = uint32_t;
+        /// Connection interval (first second, last second).
+        using Interval = IntervalRing::Interval;
+
+    private:
+        /// Start of a free slot, greater than any time point.
+        static const int64_t FREE_START = std::numeric_limits<int64_t>::max();
+        /// End of a free slot, less than any time point.
+        static const int64_t FREE_END = std::numeric_limits<int64_t>::min();
+
+        /// Length of a connection interval.
+        std::time_t timeout;
+
+        /// Packed client addresses.
+        std::vector<address_t> keys;
+        /// Time of the last datagram received from a client.
+        std::vector<int64_t> last_seen;
+        /// First second of the latest interval.
+        std::vector<int64_t> starts;
+        /// Last second of the latest interval.
+        std::vector<int64_t> ends;
+        /// Generation of connections the slot was occupied at.
+        std::vector<uint64_t> joined;
+        /// Intervals preceding the latest one, empty for nearly all clients.
+        std::vector<IntervalRing> older;
+        /// Slots with older intervals.
+        Bitmap has_older;
+        /// Slots of removed clients.
+        std::vector<slot_t> free_slots;
+        /// Next more recently active client of every used slot.
+        std::vector<slot_t> more_recent;
+        /// Next less recently active client of every used slot.
+        std::vector<slot_t> less_recent;
+        /// Most recently active client.
+        slot_t newest = NO_SLOT;
+        /// Least recently active client.
+        slot_t oldest = NO_SLOT;
+
+        /**
+         * Links slot as the most recently active client.
+         * @param slot client slot.
+         */
+        void link(slot_t slot) noexcept {
+            more_recent[slot] = NO_SLOT;
+            less_recent[slot] = newest;
+            if (newest != NO_SLOT) {
+                more_recent[newest] = slot;
+            } else {
+                oldest = slot;
+            }
+            newest = slot;
+        }
+
+        /**
+         * Unlinks slot from the list of recently active clients.
+         * @param slot client slot.
+         */
+        void unlink(slot_t slot) noexcept {
+            if (more_recent[slot] != NO_SLOT) {
+                less_recent[more_recent[slot]] = less_recent[slot];
+            } else {
+                newest = less_recent[slot];
+            }
+            if (less_recent[slot] != NO_SLOT) {
+                more_recent[less_recent[slot]] = more_recent[slot];
+            } else {
+                oldest = more_recent[slot];
+            }
+        }
+
+    public:
+        /**
+         * Constructs empty store.
+         * @param timeout length of a connection interval.
+         */
+        explicit ClientStore(std::time_t timeout) noexcept : timeout(timeout) {}
+
+        /**
+         * Stores new client.
+         * @param key client address.
+         * @param timestamp start of the first interval.
+         * @param generation generation of connections.
+         * @return slot of the client.
+         */
+        slot_t add(address_t key, std::time_t timestamp, uint64_t generation) {
+            slot_t slot;
+            if (free_slots.empty()) {
+                slot = (slot_t) keys.size();
+                keys.push_back(key);
+                last_seen.push_back(timestamp);
+                starts.push_back(timestamp);
+                ends.push_back(timestamp + timeout);
+                joined.push_back(generation);
+                older.emplace_back();
+                has_older.resize(keys.size());
+                more_recent.push_back(NO_SLOT);
+                less_recent.push_back(NO_SLOT);
+            } else {
+                slot = free_slots.back();
+                free_slots.pop_back();
+                keys[slot] = key;
+                last_seen[slot] = timestamp;
+                starts[slot] = timestamp;
+                ends[slot] = timestamp + timeout;
+                joined[slot] = generation;
+            }
+            link(slot);
+            return slot;
+        }
+
+        /**
+         * Adds new connection or extends the latest interval (if intervals
+         * would overlap).
+         * @param slot client slot.
+         * @param timestamp connection time.
+         */
+        void connect(slot_t slot, std::time_t timestamp) {
+            last_seen[slot] = timestamp;
+            if (slot != newest) {
+                unlink(slot);
+                link(slot);
+            }
+            if (ends[slot] >= timestamp) {
+                ends[slot] = timestamp + timeout;
+                return;
+            }
+            older[slot].push_back(std::make_pair(starts[slot], ends[slot]));
+            has_older.set(slot);
+            starts[slot] = timestamp;
+            ends[slot] = timestamp + timeout;
+        }
+
+        /**
+         * Removes intervals with end < timestamp.
+         * @param slot client slot.
+         * @param timestamp time point.
+         * @return whether client has any interval left.
+         */
+        bool expire(slot_t slot, std::time_t timestamp) {
+            if (ends[slot] < timestamp) {
+                older[slot].clear();
+                has_older.reset(slot);
+                return false;
+            }
+            auto &intervals = older[slot];
+            while (!intervals.empty() && intervals.front().second < timestamp) {
+                intervals.pop_front();
+            }
+            if (intervals.empty()) {
+                has_older.reset(slot);
+            }
+            return true;
+        }
+
+        /**
+         * Frees client slot.
+         * @param slot client slot.
+         */
+        void remove(slot_t slot) {
+            unlink(slot);
+            older[slot].clear();
+            has_older.reset(slot);
+            starts[slot] = FREE_START;
+            ends[slot] = FREE_END;
+            free_slots.push_back(slot);
+        }
+
+        /**
+         * @param slot client slot.
+         * @return end of the earliest interval of the client.
+         */
+        std::time_t first_end(slot_t slot) const noexcept {
+            return older[slot].empty() ? (std::time_t) ends[slot]
+                                       : older[slot].front().second;
+        }
+
+        /**
+         * @param slot client slot.
+         * @return end of the latest interval of the client.
+         */
+        std::time_t last_end(slot_t slot) const noexcept {
+            return (std::time_t) ends[slot];
+        }
+
+        /**
+         * Checks if client has interval containing given time point.
+         * @param slot client slot.
+         * @param timestamp time point.
+         * @return whether client should receive messages from timestamp.
+         */
+        bool is_connected(slot_t slot, std::time_t timestamp) const noexcept {
+            if (starts[slot] <= timestamp && ends[slot] >= timestamp) {
+                return true;
+            }
+            const IntervalRing &intervals = older[slot];
+            for (std::size_t i = 0u; i < intervals.size(); i++) {
+                if (intervals[i].first <= timestamp
+                    && intervals[i].second >= timestamp) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Marks slots of all clients connected at given time point.
+         * Latest intervals are compared with SIMD instructions, older intervals
+         * are checked only for the few clients having them.
+         * @param timestamp time point.
+         * @param selected bitmap resized to slots() and overwritten.
+         */
+        void select(std::time_t timestamp, Bitmap &selected) const {
+            selected.resize(keys.size());
+            mask_between(starts.data(), ends.data(), keys.size(), timestamp,
+                         selected.data());
+            for (std::size_t slot = has_older.find_next(0u);
+                 slot != NO_BIT; slot = has_older.find_next(slot + 1)) {
+                if (is_connected((slot_t) slot, timestamp)) {
+                    selected.set(slot);
+                }
+            }
+        }
+
+        /**
+         * @return slot of the client which was active least recently or
+         * NO_SLOT if there are no clients.
+         */
+        slot_t least_recent() const noexcept {
+            return oldest;
+        }
+
+        /**
+         * @param slot client slot.
+         * @return client address.
+         */
+        address_t key(slot_t slot) const noexcept {
+            return keys[slot];
+        }
+
+        /**
+         * @param slot client slot.
+         * @return generation of connections the slot was occupied at.
+         */
+        uint64_t joined_at(slot_t slot) const noexcept {
+            return joined[slot];
+        }
+
+        /**
+         * @param slot client slot.
+         * @return time of the last datagram received from the client.
+         */
+        std::time_t seen_at(slot_t slot) const noexcept {
+            return (std::time_t) last_seen[slot];
+        }
+
+        /**
+         * @param slot client slot.
+         * @return whether slot holds a client.
+         */
+        bool is_used(slot_t slot) const noexcept {
+            return ends[slot] != FREE_END;
+        }
+
+        /**
+         * @return packed addresses of all slots, valid for used slots only.
+         */
+        const address_t *addresses() const noexcept {
+            return keys.data();
+        }
+
+        /**
+         * @return number of slots, used or free.
+         */
+        std::size_t slots() const noexcept {
+            return keys.size();
+        }
+
+        /**
+         * @return number of stored clients.
+         */
+        std::size_t size() const noexcept {
+            return keys.size() - free_slots.size();
+        }
+    };
+}
+
+#endif //SIK_UDP_CLIENT_STORE_H
@@ -3,10 +3,63 @@
 
 #include <string>
 #include <memory>
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/ip_icmp.h>
+#include <linux/errqueue.h>
 
 #include "protocol.h"
+#include "address_map.h"
+#include "simd.h"
 
 namespace sik {
+    /// Maximum number of datagrams sent with a single system call.
+    const std::size_t SEND_BATCH_SIZE = 64u;
+    /// Maximum number of requests received with a single system call.
+    const std::size_t RECEIVE_BATCH_SIZE = HEADER_BATCH_SIZE;
+    /// Bytes kept of every request, longer requests are truncated.
+    const std::size_t REQUEST_SLOT_SIZE = 32u;
+    static_assert(HeaderSchema::size + ExtensionSchema::size
+                  + CookieSchema::size <= REQUEST_SLOT_SIZE,
+                  "Request with extension and cookie must fit in a slot");
+
+    /**
+     * Requests received with a single system call, stored in slots of
+     * REQUEST_SLOT_SIZE bytes.
+     */
+    struct RequestBatch {
+        /// Request i is stored at slots + i * REQUEST_SLOT_SIZE.
+        char slots[RECEIVE_BATCH_SIZE * REQUEST_SLOT_SIZE];
+        /// Request lengths, truncated to REQUEST_SLOT_SIZE.
+        uint32_t lengths[RECEIVE_BATCH_SIZE];
+        /// Request senders.
+        sockaddr_in addresses[RECEIVE_BATCH_SIZE];
+    };
+
+    /**
+     * Bytes sent before a shared datagram to a single receiver.
+     */
+    struct DatagramPrefix {
+        /// Prefix bytes.
+        char bytes[SEQUENCE_HEADER_SIZE];
+        /// Number of bytes used, 0 for no prefix.
+        std::size_t length;
+    };
+
+    /**
+     * Datagram with its receiver.
+     */
+    struct AddressedDatagram {
+        /// Packed receiver address.
+        address_t key;
+        /// Datagram to send.
+        Datagram datagram;
+    };
+
     /**
      * Exception thrown when Sender or Receiver error occurs.
      */
@@ -17,6 +70,20 @@ namespace sik {
      */
     class WouldBlockException : public std::exception {};
 
+    /**
+     * Tells an error caused by an earlier datagram from an error of the
+     * call reporting it. Once IP_RECVERR is enabled, an ICMP error of any
+     * datagram fails the next send or receive call on the socket, whatever
+     * its destination, while the error itself stays in the error queue. The
+     * call succeeds when repeated.
+     * @param error errno value of the failed call.
+     * @return whether error is a report of an earlier datagram.
+     */
+    inline bool is_deferred_error(int error) noexcept {
+        return error == ECONNREFUSED || error == EHOSTUNREACH
+               || error == ENETUNREACH || error == EHOSTDOWN;
+    }
+
     /**
      * Class for sending messages over socket.
      */
@@ -24,6 +91,26 @@ namespace sik {
     private:
         /// Socket to send data to.
         int sock;
+
+        /**
+         * Describes datagram with its prefix as scattered buffers.
+         * @param data output of up to 2 buffers.
+         * @param datagram shared datagram.
+         * @param prefix bytes sent before the datagram or nullptr.
+         * @return number of buffers used.
+         */
+        static std::size_t gather(iovec *data, const Datagram &datagram,
+                                  const DatagramPrefix *prefix) noexcept {
+            std::size_t used = 0u;
+            if (prefix != nullptr && prefix->length > 0u) {
+                data[used].iov_base = (void *) prefix->bytes;
+                data[used++].iov_len = prefix->length;
+            }
+            data[used].iov_base = (void *) datagram.data();
+            data[used++].iov_len = datagram.length();
+            return used;
+        }
+
     public:
         /**
          * Creates new sender.
@@ -42,29 +129,180 @@ namespace sik {
         void send_message(const sockaddr_in &address,
                           const std::unique_ptr<Message> &message,
                           bool with_message = false) const {
-            socklen_t address_len = sizeof(address);
+            send_datagram(address, Datagram(*message, "", with_message));
+        }
+
+        /**
+         * Sends prepared datagram to given address.
+         * @param address receiver address.
+         * @param datagram datagram to send.
+         * @throws WouldBlockException if sendto finishes with errno EWOULDBLOCK
+         * @throws ConnectionException when sendto finishes with error
+         */
+        void send_datagram(const sockaddr_in &address,
+                           const Datagram &datagram) const {
+            ssize_t length;
+            do {
+                length = sendto(sock, datagram.data(), datagram.length(), 0,
+                                (sockaddr *) &address,
+                                (socklen_t) sizeof(address));
+            } while (length < 0 && is_deferred_error(errno));
+
+            if (length < 0 && errno == EWOULDBLOCK) {
+                throw WouldBlockException();
+            }
 
-            std::string bytes = message->to_bytes();
-            char data[bytes.length() + 1];
-            ssize_t data_length = bytes.length();
+            if (length != (ssize_t) datagram.length()) {
+                throw ConnectionException();
+            }
+        }
 
-            // We have to null terminate the string before sending.
-            std::memcpy(data, bytes.c_str(), bytes.length());
-            if (with_message) {
-                data[data_length] = '\0';
-                data_length++;
+        /**
+         * Sends message to many addresses with a single sendmmsg call.
+         * Message is serialized once and shared by all datagrams.
+         * @param addresses packed receiver addresses.
+         * @param count number of addresses, at most SEND_BATCH_SIZE.
+         * @param message message to send.
+         * @param with_message send message with content.
+         * @return number of leading addresses the message was sent to.
+         * @throws WouldBlockException if the first datagram would block
+         * @throws ConnectionException when sending the first datagram fails
+         */
+        std::size_t send_message_batch(const address_t *addresses,
+                                       std::size_t count,
+                                       const std::unique_ptr<Message> &message,
+                                       bool with_message = false) const {
+            return send_datagram_batch(addresses, count,
+                                       Datagram(*message, "", with_message));
+        }
+
+        /**
+         * Sends prepared datagram to many addresses with a single sendmmsg
+         * call.
+         * @param addresses packed receiver addresses.
+         * @param count number of addresses, at most SEND_BATCH_SIZE.
+         * @param datagram datagram to send.
+         * @return number of leading addresses the datagram was sent to.
+         * @throws WouldBlockException if the first datagram would block
+         * @throws ConnectionException when sending the first datagram fails
+         */
+        std::size_t send_datagram_batch(const address_t *addresses,
+                                        std::size_t count,
+                                        const Datagram &datagram) const {
+            iovec data;
+            data.iov_base = (void *) datagram.data();
+            data.iov_len = datagram.length();
+
+            sockaddr_in receivers[SEND_BATCH_SIZE];
+            mmsghdr headers[SEND_BATCH_SIZE];
+            count = std::min(count, SEND_BATCH_SIZE);
+            for (std::size_t i = 0u; i < count; i++) {
+                receivers[i] = unpack_address(addresses[i]);
+                headers[i] = mmsghdr();
+                headers[i].msg_hdr.msg_name = &receivers[i];
+                headers[i].msg_hdr.msg_namelen = sizeof(receivers[i]);
+                headers[i].msg_hdr.msg_iov = &data;
+                headers[i].msg_hdr.msg_iovlen = 1;
             }
 
-            ssize_t length = sendto(sock, data, data_length, 0,
-                            (sockaddr *) &address, address_len);
+            int sent;
+            do {
+                sent = sendmmsg(sock, headers, (unsigned int) count, 0);
+            } while (sent < 0 && is_deferred_error(errno));
+            if (sent < 0 && errno == EWOULDBLOCK) {
+                throw WouldBlockException();
+            }
+            if (sent <= 0) {
+                throw ConnectionException();
+            }
+            return (std::size_t) sent;
+        }
 
-            if (length < 0 && errno == EWOULDBLOCK) {
+        /**
+         * Sends datagrams, possibly shared, to many addresses with a single
+         * sendmmsg call.
+         * @param addresses packed receiver addresses.
+         * @param datagrams datagram for every address.
+         * @param count number of addresses, at most SEND_BATCH_SIZE.
+         * @param prefixes bytes sent before the datagram to every address,
+         * nullptr for none.
+         * @return number of leading addresses the datagrams were sent to.
+         * @throws WouldBlockException if the first datagram would block
+         * @throws ConnectionException when sending the first datagram fails
+         */
+        std::size_t send_datagram_batch(const address_t *addresses,
+                                        const Datagram *const *datagrams,
+                                        std::size_t count,
+                                        const DatagramPrefix *prefixes
+                                        = nullptr) const {
+            iovec data[2u * SEND_BATCH_SIZE];
+            sockaddr_in receivers[SEND_BATCH_SIZE];
+            mmsghdr headers[SEND_BATCH_SIZE];
+            count = std::min(count, SEND_BATCH_SIZE);
+            for (std::size_t i = 0u; i < count; i++) {
+                receivers[i] = unpack_address(addresses[i]);
+                headers[i] = mmsghdr();
+                headers[i].msg_hdr.msg_name = &receivers[i];
+                headers[i].msg_hdr.msg_namelen = sizeof(receivers[i]);
+                headers[i].msg_hdr.msg_iov = &data[2u * i];
+                headers[i].msg_hdr.msg_iovlen = gather(
+                        &data[2u * i], *datagrams[i],
+                        prefixes == nullptr ? nullptr : &prefixes[i]);
+            }
+
+            int sent;
+            do {
+                sent = sendmmsg(sock, headers, (unsigned int) count, 0);
+            } while (sent < 0 && is_deferred_error(errno));
+            if (sent < 0 && errno == EWOULDBLOCK) {
                 throw WouldBlockException();
             }
+            if (sent <= 0) {
+                throw ConnectionException();
+            }
+            return (std::size_t) sent;
+        }
+
+        /**
+         * Sends different datagrams to their receivers with a single
+         * sendmmsg call.
+         * @param datagrams datagrams with receivers.
+         * @param count number of datagrams, at most SEND_BATCH_SIZE are sent.
+         * @param prefixes bytes sent before every datagram, nullptr for none.
+         * @return number of leading datagrams sent.
+         * @throws WouldBlockException if the first datagram would block
+         * @throws ConnectionException when sending the first datagram fails
+         */
+        std::size_t send_datagrams(const AddressedDatagram *datagrams,
+                                   std::size_t count,
+                                   const DatagramPrefix *prefixes
+                                   = nullptr) const {
+            iovec data[2u * SEND_BATCH_SIZE];
+            sockaddr_in receivers[SEND_BATCH_SIZE];
+            mmsghdr headers[SEND_BATCH_SIZE];
+            count = std::min(count, SEND_BATCH_SIZE);
+            for (std::size_t i = 0u; i < count; i++) {
+                receivers[i] = unpack_address(datagrams[i].key);
+                headers[i] = mmsghdr();
+                headers[i].msg_hdr.msg_name = &receivers[i];
+                headers[i].msg_hdr.msg_namelen = sizeof(receivers[i]);
+                headers[i].msg_hdr.msg_iov = &data[2u * i];
+                headers[i].msg_hdr.msg_iovlen = gather(
+                        &data[2u * i], datagrams[i].datagram,
+                        prefixes == nullptr ? nullptr : &prefixes[i]);
+            }
 
-            if (length != data_length) {
+            int sent;
+            do {
+                sent = sendmmsg(sock, headers, (unsigned int) count, 0);
+            } while (sent < 0 && is_deferred_error(errno));
+            if (sent < 0 && errno == EWOULDBLOCK) {
+                throw WouldBlockException();
+            }
+            if (sent <= 0) {
                 throw ConnectionException();
             }
+            return (std::size_t) sent;
         }
     };
 
@@ -85,36 +323,140 @@ namespace sik {
         Receiver(int sock) noexcept : sock(sock) {}
 
         /**
-         * Receives message from socket.
+         * Receives message from socket without copying it out of the
+         * receive buffer.
          * @param address sender address.
          * @param with_message whether message should contain message.
-         * @return received message
+         * @return received message, valid until the next receive call.
          * @throws std::invalid_parameter if received message is not a valid
          * message
          * @throws ConnectionException if recvfrom finishes with error
          */
-        std::unique_ptr<Message> receive_message(const sockaddr_in &address,
-                                                 bool with_message = false) {
+        MessageView receive_view(const sockaddr_in &address,
+                                 bool with_message = false) {
+            boost::string_view datagram = receive_datagram(address);
+            if (with_message) {
+                return MessageView::with_text(datagram.data(),
+                                              datagram.length());
+            }
+            return MessageView(datagram.data(), datagram.length());
+        }
+
+        /**
+         * Receives datagram from socket without interpreting it.
+         * @param address sender address.
+         * @return datagram bytes, valid until the next receive call.
+         * @throws ConnectionException if recvfrom finishes with error
+         */
+        boost::string_view receive_datagram(const sockaddr_in &address) {
             socklen_t address_len = sizeof(address);
 
             ssize_t length;
-            length = recvfrom(sock, buffer, sizeof(buffer) - 1, 0,
-                              (sockaddr *) &address, &address_len);
+            do {
+                length = recvfrom(sock, buffer, sizeof(buffer), 0,
+                                  (sockaddr *) &address, &address_len);
+            } while (length < 0 && is_deferred_error(errno));
             if (length < 0) {
                 throw ConnectionException();
             }
+            return boost::string_view(buffer, (std::size_t) length);
+        }
+
+        /**
+         * Receives all requests waiting on the socket, up to
+         * RECEIVE_BATCH_SIZE, with a single recvmmsg call.
+         * @param requests filled with received requests.
+         * @return number of received requests.
+         * @throws WouldBlockException if there are no requests
+         * @throws ConnectionException if recvmmsg finishes with error
+         */
+        std::size_t receive_requests(RequestBatch &requests) {
+            iovec data[RECEIVE_BATCH_SIZE];
+            mmsghdr headers[RECEIVE_BATCH_SIZE];
+            for (std::size_t i = 0u; i < RECEIVE_BATCH_SIZE; i++) {
+                data[i].iov_base = requests.slots + i * REQUEST_SLOT_SIZE;
+                data[i].iov_len = REQUEST_SLOT_SIZE;
+                headers[i] = mmsghdr();
+                headers[i].msg_hdr.msg_name = &requests.addresses[i];
+                headers[i].msg_hdr.msg_namelen = sizeof(requests.addresses[i]);
+                headers[i].msg_hdr.msg_iov = &data[i];
+                headers[i].msg_hdr.msg_iovlen = 1;
+            }
+
+            int received;
+            do {
+                received = recvmmsg(sock, headers, RECEIVE_BATCH_SIZE,
+                                    MSG_DONTWAIT, nullptr);
+            } while (received < 0 && is_deferred_error(errno));
+            if (received < 0 && errno == EWOULDBLOCK) {
+                throw WouldBlockException();
+            }
+            if (received < 0) {
+                throw ConnectionException();
+            }
+            for (int i = 0; i < received; i++) {
+                requests.lengths[i] = headers[i].msg_len;
+            }
+            return (std::size_t) received;
+        }
+
+        /**
+         * Receives message from socket.
+         * @param address sender address.
+         * @param with_message whether message should contain message.
+         * @return received message
+         * @throws std::invalid_parameter if received message is not a valid
+         * message
+         * @throws ConnectionException if recvfrom finishes with error
+         */
+        std::unique_ptr<Message> receive_message(const sockaddr_in &address,
+                                                 bool with_message = false) {
+            return std::make_unique<Message>(
+                    receive_view(address, with_message));
+        }
 
-            if (with_message ) {
-                if ((std::size_t) length <= Message::message_offset) {
-                    throw std::invalid_argument("Message must contain text");
-                } else if (buffer[length - 1] != '\0') {
-                    throw std::invalid_argument(
-                            "Message text must be null terminated");
+        /**
+         * Reads single error from the socket error queue, filled when
+         * IP_RECVERR is enabled on the socket.
+         * @param address set to the destination of the datagram which
+         * caused the error.
+         * @return whether the error reports the destination as unreachable.
+         * @throws WouldBlockException if the error queue is empty
+         * @throws ConnectionException if recvmsg finishes with error
+         */
+        bool receive_error(sockaddr_in &address) {
+            char control[CMSG_SPACE(sizeof(sock_extended_err)
+                                    + sizeof(sockaddr_in))];
+            msghdr header = msghdr();
+            header.msg_name = &address;
+            header.msg_namelen = sizeof(address);
+            header.msg_control = control;
+            header.msg_controllen = sizeof(control);
+
+            if (recvmsg(sock, &header, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+                if (errno == EWOULDBLOCK) {
+                    throw WouldBlockException();
                 }
+                throw ConnectionException();
             }
-            buffer[length] = '\0';
 
-            return std::make_unique<Message>(buffer, (std::size_t) length);
+            for (cmsghdr *message = CMSG_FIRSTHDR(&header); message != nullptr;
+                 message = CMSG_NXTHDR(&header, message)) {
+                if (message->cmsg_level != IPPROTO_IP
+                    || message->cmsg_type != IP_RECVERR) {
+                    continue;
+                }
+                sock_extended_err error;
+                std::memcpy(&error, CMSG_DATA(message), sizeof(error));
+                if (error.ee_origin == SO_EE_ORIGIN_ICMP
+                    && error.ee_type == ICMP_DEST_UNREACH
+                    && (error.ee_code == ICMP_NET_UNREACH
+                        || error.ee_code == ICMP_HOST_UNREACH
+                        || error.ee_code == ICMP_PORT_UNREACH)) {
+                    return true;
+                }
+            }
+            return false;
         }
     };
 }
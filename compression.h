@@ -0,0 +1,116 @@
+#ifndef SIK_UDP_COMPRESSION_H
+#define SIK_UDP_COMPRESSION_H
+
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <boost/utility/string_view.hpp>
+#include <zlib.h>
+
+#include "protocol.h"
+#include "wire.h"
+
+namespace sik {
+    /// Compressed message before the compressed text: marker, message header
+    /// and the text length.
+    using CompressedSchema = WireSchema<char, timestamp_t, char, uint32_t>;
+    /// Fields of CompressedSchema.
+    enum CompressedField : std::size_t {
+        COMPRESSED_MARKER_FIELD, COMPRESSED_TIMESTAMP, COMPRESSED_CHARACTER,
+        COMPRESSED_LENGTH
+    };
+    /// Bytes of a compressed message before the compressed text.
+    const std::size_t COMPRESSED_HEADER_SIZE = CompressedSchema::size;
+
+    /**
+     * Compresses text with zlib at the best compression level.
+     * @param text text to compress.
+     * @return compressed text.
+     * @throws std::runtime_error when compression fails.
+     */
+    inline std::string compress_text(boost::string_view text) {
+        uLongf length = compressBound((uLong) text.length());
+        std::string compressed(length, '\0');
+        if (compress2((Bytef *) &compressed[0], &length,
+                      (const Bytef *) text.data(), (uLong) text.length(),
+                      Z_BEST_COMPRESSION) != Z_OK) {
+            throw std::runtime_error("Error compressing file content");
+        }
+        compressed.resize(length);
+        return compressed;
+    }
+
+    /**
+     * Serializes message with compressed text, for clients which announced
+     * FEATURE_COMPRESSION:
+     * - 1 byte COMPRESSED_MARKER
+     * - 9 bytes of the message header
+     * - 4 bytes as the text length with the terminating NULL character
+     *   (uint32_t in big endian)
+     * - zlib stream of the text with the terminating NULL character
+     * @param message message header, its content is not sent.
+     * @param compressed compressed text.
+     * @param text_length length of the text with the NULL character.
+     * @return datagram.
+     */
+    inline Datagram compressed_datagram(const Message &message,
+                                        const std::string &compressed,
+                                        std::size_t text_length) {
+        std::string bytes(COMPRESSED_HEADER_SIZE + compressed.length(), '\0');
+        CompressedSchema::encode(&bytes[0], COMPRESSED_MARKER,
+                                 message.get_timestamp(),
+                                 message.get_character(),
+                                 (uint32_t) text_length);
+        std::memcpy(&bytes[COMPRESSED_HEADER_SIZE], compressed.data(),
+                    compressed.length());
+        return Datagram(std::move(bytes));
+    }
+
+    /**
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @return whether datagram is a message with compressed text.
+     */
+    inline bool is_compressed(const char *bytes, std::size_t length) noexcept {
+        return length > 0u && bytes[0] == COMPRESSED_MARKER;
+    }
+
+    /**
+     * Decompresses message sent with compressed_datagram.
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @param buffer memory the message is decompressed into.
+     * @return message with text, valid as long as the buffer.
+     * @throws std::invalid_argument when datagram is not a valid compressed
+     * message.
+     */
+    inline MessageView decompress_message(const char *bytes, std::size_t length,
+                                          std::string &buffer) {
+        if (length < COMPRESSED_HEADER_SIZE
+            || !is_compressed(bytes, length)) {
+            throw std::invalid_argument("Invalid compressed message");
+        }
+        uint32_t text_length = CompressedSchema::get<COMPRESSED_LENGTH>(bytes);
+        if (text_length > MAX_MESSAGE_LENGTH) {
+            throw std::invalid_argument("Compressed message too long");
+        }
+
+        const std::size_t offset = MessageView::message_offset;
+        buffer.resize(offset + text_length);
+        std::memcpy(&buffer[0],
+                    bytes + CompressedSchema::offset<COMPRESSED_TIMESTAMP>(),
+                    offset);
+        uLongf decompressed = text_length;
+        if (uncompress((Bytef *) &buffer[offset], &decompressed,
+                       (const Bytef *) bytes + COMPRESSED_HEADER_SIZE,
+                       (uLong) (length - COMPRESSED_HEADER_SIZE)) != Z_OK
+            || decompressed != text_length) {
+            throw std::invalid_argument("Corrupted compressed message");
+        }
+        return MessageView::with_text(buffer.data(), buffer.length());
+    }
+}
+
+#endif //SIK_UDP_COMPRESSION_H
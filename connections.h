@@ -4,112 +4,640 @@
 #include <netinet/in.h>
 #include <ctime>
 #include <utility>
-#include <map>
+#include <tuple>
+#include <functional>
 #include <queue>
+#include <stdexcept>
+#include <vector>
+
+#include "address_map.h"
+#include "client_store.h"
+#include "timer_wheel.h"
+#include "membership.h"
+#include "protocol.h"
+#include "topics.h"
 
 namespace sik {
     static const std::time_t TIMEOUT = 2 * 60;
+    /// Number of seconds in one rotation of the expiry timer wheel.
+    static const std::size_t EXPIRY_WHEEL_SIZE = 256u;
 
-    bool operator==(const sockaddr_in &a, const sockaddr_in &b) {
+    inline bool operator==(const sockaddr_in &a, const sockaddr_in &b) {
         return std::tie(a.sin_addr.s_addr, a.sin_port)
                == std::tie(b.sin_addr.s_addr, b.sin_port);
     }
 
+    /// Client limit meaning no limit.
+    const std::size_t NO_CLIENT_LIMIT = ~(std::size_t) 0;
+
+    /// Recipients are read from the membership history when its range for
+    /// the message is at most slots / HISTORY_SCAN_RATIO long, otherwise all
+    /// slots are scanned.
+    static const std::size_t HISTORY_SCAN_RATIO = 8u;
+
     class Connections {
     private:
-        using Interval = typename std::pair<std::time_t, std::time_t>;
+        using slot_t = ClientStore::slot_t;
+
+        /// Connected clients.
+        ClientStore clients{TIMEOUT};
+        /// Slot in clients for every client address.
+        AddressMap<slot_t> index;
+        /// Timers firing when the first interval of a client ends.
+        TimerWheel<EXPIRY_WHEEL_SIZE> expiry;
+        /// Connection intervals indexed by time, source of recipient lists
+        /// for messages which few of the clients should receive.
+        MembershipHistory history{TIMEOUT, TIMEOUT};
+        /// Clients subscribed to every topic.
+        TopicIndex topics;
+        /// Protocol extensions announced by the client of every slot.
+        std::vector<features_t> features;
+        /// Sequence number of the next datagram for the client of every
+        /// slot.
+        std::vector<uint32_t> sequences;
+        /// Messages the client of every slot missed, as they were dropped
+        /// from the full buffer.
+        std::vector<uint64_t> missed;
+        /// Interval ends of clients disconnected as unreachable, earliest on
+        /// top.
+        std::priority_queue<std::time_t, std::vector<std::time_t>,
+                std::greater<std::time_t>> disconnected;
+        /// Incremented every time the set of clients changes.
+        uint64_t generation = 0u;
+        /// Maximum number of clients.
+        std::size_t max_clients;
+        /// Number of clients added.
+        uint64_t admitted = 0u;
+        /// Number of clients removed to make room for new ones.
+        uint64_t evicted = 0u;
+
+        /**
+         * Removes client, its slot may be reused.
+         * @param key client address.
+         * @param slot client slot.
+         */
+        void remove_client(address_t key, slot_t slot) {
+            index.erase(key);
+            topics.unsubscribe(slot);
+            if (slot < features.size()) {
+                features[slot] = NO_FEATURES;
+            }
+            if (slot < sequences.size()) {
+                sequences[slot] = 0u;
+            }
+            if (slot < missed.size()) {
+                missed[slot] = 0u;
+            }
+            clients.remove(slot);
+            generation++;
+        }
+
+        /**
+         * Adds client or extends the timeout on existing one.
+         * @param key client address.
+         * @param connection_time time when client connected.
+         * @return client slot.
+         */
+        slot_t add(address_t key, std::time_t connection_time) {
+            history.add(key, connection_time);
+            slot_t *slot = index.find(key);
+            if (slot != nullptr) {
+                // Extending an interval does not touch its timer, the timer
+                // reschedules itself when it fires too early.
+                clients.connect(*slot, connection_time);
+                return *slot;
+            }
+            if (clients.size() >= max_clients) {
+                // Make room evicting the least recently active client.
+                slot_t victim = clients.least_recent();
+                remove_client(clients.key(victim), victim);
+                evicted++;
+            }
+            admitted++;
+            generation++;
+            slot_t added = clients.add(key, connection_time, generation);
+            index.insert(key, added);
+            // Timer is tagged with the generation the client joined at, so
+            // it is told apart from a timer of a removed client.
+            expiry.schedule(key, connection_time + TIMEOUT, generation);
+            return added;
+        }
+
+    public:
+        /**
+         * Constructs connections.
+         * @param max_clients maximum number of clients, when a new client
+         * comes the least recently active one is removed.
+         * @throws std::invalid_argument when max_clients is 0.
+         */
+        explicit Connections(std::size_t max_clients = NO_CLIENT_LIMIT)
+                : max_clients(max_clients) {
+            if (max_clients == 0u) {
+                throw std::invalid_argument("Client limit must be positive");
+            }
+        }
 
-        struct Client {
-            /// Client socket address
-            sockaddr_in address;
-            /// Intervals for which client should receive messages
-            std::queue<Interval> connections;
+        /**
+         * List of clients receiving a message, skipping the sender. Comes
+         * either from the part of the membership history holding intervals
+         * connected at the message arrival time, or from a bitmap of client
+         * slots selected with a scan over all clients, whichever is smaller.
+         * Lists for a single topic come from a copy of its subscribers.
+         * None allocates once the list is reused, and connections added
+         * meanwhile do not affect it.
+         */
+        class Recipients {
+            friend class Connections;
+        private:
+            using id_t = MembershipHistory::id_t;
+
+            /// Connections the recipients come from.
+            const Connections *connections = nullptr;
+            /// Generation of connections at the time the list was created.
+            uint64_t generation = 0u;
+            /// Message arrival time.
+            std::time_t timestamp = 0;
+            /// Address to skip.
+            address_t exclude = ~(address_t) 0;
+            /// Kinds of recipient lists.
+            enum class Source {
+                HISTORY, SLOTS, TOPIC
+            };
+
+            /// Where recipients come from.
+            Source source = Source::HISTORY;
+            /// Next interval to check.
+            id_t position = 0u;
+            /// Past the last interval to check.
+            id_t end = 0u;
+            /// Slots of recipients.
+            Bitmap selected;
+            /// Next slot to check.
+            std::size_t slot = 0u;
+            /// Slots of topic subscribers at the time the list was created.
+            std::vector<slot_t> subscribers;
 
             /**
-             * Constructs new client.
-             * @param address client address.
-             * @param timestamp first interval timestamp.
+             * Finds next recipient in the history range.
+             * @param key set to the recipient address.
+             * @return whether there was a recipient left.
              */
-            Client(sockaddr_in address, std::time_t timestamp)
-                    : address(std::move(address)) {
-                connections.push(
-                        std::make_pair(timestamp, timestamp + TIMEOUT));
+            bool next_interval(address_t &key) noexcept {
+                // Empty list, possibly never filled, has no connections.
+                if (position >= end) {
+                    return false;
+                }
+                const MembershipHistory &history = connections->history;
+                // Clients are expired only after all messages they should
+                // receive, so clients missing from the index were
+                // disconnected.
+                while (position < end) {
+                    const auto &interval = history.entry(position++);
+                    if (interval.start > timestamp) {
+                        // Range is sorted by start, nothing more to find.
+                        position = end;
+                    } else if (interval.key != exclude
+                               && history.contains(interval, timestamp)
+                               && connections->index.find(interval.key)
+                                  != nullptr) {
+                        key = interval.key;
+                        return true;
+                    }
+                }
+                return false;
             }
 
             /**
-             * Adds new connection or extends the last existing (if intervals
-             * would overlap).
-             * @param timestamp connected timestamp.
+             * Finds next recipient in the selected slots. Slots freed or
+             * reused since the selection are skipped.
+             * @param key set to the recipient address.
+             * @return whether there was a recipient left.
              */
-            void add_connection(std::time_t timestamp) noexcept {
-                if (connections.back().second >= timestamp) {
-                    connections.back().second = timestamp + TIMEOUT;
-                } else {
-                    connections.push(
-                            std::make_pair(timestamp, timestamp + TIMEOUT));
+            bool next_slot(address_t &key) noexcept {
+                const ClientStore &clients = connections->clients;
+                while ((slot = selected.find_next(slot)) != NO_BIT) {
+                    slot_t current = (slot_t) slot++;
+                    if (clients.is_used(current)
+                        && clients.joined_at(current) <= generation) {
+                        key = clients.key(current);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            /**
+             * Finds next recipient among the topic subscribers.
+             * @param key set to the recipient address.
+             * @return whether there was a recipient left.
+             */
+            bool next_subscriber(address_t &key) noexcept {
+                const ClientStore &clients = connections->clients;
+                while (slot < subscribers.size()) {
+                    slot_t current = subscribers[slot++];
+                    if (clients.is_used(current)
+                        && clients.joined_at(current) <= generation
+                        && clients.key(current) != exclude
+                        && clients.is_connected(current, timestamp)) {
+                        key = clients.key(current);
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+        public:
+            Recipients() = default;
+
+            /**
+             * Finds next recipient.
+             * @param key set to the recipient address.
+             * @return whether there was a recipient left.
+             */
+            bool next(address_t &key) noexcept {
+                switch (source) {
+                    case Source::SLOTS:
+                        return next_slot(key);
+                    case Source::TOPIC:
+                        return next_subscriber(key);
+                    default:
+                        return next_interval(key);
                 }
             }
+
+            /**
+             * @return whether all candidates were checked.
+             */
+            bool done() const noexcept {
+                switch (source) {
+                    case Source::SLOTS:
+                        return slot >= selected.size();
+                    case Source::TOPIC:
+                        return slot >= subscribers.size();
+                    default:
+                        return position >= end;
+                }
+            }
+
+            /**
+             * @return whether no clients joined or left since the list was
+             * created.
+             */
+            bool is_current() const noexcept {
+                return connections != nullptr
+                       && connections->generation == generation;
+            }
         };
 
         /**
-         * Checks if given time point is between bounds of interval.
-         * @param timestamp time point.
-         * @param interval interval.
-         * @return whether point is between interval bounds.
+         * Adds client or extends the timeout on existing one.
+         * @param address client address
+         * @param connection_time time when client connected.
          */
-        inline bool in_bounds(std::time_t timestamp,
-                       const Interval &interval) const noexcept {
-            return timestamp >= interval.first && timestamp <= interval.second;
+        void add_client(sockaddr_in address, std::time_t connection_time) {
+            add(pack_address(address), connection_time);
         }
 
-        /// Connected clients.
-        std::deque<Client> clients;
-    public:
         /**
-         * Adds client or extends the timeout on existing one.
+         * Adds client or extends the timeout on existing one, subscribing it
+         * to the topic.
          * @param address client address
          * @param connection_time time when client connected.
+         * @param topic character the client registered with.
          */
-        void add_client(sockaddr_in address, std::time_t connection_time) {
-            for (auto &client: clients) {
-                if (client.address == address) {
-                    client.add_connection(connection_time);
+        void add_client(sockaddr_in address, std::time_t connection_time,
+                        char topic) {
+            topics.subscribe(add(pack_address(address), connection_time),
+                             topic);
+        }
+
+        /**
+         * Records protocol extensions announced by the client with its last
+         * request.
+         * @param address connected client address.
+         * @param announced extensions understood by the client.
+         */
+        void set_features(sockaddr_in address, features_t announced) {
+            const slot_t *slot = index.find(pack_address(address));
+            if (slot == nullptr) {
+                return;
+            }
+            if (*slot >= features.size()) {
+                if (announced == NO_FEATURES) {
+                    return;
+                }
+                features.resize((std::size_t) *slot + 1u, NO_FEATURES);
+            }
+            features[*slot] = announced;
+        }
+
+        /**
+         * Adds to the extensions of a connected client, keeping the ones
+         * it announced.
+         * @param address connected client address.
+         * @param added extensions to add.
+         */
+        void add_features(sockaddr_in address, features_t added) {
+            const slot_t *slot = index.find(pack_address(address));
+            if (slot == nullptr) {
+                return;
+            }
+            if (*slot >= features.size()) {
+                features.resize((std::size_t) *slot + 1u, NO_FEATURES);
+            }
+            features[*slot] |= added;
+        }
+
+        /**
+         * @param key client address.
+         * @return protocol extensions understood by the client.
+         */
+        features_t get_features(address_t key) const noexcept {
+            const slot_t *slot = index.find(key);
+            if (slot == nullptr || *slot >= features.size()) {
+                return NO_FEATURES;
+            }
+            return features[*slot];
+        }
+
+        /**
+         * Takes sequence number for the next datagram sent to the client.
+         * @param key connected client address.
+         * @return sequence number.
+         */
+        uint32_t next_sequence(address_t key) {
+            const slot_t *slot = index.find(key);
+            if (slot == nullptr) {
+                return 0u;
+            }
+            if (*slot >= sequences.size()) {
+                sequences.resize((std::size_t) *slot + 1u, 0u);
+            }
+            return sequences[*slot]++;
+        }
+
+        /**
+         * Returns the last sequence number taken for a datagram which was
+         * not sent after all.
+         * @param key connected client address.
+         */
+        void rewind_sequence(address_t key) noexcept {
+            const slot_t *slot = index.find(key);
+            if (slot != nullptr && *slot < sequences.size()) {
+                sequences[*slot]--;
+            }
+        }
+
+        /**
+         * Counts message the client missed, as it was dropped from the full
+         * buffer.
+         * @param key connected client address.
+         */
+        void add_missed(address_t key) {
+            const slot_t *slot = index.find(key);
+            if (slot == nullptr) {
+                return;
+            }
+            if (*slot >= missed.size()) {
+                missed.resize((std::size_t) *slot + 1u, 0u);
+            }
+            missed[*slot]++;
+        }
+
+        /**
+         * @param key client address.
+         * @return number of messages the client missed.
+         */
+        uint64_t get_missed(address_t key) const noexcept {
+            const slot_t *slot = index.find(key);
+            if (slot == nullptr || *slot >= missed.size()) {
+                return 0u;
+            }
+            return missed[*slot];
+        }
+
+        /**
+         * Calls function for every client which missed messages.
+         * @tparam F function type.
+         * @param f function called with the address and number of missed
+         * messages.
+         */
+        template<typename F>
+        void visit_missed(F &&f) const {
+            for (std::size_t slot = 0u; slot < missed.size(); slot++) {
+                if (missed[slot] > 0u) {
+                    f(clients.key((slot_t) slot), missed[slot]);
+                }
+            }
+        }
+
+        /**
+         * Removes all intervals with end < timestamp and clients left without
+         * intervals. Only clients with timers due are visited, so the cost is
+         * amortized O(1) per interval. Timers of clients removed before,
+         * evicted or disconnected, are dropped. Should be called periodically
+         * with the arrival time of the oldest message not sent yet.
+         * @param timestamp time point.
+         */
+        void expire(std::time_t timestamp) {
+            history.prune(timestamp);
+            expiry.advance(timestamp - 1, [this, timestamp](address_t key,
+                                                            uint64_t joined) {
+                slot_t *slot = index.find(key);
+                if (slot == nullptr || clients.joined_at(*slot) != joined) {
                     return;
                 }
+                if (clients.expire(*slot, timestamp)) {
+                    expiry.schedule(key, clients.first_end(*slot), joined);
+                } else {
+                    remove_client(key, *slot);
+                }
+            });
+        }
+
+        /**
+         * Removes client reported as unreachable, cutting its intervals short,
+         * so lists of recipients created before skip it as well.
+         * @param address client address.
+         * @return whether client was connected.
+         */
+        bool disconnect(const sockaddr_in &address) {
+            address_t key = pack_address(address);
+            slot_t *slot = index.find(key);
+            if (slot == nullptr) {
+                return false;
+            }
+            disconnected.push(clients.last_end(*slot));
+            remove_client(key, *slot);
+            return true;
+        }
+
+        /**
+         * Counts disconnected clients whose intervals would still contain
+         * timestamp, forgetting ones ending earlier. Timestamps should not
+         * decrease between calls.
+         * @param timestamp message arrival time.
+         * @return number of clients the message is no longer sent to.
+         */
+        std::size_t count_disconnected(std::time_t timestamp) {
+            while (!disconnected.empty() && disconnected.top() < timestamp) {
+                disconnected.pop();
+            }
+            return disconnected.size();
+        }
+
+        /**
+         * @param key client address.
+         * @return whether client is tracked, whether connected or not.
+         */
+        bool has_client(address_t key) const noexcept {
+            return index.find(key) != nullptr;
+        }
+
+        /**
+         * Checks if client should receive messages which arrived at timestamp.
+         * @param key client address.
+         * @param timestamp time point.
+         * @return whether client has interval containing timestamp.
+         */
+        bool is_connected(address_t key, std::time_t timestamp) const noexcept {
+            const slot_t *slot = index.find(key);
+            return slot != nullptr && clients.is_connected(*slot, timestamp);
+        }
+
+        /**
+         * @return counter incremented on every membership change.
+         */
+        uint64_t get_generation() const noexcept {
+            return generation;
+        }
+
+        /**
+         * @return number of clients added.
+         */
+        uint64_t get_admitted() const noexcept {
+            return admitted;
+        }
+
+        /**
+         * @return number of clients removed to make room for new ones.
+         */
+        uint64_t get_evicted() const noexcept {
+            return evicted;
+        }
+
+        /**
+         * @return number of scheduled expiry timers, including timers of
+         * removed clients which have not fired yet.
+         */
+        std::size_t get_timers() const noexcept {
+            return expiry.size();
+        }
+
+        /**
+         * @return number of tracked clients.
+         */
+        std::size_t size() const noexcept {
+            return clients.size();
+        }
+
+        /**
+         * @return client store, for reading client addresses by slot.
+         */
+        const ClientStore &get_store() const noexcept {
+            return clients;
+        }
+
+        /**
+         * Fills list of clients with intervals containing timestamp. Does not
+         * modify connections, so lists for many messages may be used at once.
+         * @param timestamp message arrival time.
+         * @param exclude client to exclude from recipients.
+         * @param recipients list to fill, its memory is reused.
+         */
+        void get_recipients(std::time_t timestamp, const sockaddr_in *exclude,
+                            Recipients &recipients) const {
+            recipients.connections = this;
+            recipients.generation = generation;
+            recipients.timestamp = timestamp;
+            recipients.exclude = exclude == nullptr ? ~(address_t) 0
+                                                    : pack_address(*exclude);
+
+            auto ids = history.range(timestamp);
+            recipients.position = ids.first;
+            recipients.end = ids.second;
+            recipients.subscribers.clear();
+            recipients.source = ids.second - ids.first
+                                > clients.slots() / HISTORY_SCAN_RATIO
+                                ? Recipients::Source::SLOTS
+                                : Recipients::Source::HISTORY;
+            if (recipients.source == Recipients::Source::SLOTS) {
+                recipients.position = recipients.end;
+                recipients.slot = 0u;
+                clients.select(timestamp, recipients.selected);
+                const slot_t *sender = exclude == nullptr
+                                       ? nullptr
+                                       : index.find(recipients.exclude);
+                if (sender != nullptr) {
+                    recipients.selected.reset(*sender);
+                }
             }
-            clients.push_back(Client(address, connection_time));
+        }
+
+        /**
+         * Fills list of clients subscribed to the topic with intervals
+         * containing timestamp. Costs O(subscribers of the topic).
+         * @param timestamp message arrival time.
+         * @param exclude client to exclude from recipients.
+         * @param topic message character.
+         * @param recipients list to fill, its memory is reused.
+         */
+        void get_recipients(std::time_t timestamp, const sockaddr_in *exclude,
+                            char topic, Recipients &recipients) const {
+            recipients.connections = this;
+            recipients.generation = generation;
+            recipients.timestamp = timestamp;
+            recipients.exclude = exclude == nullptr ? ~(address_t) 0
+                                                    : pack_address(*exclude);
+            recipients.source = Recipients::Source::TOPIC;
+            recipients.position = recipients.end = 0u;
+            recipients.slot = 0u;
+            const std::vector<slot_t> &subscribers
+                    = topics.get_subscribers(topic);
+            recipients.subscribers.assign(subscribers.begin(),
+                                          subscribers.end());
+        }
+
+        /**
+         * Creates list of clients with intervals containing timestamp.
+         * @param timestamp message arrival time.
+         * @param exclude client to exclude from recipients.
+         * @return recipients of the message.
+         */
+        Recipients get_recipients(std::time_t timestamp,
+                                  const sockaddr_in *exclude = nullptr) const {
+            Recipients recipients;
+            get_recipients(timestamp, exclude, recipients);
+            return recipients;
         }
 
         /**
          * Searches for clients with intervals containing timestamp.
-         * Performs cleanup removing all intervals with end < timestamp.
+         * Does not remove old intervals, see expire.
          * @param timestamp current timestamp
          * @param exclude client to exclude from connections.
          * @return list of clients to send message to
          */
-        std::queue<sockaddr_in> get_clients(std::time_t timestamp,
-                                            sockaddr_in *exclude = nullptr) {
+        std::queue<sockaddr_in> get_clients(
+                std::time_t timestamp,
+                const sockaddr_in *exclude = nullptr) const {
             std::queue<sockaddr_in> the_clients;
-            auto it = clients.begin();
-            while (it != clients.end()) {
-                auto &client = *it;
-                if (exclude != nullptr && client.address == *exclude) {
-                    it++;
-                    continue;
-                }
-                while (client.connections.size() > 0
-                       && client.connections.front().second < timestamp) {
-                    client.connections.pop();
-                }
-                if (client.connections.size() == 0) {
-                    clients.erase(it++);
-                    continue;
-                } else if (in_bounds(timestamp, client.connections.front())) {
-                    the_clients.push(client.address);
-                }
-                it++;
+            Recipients recipients = get_recipients(timestamp, exclude);
+            address_t key;
+            while (recipients.next(key)) {
+                the_clients.push(unpack_address(key));
             }
-            return std::move(the_clients);
+            return the_clients;
         }
     };
 }
@@ -0,0 +1,190 @@
+#ifndef SIK_UDP_COOKIES_H
+#define SIK_UDP_COOKIES_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <endian.h>
+
+#include "address_map.h"
+#include "protocol.h"
+
+namespace sik {
+    /// Cookie lifetime meaning requests are not validated.
+    const std::time_t NO_COOKIES = 0;
+    /// Seconds a cookie is valid for at least, it is valid at most twice
+    /// as long.
+    const std::time_t COOKIE_LIFETIME = 60;
+
+    /**
+     * @param value value to rotate.
+     * @param bits number of bits.
+     * @return value rotated left.
+     */
+    inline uint64_t rotate_left(uint64_t value, unsigned bits) noexcept {
+        return (value << bits) | (value >> (64u - bits));
+    }
+
+    /**
+     * Single SipHash round.
+     * @param v internal state.
+     */
+    inline void sip_round(uint64_t (&v)[4]) noexcept {
+        v[0] += v[1];
+        v[1] = rotate_left(v[1], 13u);
+        v[1] ^= v[0];
+        v[0] = rotate_left(v[0], 32u);
+        v[2] += v[3];
+        v[3] = rotate_left(v[3], 16u);
+        v[3] ^= v[2];
+        v[0] += v[3];
+        v[3] = rotate_left(v[3], 21u);
+        v[3] ^= v[0];
+        v[2] += v[1];
+        v[1] = rotate_left(v[1], 17u);
+        v[1] ^= v[2];
+        v[2] = rotate_left(v[2], 32u);
+    }
+
+    /**
+     * Computes SipHash-2-4, a keyed hash which cannot be forged without the
+     * key.
+     * @param k0 first half of the key, from its first 8 bytes read as a
+     * little endian number.
+     * @param k1 second half of the key.
+     * @param data data to hash.
+     * @param length data length.
+     * @return hash.
+     */
+    inline uint64_t siphash24(uint64_t k0, uint64_t k1, const char *data,
+                              std::size_t length) noexcept {
+        uint64_t v[4] = {k0 ^ 0x736f6d6570736575ull,
+                         k1 ^ 0x646f72616e646f6dull,
+                         k0 ^ 0x6c7967656e657261ull,
+                         k1 ^ 0x7465646279746573ull};
+        std::size_t end = length - length % 8u;
+        for (std::size_t i = 0u; i < end; i += 8u) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            word = le64toh(word);
+            v[3] ^= word;
+            sip_round(v);
+            sip_round(v);
+            v[0] ^= word;
+        }
+
+        uint64_t last = (uint64_t) length << 56u;
+        for (std::size_t i = end; i < length; i++) {
+            last |= (uint64_t) (uint8_t) data[i] << (8u * (i - end));
+        }
+        v[3] ^= last;
+        sip_round(v);
+        sip_round(v);
+        v[0] ^= last;
+
+        v[2] ^= 0xffu;
+        for (int i = 0; i < 4; i++) {
+            sip_round(v);
+        }
+        return v[0] ^ v[1] ^ v[2] ^ v[3];
+    }
+
+    /**
+     * Issues and validates cookies proving that a client receives datagrams
+     * sent to its address. A cookie is a keyed hash of the address and of
+     * the current lifetime period, so nothing is stored per client and
+     * a validation is a single hash computation. Cookies of the previous
+     * period are still valid, so every cookie is accepted for at least the
+     * lifetime.
+     */
+    class CookieJar {
+    private:
+        /// Seconds a cookie is valid for at least, NO_COOKIES if disabled.
+        std::time_t lifetime;
+        /// First half of the secret key.
+        uint64_t k0 = 0u;
+        /// Second half of the secret key.
+        uint64_t k1 = 0u;
+
+        /**
+         * @param key client address.
+         * @param period number of the lifetime period.
+         * @return cookie for the address in the period, never NO_COOKIE.
+         */
+        cookie_t cookie(address_t key, uint64_t period) const noexcept {
+            uint64_t words[2] = {htole64(key), htole64(period)};
+            cookie_t hash = siphash24(k0, k1, (const char *) words,
+                                      sizeof(words));
+            return hash == NO_COOKIE ? 1u : hash;
+        }
+
+        /**
+         * @param now current time.
+         * @return number of the current lifetime period.
+         */
+        uint64_t period(std::time_t now) const noexcept {
+            return (uint64_t) now / (uint64_t) lifetime;
+        }
+
+    public:
+        /**
+         * Constructs cookie jar with a random secret key.
+         * @param lifetime seconds a cookie is valid for at least, NO_COOKIES
+         * disables validation.
+         */
+        explicit CookieJar(std::time_t lifetime = NO_COOKIES)
+                : lifetime(lifetime) {
+            if (is_enabled()) {
+                std::random_device random;
+                k0 = ((uint64_t) random() << 32u) | random();
+                k1 = ((uint64_t) random() << 32u) | random();
+            }
+        }
+
+        /**
+         * Constructs cookie jar with the given secret key.
+         * @param lifetime seconds a cookie is valid for at least.
+         * @param k0 first half of the key.
+         * @param k1 second half of the key.
+         */
+        CookieJar(std::time_t lifetime, uint64_t k0, uint64_t k1) noexcept
+                : lifetime(lifetime), k0(k0), k1(k1) {}
+
+        /**
+         * @return whether requests are validated at all.
+         */
+        bool is_enabled() const noexcept {
+            return lifetime != NO_COOKIES;
+        }
+
+        /**
+         * @param key client address.
+         * @param now current time.
+         * @return cookie for the client.
+         */
+        cookie_t issue(address_t key, std::time_t now) const noexcept {
+            return cookie(key, period(now));
+        }
+
+        /**
+         * @param key client address.
+         * @param echoed cookie echoed by the client.
+         * @param now current time.
+         * @return whether cookie was issued for the address recently.
+         */
+        bool is_valid(address_t key, cookie_t echoed,
+                      std::time_t now) const noexcept {
+            if (echoed == NO_COOKIE) {
+                return false;
+            }
+            uint64_t current = period(now);
+            return echoed == cookie(key, current)
+                   || (current > 0u && echoed == cookie(key, current - 1u));
+        }
+    };
+}
+
+#endif //SIK_UDP_COOKIES_H
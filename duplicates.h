@@ -0,0 +1,200 @@
+#ifndef SIK_UDP_DUPLICATES_H
+#define SIK_UDP_DUPLICATES_H
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include "address_map.h"
+#include "protocol.h"
+
+namespace sik {
+    /// Window meaning duplicate requests are not suppressed.
+    const std::time_t NO_DUPLICATE_WINDOW = 0;
+    /// Number of requests remembered in a single generation by default.
+    const std::size_t DUPLICATE_FILTER_CAPACITY = 1u << 14u;
+    /// Maximum window, an hour.
+    const std::time_t MAX_DUPLICATE_WINDOW = 3600;
+    /// Maximum number of buckets probed for a request.
+    const std::size_t DUPLICATE_FILTER_PROBES = 8u;
+    /// Fingerprint marking an empty bucket.
+    const uint64_t EMPTY_FINGERPRINT = 0u;
+
+    /**
+     * Remembers requests received recently, so repeated ones are not sent
+     * to every client again. Requests are kept as 64-bit fingerprints of
+     * their sender, timestamp and character, in two fixed tables: the
+     * current generation and the previous one. Generations rotate every
+     * window seconds, so a request is remembered for at least the window
+     * and at most twice as long. When all buckets probed for a request are
+     * taken, the first of them is overwritten, so a full table forgets
+     * requests rather than suppresses new ones.
+     */
+    class DuplicateFilter {
+    private:
+        /// Seconds a generation lasts, NO_DUPLICATE_WINDOW if disabled.
+        std::time_t window;
+        /// Fingerprints of the current generation.
+        std::vector<uint64_t> current;
+        /// Fingerprints of the previous generation.
+        std::vector<uint64_t> previous;
+        /// Bucket index mask.
+        std::size_t mask;
+        /// Start of the current generation.
+        std::time_t started = 0;
+        /// Number of suppressed requests.
+        uint64_t suppressed = 0u;
+
+        /**
+         * Mixes bits, so close timestamps and ports spread evenly.
+         * @param value value to mix.
+         * @return mixed value.
+         */
+        static uint64_t mix(uint64_t value) noexcept {
+            value ^= value >> 33u;
+            value *= 0xff51afd7ed558ccdull;
+            value ^= value >> 33u;
+            value *= 0xc4ceb9fe1a85ec53ull;
+            value ^= value >> 33u;
+            return value;
+        }
+
+        /**
+         * @param sender client address.
+         * @param timestamp request timestamp.
+         * @param character request character.
+         * @return fingerprint of the request, never EMPTY_FINGERPRINT.
+         */
+        static uint64_t fingerprint(address_t sender, timestamp_t timestamp,
+                                    char character) noexcept {
+            uint64_t hash = mix(sender ^ mix(timestamp * 256u
+                                             + (uint8_t) character));
+            return hash == EMPTY_FINGERPRINT ? 1u : hash;
+        }
+
+        /**
+         * @param table generation.
+         * @param hash request fingerprint.
+         * @return whether generation holds the request.
+         */
+        bool contains(const std::vector<uint64_t> &table,
+                      uint64_t hash) const noexcept {
+            for (std::size_t probe = 0u; probe < DUPLICATE_FILTER_PROBES;
+                 probe++) {
+                uint64_t bucket = table[(hash + probe) & mask];
+                if (bucket == hash) {
+                    return true;
+                } else if (bucket == EMPTY_FINGERPRINT) {
+                    return false;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Adds request to the current generation.
+         * @param hash request fingerprint.
+         */
+        void insert(uint64_t hash) noexcept {
+            for (std::size_t probe = 0u; probe < DUPLICATE_FILTER_PROBES;
+                 probe++) {
+                uint64_t &bucket = current[(hash + probe) & mask];
+                if (bucket == EMPTY_FINGERPRINT) {
+                    bucket = hash;
+                    return;
+                }
+            }
+            current[hash & mask] = hash;
+        }
+
+        /**
+         * Starts new generation once the current one lasted the window.
+         * @param now current time.
+         */
+        void rotate(std::time_t now) noexcept {
+            if (now < started + window) {
+                return;
+            }
+            if (now < started + 2 * window) {
+                current.swap(previous);
+            } else {
+                // Both generations are older than the window.
+                std::fill(previous.begin(), previous.end(),
+                          EMPTY_FINGERPRINT);
+            }
+            std::fill(current.begin(), current.end(), EMPTY_FINGERPRINT);
+            started = now;
+        }
+
+    public:
+        /**
+         * Constructs filter.
+         * @param window seconds requests are remembered for at least,
+         * NO_DUPLICATE_WINDOW disables the filter.
+         * @param capacity number of requests in a generation, rounded up
+         * to a power of two.
+         * @throws std::invalid_argument when window is negative.
+         */
+        explicit DuplicateFilter(std::time_t window = NO_DUPLICATE_WINDOW,
+                                 std::size_t capacity
+                                 = DUPLICATE_FILTER_CAPACITY)
+                : window(window) {
+            if (window < 0) {
+                throw std::invalid_argument("Window must not be negative");
+            }
+            std::size_t buckets = DUPLICATE_FILTER_PROBES;
+            while (buckets < capacity) {
+                buckets *= 2u;
+            }
+            if (is_enabled()) {
+                current.assign(buckets, EMPTY_FINGERPRINT);
+                previous.assign(buckets, EMPTY_FINGERPRINT);
+            }
+            mask = buckets - 1u;
+        }
+
+        /**
+         * @return whether requests are filtered at all.
+         */
+        bool is_enabled() const noexcept {
+            return window != NO_DUPLICATE_WINDOW;
+        }
+
+        /**
+         * Checks whether the client sent the same request within the
+         * window, remembering the request if not.
+         * @param sender client address.
+         * @param timestamp request timestamp.
+         * @param character request character.
+         * @param now current time.
+         * @return whether request is a repeat and should be suppressed.
+         */
+        bool is_repeated(address_t sender, timestamp_t timestamp,
+                         char character, std::time_t now) noexcept {
+            if (!is_enabled()) {
+                return false;
+            }
+            rotate(now);
+            uint64_t hash = fingerprint(sender, timestamp, character);
+            if (contains(current, hash) || contains(previous, hash)) {
+                suppressed++;
+                return true;
+            }
+            insert(hash);
+            return false;
+        }
+
+        /**
+         * @return number of suppressed requests.
+         */
+        uint64_t get_suppressed() const noexcept {
+            return suppressed;
+        }
+    };
+}
+
+#endif //SIK_UDP_DUPLICATES_H
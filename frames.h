@@ -0,0 +1,226 @@
+#ifndef SIK_UDP_FRAMES_H
+#define SIK_UDP_FRAMES_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "address_map.h"
+#include "protocol.h"
+#include "communication.h"
+
+namespace sik {
+    /// Frame budget meaning messages are never packed.
+    const std::size_t NO_FRAMES = 0u;
+
+    /**
+     * Packs messages for the same client into frames of at most budget
+     * bytes. A frame is closed when the next message does not fit, or when
+     * flush is called at the end of a burst. Frames holding a single message
+     * are sent as that message alone, so without bursts datagrams do not
+     * change. Closed frames wait in order in the ready queue.
+     */
+    class FramePacker {
+    private:
+        /**
+         * Frame being filled for a client.
+         */
+        struct OpenFrame {
+            /// Client address.
+            address_t key;
+            /// First message, sent alone if nothing joins it.
+            Datagram first;
+            /// Frame with all messages, built once the second one comes.
+            Frame frame;
+        };
+
+        /// Maximum frame length.
+        std::size_t budget;
+        /// Position in open of the frame of every client.
+        AddressMap<uint32_t> positions;
+        /// Frames being filled.
+        std::vector<OpenFrame> open;
+        /// Closed frames waiting to be sent.
+        std::vector<AddressedDatagram> ready;
+        /// First frame in ready not sent yet.
+        std::size_t ready_position = 0u;
+        /// Number of frames closed with more than one message.
+        uint64_t frames = 0u;
+        /// Number of messages sent in those frames.
+        uint64_t framed_messages = 0u;
+
+        /**
+         * @param frame open frame.
+         * @return current frame length.
+         */
+        static std::size_t frame_length(const OpenFrame &frame) noexcept {
+            if (frame.frame.count() == 0u) {
+                return FRAME_HEADER_SIZE
+                       + Frame::entry_length(frame.first.length());
+            }
+            return frame.frame.length();
+        }
+
+        /**
+         * Moves frame to the ready queue.
+         * @param frame open frame.
+         */
+        void close(OpenFrame &frame) {
+            if (frame.frame.count() == 0u) {
+                ready.push_back({frame.key, std::move(frame.first)});
+                return;
+            }
+            frames++;
+            framed_messages += frame.frame.count();
+            ready.push_back({frame.key, frame.frame.to_datagram()});
+        }
+
+        /**
+         * Removes open frame of the client, moving the last open frame into
+         * its position.
+         * @param key client address.
+         */
+        void forget(address_t key) {
+            uint32_t position = *positions.find(key);
+            positions.erase(key);
+            if (position + 1u != open.size()) {
+                open[position] = std::move(open.back());
+                *positions.find(open[position].key) = position;
+            }
+            open.pop_back();
+        }
+
+    public:
+        /**
+         * Constructs packer.
+         * @param budget maximum frame length, NO_FRAMES disables packing.
+         */
+        explicit FramePacker(std::size_t budget = NO_FRAMES) : budget(budget) {}
+
+        /**
+         * @return whether messages are packed at all.
+         */
+        bool is_enabled() const noexcept {
+            return budget != NO_FRAMES;
+        }
+
+        /**
+         * Adds message for the client, closing its frame first if the message
+         * does not fit. Messages too long for any frame are ready at once.
+         * @param key client address.
+         * @param datagram message to send.
+         */
+        void append(address_t key, const Datagram &datagram) {
+            std::size_t entry = Frame::entry_length(datagram.length());
+            if (FRAME_HEADER_SIZE + entry > budget) {
+                push(key, datagram);
+                return;
+            }
+
+            uint32_t *position = positions.find(key);
+            if (position == nullptr) {
+                positions.insert(key, (uint32_t) open.size());
+                open.push_back({key, datagram, Frame()});
+                return;
+            }
+            OpenFrame &frame = open[*position];
+            if (frame_length(frame) + entry > budget
+                || frame.frame.count() == MAX_FRAME_MESSAGES) {
+                close(frame);
+                frame.first = datagram;
+                frame.frame = Frame();
+                return;
+            }
+            if (frame.frame.count() == 0u) {
+                frame.frame = Frame(budget);
+                frame.frame.append(frame.first.data(), frame.first.length());
+                frame.first = Datagram();
+            }
+            frame.frame.append(datagram.data(), datagram.length());
+        }
+
+        /**
+         * Queues datagram to be sent as it is, after the open frame of the
+         * client, so messages for the client keep their order.
+         * @param key client address.
+         * @param datagram datagram to send.
+         */
+        void push(address_t key, const Datagram &datagram) {
+            const uint32_t *position = positions.find(key);
+            if (position != nullptr) {
+                close(open[*position]);
+                forget(key);
+            }
+            ready.push_back({key, datagram});
+        }
+
+        /**
+         * Closes all open frames.
+         */
+        void flush() {
+            for (OpenFrame &frame: open) {
+                close(frame);
+                positions.erase(frame.key);
+            }
+            open.clear();
+        }
+
+        /**
+         * @return whether there are frames to send.
+         */
+        bool has_ready() const noexcept {
+            return ready_position < ready.size();
+        }
+
+        /**
+         * @return frames to send, in order.
+         */
+        const AddressedDatagram *next_ready() const noexcept {
+            return ready.data() + ready_position;
+        }
+
+        /**
+         * @return number of frames to send.
+         */
+        std::size_t ready_count() const noexcept {
+            return ready.size() - ready_position;
+        }
+
+        /**
+         * Removes frames from the front of the ready queue.
+         * @param count number of frames sent or dropped.
+         */
+        void pop_ready(std::size_t count) noexcept {
+            ready_position += count;
+            if (ready_position >= ready.size()) {
+                ready.clear();
+                ready_position = 0u;
+            }
+        }
+
+        /**
+         * @return number of clients with open frames.
+         */
+        std::size_t open_count() const noexcept {
+            return open.size();
+        }
+
+        /**
+         * @return number of frames with more than one message.
+         */
+        uint64_t get_frames() const noexcept {
+            return frames;
+        }
+
+        /**
+         * @return number of messages sent in frames.
+         */
+        uint64_t get_framed_messages() const noexcept {
+            return framed_messages;
+        }
+    };
+}
+
+#endif //SIK_UDP_FRAMES_H
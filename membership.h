@@ -0,0 +1,224 @@
+#ifndef SIK_UDP_MEMBERSHIP_H
+#define SIK_UDP_MEMBERSHIP_H
+
+
+#include <ctime>
+#include <cstdint>
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <utility>
+
+#include "address_map.h"
+
+namespace sik {
+    /**
+     * Time indexed log of client connection intervals, answering which
+     * clients were connected at a given time point without modifying any
+     * state.
+     *
+     * Intervals are appended to the log in the order of their start. Every
+     * checkpoint_interval seconds a checkpoint copies intervals still open to
+     * the end of the log, so intervals connected at time t are always found
+     * in the log range between the last checkpoint before t and the next one.
+     * The range is sorted by start, so a query costs a binary search over
+     * checkpoints plus the intervals it visits.
+     */
+    class MembershipHistory {
+    public:
+        /// Identifier of an interval in the log.
+        using id_t = uint64_t;
+
+        struct Entry {
+            /// Client address.
+            address_t key;
+            /// First second of the interval.
+            std::time_t start;
+            /// Last second of the interval.
+            std::time_t end;
+        };
+
+    private:
+        struct Checkpoint {
+            /// Time the checkpoint was made at.
+            std::time_t time;
+            /// First interval in the log copied or added after the time.
+            id_t begin;
+        };
+
+        /// Length of a connection interval.
+        std::time_t timeout;
+        /// Minimal time between checkpoints.
+        std::time_t checkpoint_interval;
+
+        /// Intervals ordered by start between consecutive checkpoints.
+        std::deque<Entry> log;
+        /// Identifier of the first interval in the log.
+        id_t first_id = 0u;
+        /// Checkpoints ordered by time.
+        std::deque<Checkpoint> checkpoints;
+        /// Latest interval of every client with an interval that may be open.
+        AddressMap<id_t> latest;
+        /// Start of the latest interval.
+        std::time_t last_start = std::numeric_limits<std::time_t>::min();
+        /// Intervals ending before this time are forgotten.
+        std::time_t horizon = std::numeric_limits<std::time_t>::min();
+
+        /**
+         * @return identifier the next interval will get.
+         */
+        id_t next_id() const noexcept {
+            return first_id + log.size();
+        }
+
+        /**
+         * Makes checkpoint, copying all intervals open at given time.
+         * @param time checkpoint time.
+         */
+        void checkpoint(std::time_t time) {
+            id_t from = checkpoints.empty() ? first_id
+                                            : checkpoints.back().begin;
+            id_t to = next_id();
+            checkpoints.push_back(Checkpoint{time, to});
+            for (id_t id = from; id < to; id++) {
+                Entry copy = entry(id);
+                id_t *last = latest.find(copy.key);
+                bool is_latest = last != nullptr && *last == id;
+                if (copy.end >= time) {
+                    if (is_latest) {
+                        *last = next_id();
+                    }
+                    log.push_back(copy);
+                } else if (is_latest) {
+                    latest.erase(copy.key);
+                }
+            }
+        }
+
+    public:
+        /**
+         * Constructs empty history.
+         * @param timeout length of a connection interval.
+         * @param checkpoint_interval minimal time between checkpoints.
+         */
+        MembershipHistory(std::time_t timeout,
+                          std::time_t checkpoint_interval) noexcept
+                : timeout(timeout), checkpoint_interval(checkpoint_interval) {}
+
+        /**
+         * Adds connection of the client, extending its last interval if it
+         * has not ended yet. Time points going back are treated as the time
+         * of the latest connection.
+         * @param key client address.
+         * @param timestamp connection time.
+         */
+        void add(address_t key, std::time_t timestamp) {
+            timestamp = std::max(timestamp, last_start);
+            if (checkpoints.empty()
+                || timestamp >= checkpoints.back().time + checkpoint_interval) {
+                checkpoint(timestamp);
+            }
+
+            auto inserted = latest.insert(key, next_id());
+            if (!inserted.second) {
+                Entry &last = log[*inserted.first - first_id];
+                if (last.end >= timestamp) {
+                    last.end = timestamp + timeout;
+                    return;
+                }
+                *inserted.first = next_id();
+            }
+            log.push_back(Entry{key, timestamp, timestamp + timeout});
+            last_start = timestamp;
+        }
+
+        /**
+         * Forgets intervals ending before timestamp. Queries for earlier time
+         * points only see intervals lasting at least until timestamp.
+         * @param timestamp time point.
+         */
+        void prune(std::time_t timestamp) {
+            horizon = std::max(horizon, timestamp);
+            while (checkpoints.size() > 1 && checkpoints[1].time < horizon) {
+                checkpoints.pop_front();
+            }
+            while (!checkpoints.empty() && first_id < checkpoints[0].begin) {
+                log.pop_front();
+                first_id++;
+            }
+        }
+
+        /**
+         * Finds log range containing all intervals connected at timestamp.
+         * Range is sorted by start.
+         * @param timestamp time point.
+         * @return first and past the last interval of the range.
+         */
+        std::pair<id_t, id_t> range(std::time_t timestamp) const noexcept {
+            if (checkpoints.empty()) {
+                return std::make_pair(first_id, first_id);
+            }
+            auto it = std::upper_bound(
+                    checkpoints.begin(), checkpoints.end(), timestamp,
+                    [](std::time_t time, const Checkpoint &checkpoint) {
+                        return time < checkpoint.time;
+                    });
+            if (it != checkpoints.begin()) {
+                --it;
+            }
+            id_t begin = it->begin;
+            ++it;
+            return std::make_pair(begin,
+                                  it == checkpoints.end() ? next_id()
+                                                          : it->begin);
+        }
+
+        /**
+         * @param id interval identifier, must be in the log.
+         * @return interval.
+         */
+        const Entry &entry(id_t id) const noexcept {
+            return log[id - first_id];
+        }
+
+        /**
+         * Checks if interval is connected at timestamp.
+         * @param interval interval from the log.
+         * @param timestamp time point.
+         * @return whether interval contains timestamp.
+         */
+        bool contains(const Entry &interval,
+                      std::time_t timestamp) const noexcept {
+            return interval.start <= timestamp
+                   && interval.end >= std::max(timestamp, horizon);
+        }
+
+        /**
+         * Calls function for every client connected at timestamp.
+         * @param timestamp time point.
+         * @param f function called with client address.
+         */
+        template<typename F>
+        void visit(std::time_t timestamp, F &&f) const {
+            auto ids = range(timestamp);
+            for (id_t id = ids.first; id < ids.second; id++) {
+                const Entry &interval = entry(id);
+                if (interval.start > timestamp) {
+                    break;
+                }
+                if (contains(interval, timestamp)) {
+                    f(interval.key);
+                }
+            }
+        }
+
+        /**
+         * @return number of intervals in the log.
+         */
+        std::size_t size() const noexcept {
+            return log.size();
+        }
+    };
+}
+
+#endif //SIK_UDP_MEMBERSHIP_H
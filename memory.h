@@ -0,0 +1,145 @@
+#ifndef SIK_UDP_MEMORY_H
+#define SIK_UDP_MEMORY_H
+
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <memory>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+namespace sik {
+    /// Size of a huge page on x86-64 Linux - 2MB.
+    const std::size_t HUGE_PAGE_SIZE = 2u * 1024u * 1024u;
+
+    /**
+     * Fixed size array allocated directly from the kernel, backed by 2MB huge
+     * pages when possible. Falls back to regular pages with transparent huge
+     * pages advice when no explicit huge pages are reserved in the system.
+     * Memory is pre-faulted on allocation so the first pass over the array
+     * does not pay for page faults.
+     * @tparam T type of element.
+     */
+    template<typename T>
+    class HugePageArray {
+    private:
+        /// Array elements.
+        T *data = nullptr;
+        /// Number of elements.
+        std::size_t length = 0u;
+        /// Size of the mapped memory in bytes.
+        std::size_t mapped = 0u;
+        /// Whether memory is backed by explicit huge pages.
+        bool huge_pages = false;
+
+        /**
+         * Maps anonymous memory of the given size.
+         * @param bytes size of the mapping.
+         * @param flags additional mmap flags.
+         * @return mapped memory or MAP_FAILED.
+         */
+        static void *map(std::size_t bytes, int flags) noexcept {
+            return mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | flags,
+                        -1, 0);
+        }
+
+        /**
+         * Allocates memory for the elements, trying huge pages first.
+         * @throws std::bad_alloc when memory cannot be mapped.
+         */
+        void allocate() {
+            std::size_t bytes = length * sizeof(T);
+            mapped = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE
+                     * HUGE_PAGE_SIZE;
+
+            void *memory = map(mapped, MAP_HUGETLB);
+            huge_pages = memory != MAP_FAILED;
+            if (!huge_pages) {
+                memory = map(mapped, 0);
+                if (memory == MAP_FAILED) {
+                    throw std::bad_alloc();
+                }
+                madvise(memory, mapped, MADV_HUGEPAGE);
+            }
+            data = static_cast<T *>(memory);
+        }
+
+    public:
+        /**
+         * Allocates array and default constructs all elements.
+         * @param length number of elements.
+         * @throws std::invalid_argument when length is zero or too big.
+         * @throws std::bad_alloc when memory cannot be mapped.
+         */
+        explicit HugePageArray(std::size_t length) : length(length) {
+            if (length == 0 || length > (std::numeric_limits<std::size_t>::max()
+                                        - HUGE_PAGE_SIZE) / sizeof(T)) {
+                throw std::invalid_argument("Invalid array length");
+            }
+            allocate();
+            std::size_t i = 0u;
+            try {
+                for (; i < length; i++) {
+                    new(data + i) T();
+                }
+            } catch (...) {
+                while (i > 0) {
+                    data[--i].~T();
+                }
+                munmap(data, mapped);
+                throw;
+            }
+        }
+
+        HugePageArray(const HugePageArray &) = delete;
+
+        HugePageArray &operator=(const HugePageArray &) = delete;
+
+        /**
+         * Destroys all elements and releases memory.
+         */
+        ~HugePageArray() {
+            for (std::size_t i = 0u; i < length; i++) {
+                data[i].~T();
+            }
+            munmap(data, mapped);
+        }
+
+        /**
+         * Access the array element.
+         * @param index element index.
+         * @return element at the index.
+         */
+        T &operator[](std::size_t index) noexcept {
+            return data[index];
+        }
+
+        /**
+         * Access the array element.
+         * @param index element index.
+         * @return element at the index.
+         */
+        const T &operator[](std::size_t index) const noexcept {
+            return data[index];
+        }
+
+        /**
+         * @return number of elements.
+         */
+        std::size_t size() const noexcept {
+            return length;
+        }
+
+        /**
+         * @return whether memory is backed by explicit huge pages.
+         */
+        bool is_huge() const noexcept {
+            return huge_pages;
+        }
+    };
+}
+
+#endif //SIK_UDP_MEMORY_H
@@ -0,0 +1,342 @@
+#ifndef SIK_UDP_PARITY_H
+#define SIK_UDP_PARITY_H
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/utility/string_view.hpp>
+
+#include "address_map.h"
+#include "protocol.h"
+#include "simd.h"
+
+namespace sik {
+    /// Group size meaning no parity is sent.
+    const std::size_t NO_PARITY = 0u;
+    /// Smallest number of datagrams protected by a single parity.
+    const std::size_t MIN_PARITY_GROUP = 2u;
+    /// Largest number of datagrams protected by a single parity.
+    const std::size_t MAX_PARITY_GROUP = 32u;
+    /// Number of the latest datagrams kept by a client, enough for the group
+    /// of a parity which came after datagrams of the next group.
+    const std::size_t PARITY_WINDOW = 2u * MAX_PARITY_GROUP;
+
+    /**
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @return whether datagram is a parity of numbered datagrams.
+     */
+    inline bool is_parity(const char *bytes, std::size_t length) noexcept {
+        return length > 0u && bytes[0] == PARITY_MARKER;
+    }
+
+    /**
+     * Computes parity of consecutive numbered datagrams sent to a client
+     * which announced FEATURE_PARITY:
+     * - 1 byte PARITY_MARKER
+     * - 4 bytes as sequence number of the first datagram (uint32_t in big
+     *   endian)
+     * - 1 byte as number of datagrams
+     * - 4 bytes as XOR of the datagram lengths (uint32_t in big endian)
+     * - XOR of the datagrams without sequence numbers, each padded with
+     *   zeros to the longest one
+     * Any single datagram of the group may be rebuilt from the others and
+     * the parity.
+     * @param first sequence number of the first datagram.
+     * @param group datagrams, at most MAX_PARITY_GROUP.
+     * @return parity datagram.
+     */
+    inline Datagram parity_datagram(uint32_t first,
+                                    const std::vector<Datagram> &group) {
+        std::size_t longest = 0u;
+        uint32_t lengths = 0u;
+        for (const Datagram &datagram: group) {
+            longest = std::max(longest, datagram.length());
+            lengths ^= (uint32_t) datagram.length();
+        }
+        std::string bytes(PARITY_HEADER_SIZE + longest, '\0');
+        ParitySchema::encode(&bytes[0], PARITY_MARKER, first,
+                             (uint8_t) group.size(), lengths);
+        for (const Datagram &datagram: group) {
+            xor_into(&bytes[PARITY_HEADER_SIZE], datagram.data(),
+                     datagram.length());
+        }
+        return Datagram(std::move(bytes));
+    }
+
+    /**
+     * Collects numbered datagrams sent to every client into groups of
+     * consecutive sequence numbers, aligned to multiples of the group size,
+     * and computes parity of every complete group. Datagrams are shared
+     * with the ones being sent until the group completes. A group missing
+     * a datagram, e.g. one the client joined in the middle of, gets no
+     * parity.
+     */
+    class ParityEncoder {
+    private:
+        /**
+         * Datagrams of the current group of a client.
+         */
+        struct Group {
+            /// Sequence number of the first datagram.
+            uint32_t first = 0u;
+            /// Datagrams in order.
+            std::vector<Datagram> datagrams;
+        };
+
+        /// Number of datagrams in a group, NO_PARITY if disabled.
+        std::size_t group_size;
+        /// Current group of every client.
+        AddressMap<Group> clients;
+        /// Clients removed by prune.
+        std::vector<address_t> removed;
+        /// Number of parity datagrams computed.
+        uint64_t parities = 0u;
+        /// Number of groups with parity too long for a datagram.
+        uint64_t oversized = 0u;
+
+    public:
+        /**
+         * Constructs encoder.
+         * @param group_size number of datagrams protected by a parity,
+         * NO_PARITY disables parity.
+         * @throws std::invalid_argument when group size is out of range.
+         */
+        explicit ParityEncoder(std::size_t group_size = NO_PARITY)
+                : group_size(group_size) {
+            if (is_enabled() && (group_size < MIN_PARITY_GROUP
+                                 || group_size > MAX_PARITY_GROUP)) {
+                throw std::invalid_argument("Invalid parity group size");
+            }
+        }
+
+        /**
+         * @return whether parity is computed at all.
+         */
+        bool is_enabled() const noexcept {
+            return group_size != NO_PARITY;
+        }
+
+        /**
+         * Adds datagram sent to the client.
+         * @param key client address.
+         * @param sequence sequence number the datagram was sent with.
+         * @param datagram datagram without the sequence number.
+         * @param parity set to parity of the group the datagram completes.
+         * @return whether group was completed.
+         */
+        bool add(address_t key, uint32_t sequence, const Datagram &datagram,
+                 Datagram &parity) {
+            Group &group = *clients.insert(key, Group()).first;
+            std::size_t index = sequence % group_size;
+            if (index == 0u) {
+                group.first = sequence;
+                group.datagrams.clear();
+            }
+            if (group.first != sequence - index
+                || group.datagrams.size() != index) {
+                group.datagrams.clear();
+                return false;
+            }
+            group.datagrams.push_back(datagram);
+            if (group.datagrams.size() < group_size) {
+                return false;
+            }
+
+            bool fits = true;
+            for (const Datagram &member: group.datagrams) {
+                fits &= member.length() + PARITY_HEADER_SIZE
+                        <= MAX_FRAME_LENGTH;
+            }
+            if (fits) {
+                parity = parity_datagram(group.first, group.datagrams);
+                parities++;
+            } else {
+                oversized++;
+            }
+            group.datagrams.clear();
+            return fits;
+        }
+
+        /**
+         * Forgets groups of clients which no longer get parity.
+         * @tparam F predicate type.
+         * @param keep predicate returning whether the client still gets
+         * parity.
+         */
+        template<typename F>
+        void prune(F &&keep) {
+            removed.clear();
+            clients.visit([&](address_t key, const Group &) {
+                if (!keep(key)) {
+                    removed.push_back(key);
+                }
+            });
+            for (address_t key: removed) {
+                clients.erase(key);
+            }
+        }
+
+        /**
+         * @return number of parity datagrams computed.
+         */
+        uint64_t get_parities() const noexcept {
+            return parities;
+        }
+
+        /**
+         * @return number of groups with parity too long for a datagram.
+         */
+        uint64_t get_oversized() const noexcept {
+            return oversized;
+        }
+    };
+
+    /**
+     * Keeps the latest numbered datagrams received from the server and
+     * rebuilds the single datagram of a group missing when its parity comes.
+     * Datagrams are kept only once the server sent a parity, so clients of
+     * servers which send none do not copy datagrams.
+     */
+    class ParityDecoder {
+    private:
+        /**
+         * Datagram received from the server.
+         */
+        struct Kept {
+            /// Whether entry holds a datagram.
+            bool valid = false;
+            /// Sequence number of the datagram.
+            uint32_t sequence = 0u;
+            /// Datagram without the sequence number.
+            std::string bytes;
+        };
+
+        /// Latest datagrams, indexed by sequence number modulo the window.
+        std::vector<Kept> ring;
+        /// Whether any parity came.
+        bool active = false;
+        /// Last datagram rebuilt, with its sequence number.
+        std::string rebuilt;
+        /// Number of datagrams rebuilt.
+        uint64_t recovered = 0u;
+        /// Number of groups missing more than a single datagram.
+        uint64_t unrecoverable = 0u;
+
+        /**
+         * @param sequence sequence number.
+         * @return datagram kept with the sequence number or nullptr.
+         */
+        const Kept *find(uint32_t sequence) const noexcept {
+            const Kept &kept = ring[sequence % PARITY_WINDOW];
+            return kept.valid && kept.sequence == sequence ? &kept : nullptr;
+        }
+
+    public:
+        ParityDecoder() : ring(PARITY_WINDOW) {}
+
+        /**
+         * Keeps datagram received from the server.
+         * @param sequence its sequence number.
+         * @param datagram datagram without the sequence number.
+         */
+        void keep(uint32_t sequence, boost::string_view datagram) {
+            if (!active) {
+                return;
+            }
+            Kept &kept = ring[sequence % PARITY_WINDOW];
+            kept.valid = true;
+            kept.sequence = sequence;
+            kept.bytes.assign(datagram.data(), datagram.length());
+        }
+
+        /**
+         * Rebuilds datagram of the group missing, if exactly one is.
+         * @param bytes parity datagram.
+         * @param length parity datagram length.
+         * @param datagram set to the rebuilt datagram preceded by its
+         * sequence number, as if it came from the server, valid until the
+         * next call.
+         * @return whether a datagram was rebuilt.
+         * @throws std::invalid_argument when datagram is not a valid parity
+         * or does not match the datagrams kept.
+         */
+        bool rebuild(const char *bytes, std::size_t length,
+                     boost::string_view &datagram) {
+            if (length < PARITY_HEADER_SIZE || !is_parity(bytes, length)) {
+                throw std::invalid_argument("Invalid parity");
+            }
+            uint32_t first = ParitySchema::get<PARITY_FIRST>(bytes);
+            std::size_t count = ParitySchema::get<PARITY_COUNT>(bytes);
+            if (count < MIN_PARITY_GROUP || count > MAX_PARITY_GROUP) {
+                throw std::invalid_argument("Invalid parity group size");
+            }
+            if (!active) {
+                // Datagrams of this group were not kept.
+                active = true;
+                return false;
+            }
+
+            uint32_t missing = first;
+            std::size_t absent = 0u;
+            for (uint32_t sequence = first; sequence != first + count;
+                 sequence++) {
+                if (find(sequence) == nullptr) {
+                    missing = sequence;
+                    absent++;
+                }
+            }
+            if (absent != 1u) {
+                unrecoverable += absent > 1u ? 1u : 0u;
+                return false;
+            }
+
+            std::size_t padded = length - PARITY_HEADER_SIZE;
+            rebuilt.assign(SEQUENCE_HEADER_SIZE, '\0');
+            write_sequence(&rebuilt[0], missing);
+            rebuilt.append(bytes + PARITY_HEADER_SIZE, padded);
+            std::size_t rebuilt_length
+                    = ParitySchema::get<PARITY_LENGTH>(bytes);
+            for (uint32_t sequence = first; sequence != first + count;
+                 sequence++) {
+                const Kept *kept = find(sequence);
+                if (kept == nullptr) {
+                    continue;
+                }
+                if (kept->bytes.length() > padded) {
+                    throw std::invalid_argument("Parity shorter than datagram");
+                }
+                xor_into(&rebuilt[SEQUENCE_HEADER_SIZE], kept->bytes.data(),
+                         kept->bytes.length());
+                rebuilt_length ^= kept->bytes.length();
+            }
+            if (rebuilt_length > padded) {
+                throw std::invalid_argument("Parity shorter than datagram");
+            }
+            rebuilt.resize(SEQUENCE_HEADER_SIZE + rebuilt_length);
+            recovered++;
+            datagram = rebuilt;
+            return true;
+        }
+
+        /**
+         * @return number of datagrams rebuilt.
+         */
+        uint64_t get_recovered() const noexcept {
+            return recovered;
+        }
+
+        /**
+         * @return number of groups missing more than a single datagram.
+         */
+        uint64_t get_unrecoverable() const noexcept {
+            return unrecoverable;
+        }
+    };
+}
+
+#endif //SIK_UDP_PARITY_H
@@ -0,0 +1,191 @@
+#ifndef SIK_UDP_PARSE_SERVER_H
+#define SIK_UDP_PARSE_SERVER_H
+
+
+#include <ctime>
+#include <string>
+#include <boost/lexical_cast.hpp>
+
+#include "chunks.h"
+#include "duplicates.h"
+#include "parity.h"
+#include "parse.h"
+#include "protocol.h"
+#include "retransmission.h"
+#include "slow_clients.h"
+
+namespace sik {
+    /**
+     * Converts string to buffer size.
+     * @param input string to convert.
+     * @return buffer size.
+     * @throws ArgumentException if input is not a positive number.
+     */
+    std::size_t parse_buffer_size(const std::string &input) {
+        try {
+            std::size_t size = boost::lexical_cast<std::size_t>(input);
+            if (boost::lexical_cast<std::string>(size) != input || size == 0) {
+                throw ParseException(
+                        "Buffer size must be a positive integer");
+            }
+            return size;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException("Buffer size must be a positive integer");
+        }
+    }
+
+    /**
+     * Converts string to client limit.
+     * @param input string to convert.
+     * @return maximum number of clients.
+     * @throws ParseException if input is not a positive number.
+     */
+    std::size_t parse_client_limit(const std::string &input) {
+        try {
+            std::size_t limit = boost::lexical_cast<std::size_t>(input);
+            if (boost::lexical_cast<std::string>(limit) != input
+                || limit == 0) {
+                throw ParseException("Client limit must be a positive integer");
+            }
+            return limit;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException("Client limit must be a positive integer");
+        }
+    }
+
+    /**
+     * Converts string to frame budget.
+     * @param input string to convert.
+     * @return maximum length of a frame.
+     * @throws ParseException if input is not a positive number up to
+     * MAX_FRAME_LENGTH.
+     */
+    std::size_t parse_frame_budget(const std::string &input) {
+        const std::string error = "Frame budget must be an integer between 1"
+                                  " and " + std::to_string(MAX_FRAME_LENGTH);
+        try {
+            std::size_t budget = boost::lexical_cast<std::size_t>(input);
+            if (boost::lexical_cast<std::string>(budget) != input
+                || budget == 0 || budget > MAX_FRAME_LENGTH) {
+                throw ParseException(error);
+            }
+            return budget;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException(error);
+        }
+    }
+
+    /**
+     * Converts string to chunk size.
+     * @param input string to convert.
+     * @return maximum length of a chunk.
+     * @throws ParseException if input is not a number between MIN_CHUNK_SIZE
+     * and MAX_FRAME_LENGTH.
+     */
+    std::size_t parse_chunk_size(const std::string &input) {
+        const std::string error = "Chunk size must be an integer between "
+                                  + std::to_string(MIN_CHUNK_SIZE) + " and "
+                                  + std::to_string(MAX_FRAME_LENGTH);
+        try {
+            std::size_t size = boost::lexical_cast<std::size_t>(input);
+            if (boost::lexical_cast<std::string>(size) != input
+                || size < MIN_CHUNK_SIZE || size > MAX_FRAME_LENGTH) {
+                throw ParseException(error);
+            }
+            return size;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException(error);
+        }
+    }
+
+    /**
+     * Converts string to duplicate request window.
+     * @param input string to convert.
+     * @return seconds repeated requests are suppressed for.
+     * @throws ParseException if input is not a positive number up to
+     * MAX_DUPLICATE_WINDOW.
+     */
+    std::time_t parse_duplicate_window(const std::string &input) {
+        const std::string error = "Duplicate window must be an integer between"
+                                  " 1 and "
+                                  + std::to_string(MAX_DUPLICATE_WINDOW);
+        try {
+            std::time_t window = boost::lexical_cast<std::time_t>(input);
+            if (boost::lexical_cast<std::string>(window) != input
+                || window <= 0 || window > MAX_DUPLICATE_WINDOW) {
+                throw ParseException(error);
+            }
+            return window;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException(error);
+        }
+    }
+
+    /**
+     * Converts string to retransmission rate.
+     * @param input string to convert.
+     * @return datagrams sent again per second.
+     * @throws ParseException if input is not a positive number up to
+     * MAX_RETRANSMISSION_RATE.
+     */
+    uint32_t parse_retransmission_rate(const std::string &input) {
+        const std::string error = "Retransmission rate must be an integer"
+                                  " between 1 and "
+                                  + std::to_string(MAX_RETRANSMISSION_RATE);
+        try {
+            uint64_t rate = boost::lexical_cast<uint64_t>(input);
+            if (boost::lexical_cast<std::string>(rate) != input
+                || rate == 0u || rate > MAX_RETRANSMISSION_RATE) {
+                throw ParseException(error);
+            }
+            return (uint32_t) rate;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException(error);
+        }
+    }
+
+    /**
+     * Converts string to parity group size.
+     * @param input string to convert.
+     * @return number of datagrams protected by a single parity.
+     * @throws ParseException if input is not a number between
+     * MIN_PARITY_GROUP and MAX_PARITY_GROUP.
+     */
+    std::size_t parse_parity_group(const std::string &input) {
+        const std::string error = "Parity group must be an integer between "
+                                  + std::to_string(MIN_PARITY_GROUP) + " and "
+                                  + std::to_string(MAX_PARITY_GROUP);
+        try {
+            std::size_t size = boost::lexical_cast<std::size_t>(input);
+            if (boost::lexical_cast<std::string>(size) != input
+                || size < MIN_PARITY_GROUP || size > MAX_PARITY_GROUP) {
+                throw ParseException(error);
+            }
+            return size;
+        } catch (const boost::bad_lexical_cast &) {
+            throw ParseException(error);
+        }
+    }
+
+    /**
+     * Converts string to slow client action.
+     * @param input one of "none", "skip", "defer" or "suspend".
+     * @return slow client action.
+     * @throws ParseException if input is not a known action.
+     */
+    SlowClientAction parse_slow_client_action(const std::string &input) {
+        if (input == "none") {
+            return SlowClientAction::NONE;
+        } else if (input == "skip") {
+            return SlowClientAction::SKIP;
+        } else if (input == "defer") {
+            return SlowClientAction::DEFER;
+        } else if (input == "suspend") {
+            return SlowClientAction::SUSPEND;
+        }
+        throw ParseException(
+                "Slow client policy must be none, skip, defer or suspend");
+    }
+}
+
+#endif //SIK_UDP_PARSE_SERVER_H
@@ -0,0 +1,110 @@
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../connections.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+/**
+ * @param start measurement start.
+ * @param operations number of measured operations.
+ * @return nanoseconds per operation.
+ */
+double ns_per_op(bench_clock::time_point start, std::size_t operations) {
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / operations;
+}
+
+/**
+ * Measures registering new clients, refreshing known clients and fan-out
+ * for given number of clients.
+ * @param count number of clients.
+ */
+void bench(std::size_t count) {
+    std::vector<sockaddr_in> addresses(count);
+    for (std::size_t i = 0; i < count; i++) {
+        addresses[i] = sik::unpack_address(
+                (sik::address_t) (0x0a000000u + i / 1000u) << 16u | i % 1000u);
+    }
+
+    sik::Connections connections;
+    std::time_t now = 1000;
+
+    auto start = bench_clock::now();
+    for (const sockaddr_in &address: addresses) {
+        connections.add_client(address, now);
+    }
+    double add_new = ns_per_op(start, count);
+
+    start = bench_clock::now();
+    for (const sockaddr_in &address: addresses) {
+        connections.add_client(address, now + 1);
+    }
+    double add_known = ns_per_op(start, count);
+
+    start = bench_clock::now();
+    std::size_t recipients = 0u;
+    auto list = connections.get_recipients(now + 1);
+    sik::address_t key;
+    while (list.next(key)) {
+        recipients++;
+    }
+    double fan_out = ns_per_op(start, recipients);
+
+    std::cout << count << " clients: add new " << add_new
+              << " ns, add known " << add_known
+              << " ns, recipients " << fan_out << " ns per client\n";
+}
+
+/**
+ * @return resident set size of the process in bytes.
+ */
+std::size_t resident_bytes() {
+    std::size_t pages = 0u, resident = 0u;
+    std::ifstream statm("/proc/self/statm");
+    statm >> pages >> resident;
+    return resident * (std::size_t) sysconf(_SC_PAGESIZE);
+}
+
+/**
+ * Measures memory used per tracked client, then replaces all clients with
+ * new ones several times, checking that memory is reused.
+ * @param count number of clients.
+ * @param rounds number of times the clients are replaced.
+ */
+void churn(std::size_t count, std::size_t rounds) {
+    sik::Connections connections;
+    std::time_t now = 1000;
+    std::size_t before = resident_bytes();
+
+    for (std::size_t round = 0; round < rounds; round++) {
+        for (std::size_t i = 0; i < count; i++) {
+            connections.add_client(sik::unpack_address(
+                    (sik::address_t) (round << 24u | i) << 16u | 20160u), now);
+        }
+        std::size_t tracked = connections.size();
+        std::size_t resident = resident_bytes();
+        if (round == 0) {
+            std::cout << count << " clients: "
+                      << (double) (resident - before) / tracked
+                      << " bytes per tracked client\n";
+        }
+        std::cout << "churn round " << round << ": " << tracked
+                  << " clients, RSS " << resident / (1024u * 1024u) << " MB\n";
+
+        now += sik::TIMEOUT + 1;
+        connections.expire(now);
+    }
+}
+
+int main() {
+    for (std::size_t count: {1000u, 100000u, 1000000u}) {
+        bench(count);
+    }
+    churn(1000000u, 10u);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../parity.h"
+#include "../sequence.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+/// Number of datagrams sent through the lossy transport for every setting.
+const std::size_t DATAGRAMS = 200000u;
+/// Number of distinct datagrams sent in turn.
+const std::size_t POOL = 256u;
+/// Length of the buffers XORed in the kernel measurement, a typical MTU.
+const std::size_t XOR_LENGTH = 1500u;
+/// Times every kernel is run.
+const std::size_t XOR_ROUNDS = 1u << 20u;
+
+/**
+ * @param start measurement start.
+ * @param operations number of measured operations.
+ * @return nanoseconds per operation.
+ */
+double ns_per_op(bench_clock::time_point start, std::size_t operations) {
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / operations;
+}
+
+/**
+ * Transport dropping every datagram with the same probability, in process.
+ */
+class LossyTransport {
+private:
+    std::mt19937 random;
+    std::bernoulli_distribution drop;
+
+public:
+    /**
+     * @param loss probability a datagram is lost.
+     */
+    explicit LossyTransport(double loss) : random(42u), drop(loss) {}
+
+    /**
+     * @return whether the next datagram arrives.
+     */
+    bool deliver() {
+        return !drop(random);
+    }
+};
+
+/**
+ * Measures XOR of two MTU sized buffers with the kernel given.
+ * @param name name printed with the results.
+ * @param kernel XOR function.
+ */
+template<typename Kernel>
+void bench_xor(const char *name, Kernel kernel) {
+    std::vector<char> destination(XOR_LENGTH + 1u), source(XOR_LENGTH + 1u);
+    for (std::size_t i = 0u; i <= XOR_LENGTH; i++) {
+        source[i] = (char) i;
+    }
+    // Unaligned like datagram bytes after a header.
+    auto start = bench_clock::now();
+    for (std::size_t round = 0u; round < XOR_ROUNDS; round++) {
+        kernel(destination.data() + 1u, source.data() + 1u, XOR_LENGTH);
+    }
+    double ns = ns_per_op(start, XOR_ROUNDS);
+    std::cout << std::setw(8) << name << ": " << ns << " ns per "
+              << XOR_LENGTH << " bytes, " << XOR_LENGTH / ns << " GB/s"
+              << " (checksum " << (int) destination[XOR_LENGTH / 2u] << ")\n";
+}
+
+/**
+ * Sends datagrams with parity through the lossy transport and prints loss
+ * left after rebuilding and the parity overhead.
+ * @param pool datagrams sent in turn.
+ * @param group_size datagrams protected by a parity, NO_PARITY for none.
+ * @param loss probability a datagram is lost.
+ */
+void bench_loss(const std::vector<sik::Datagram> &pool,
+                std::size_t group_size, double loss) {
+    sik::ParityEncoder encoder(group_size);
+    sik::ParityDecoder decoder;
+    sik::SequenceTracker tracker;
+    LossyTransport transport(loss);
+    uint64_t data_bytes = 0u, parity_bytes = 0u;
+
+    // The decoder keeps datagrams once it saw a parity.
+    sik::Datagram first = sik::parity_datagram(0u, {pool[0], pool[1]});
+    boost::string_view rebuilt;
+    decoder.rebuild(first.data(), first.length(), rebuilt);
+
+    auto receive = [&](uint32_t sequence, boost::string_view datagram) {
+        uint32_t missing;
+        if (tracker.record(sequence, missing)) {
+            decoder.keep(sequence, datagram);
+        }
+    };
+    auto start = bench_clock::now();
+    for (uint32_t sequence = 0u; sequence < DATAGRAMS; sequence++) {
+        const sik::Datagram &datagram = pool[sequence % POOL];
+        data_bytes += sik::SEQUENCE_HEADER_SIZE + datagram.length();
+        if (transport.deliver()) {
+            receive(sequence, boost::string_view(datagram.data(),
+                                                 datagram.length()));
+        }
+        sik::Datagram parity;
+        if (!encoder.is_enabled()
+            || !encoder.add(1u, sequence, datagram, parity)) {
+            continue;
+        }
+        parity_bytes += parity.length();
+        uint32_t number;
+        if (!transport.deliver()
+            || !decoder.rebuild(parity.data(), parity.length(), rebuilt)) {
+            continue;
+        }
+        if (!sik::read_sequence(rebuilt.data(), rebuilt.length(), number)) {
+            std::cerr << "Rebuilt datagram has no sequence number\n";
+            std::exit(1);
+        }
+        rebuilt.remove_prefix(sik::SEQUENCE_HEADER_SIZE);
+        receive(number, rebuilt);
+    }
+    double ns = ns_per_op(start, DATAGRAMS);
+
+    // Datagrams lost at the very beginning are not counted by the tracker.
+    uint64_t lost = DATAGRAMS - tracker.get_received();
+    std::cout << std::setw(6) << group_size << std::setw(8) << loss * 100.0
+              << "%" << std::setw(12) << 100.0 * lost / DATAGRAMS << "%"
+              << std::setw(11) << 100.0 * parity_bytes / data_bytes << "%"
+              << std::setw(11) << decoder.get_recovered()
+              << std::setw(10) << ns << " ns\n";
+}
+
+int main() {
+    bench_xor("scalar", sik::xor_into_scalar);
+#ifdef SIK_UDP_X86
+    if (sik::has_sse2()) {
+        bench_xor("sse2", sik::xor_into_sse2);
+    }
+    if (sik::has_avx2()) {
+        bench_xor("avx2", sik::xor_into_avx2);
+    }
+#endif
+    bench_xor("xor_into", sik::xor_into);
+
+    // Message lengths of a typical file content, up to an MTU.
+    std::mt19937 random(7u);
+    std::uniform_int_distribution<std::size_t> length(200u, 1400u);
+    std::vector<sik::Datagram> pool;
+    for (std::size_t i = 0u; i < POOL; i++) {
+        std::string bytes(length(random), '\0');
+        for (char &c: bytes) {
+            c = (char) random();
+        }
+        pool.emplace_back(std::move(bytes));
+    }
+
+    std::cout << "\n group    loss    residual   overhead  recovered"
+                 "  per datagram\n";
+    for (double loss: {0.001, 0.01, 0.05, 0.1}) {
+        for (std::size_t group_size: {sik::NO_PARITY, (std::size_t) 4u,
+                                      (std::size_t) 8u, (std::size_t) 16u,
+                                      (std::size_t) 32u}) {
+            bench_loss(pool, group_size, loss);
+        }
+    }
+    return 0;
+}
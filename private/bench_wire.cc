@@ -0,0 +1,112 @@
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../protocol.h"
+
+using bench_clock = std::chrono::steady_clock;
+
+/// Number of headers encoded and decoded in every measurement.
+const std::size_t HEADERS = 1u << 20u;
+/// Times every measurement is repeated.
+const std::size_t ROUNDS = 20u;
+
+/**
+ * @param start measurement start.
+ * @param operations number of measured operations.
+ * @return nanoseconds per operation.
+ */
+double ns_per_op(bench_clock::time_point start, std::size_t operations) {
+    std::chrono::duration<double, std::nano> elapsed = bench_clock::now() - start;
+    return elapsed.count() / operations;
+}
+
+/**
+ * Header encoding as Message::to_bytes did it before the wire schema.
+ * @param bytes output.
+ * @param timestamp message timestamp.
+ * @param character message character.
+ */
+void legacy_encode(char *bytes, sik::timestamp_t timestamp, char character) {
+    sik::timestamp_t big_endian = htobe64(timestamp);
+    std::memcpy(bytes, &big_endian, sizeof(big_endian));
+    bytes[sizeof(sik::timestamp_t)] = character;
+}
+
+/**
+ * Header decoding as the byte array constructor of Message did it before
+ * the wire schema.
+ * @param bytes encoded header.
+ * @param timestamp set to the message timestamp.
+ * @param character set to the message character.
+ */
+void legacy_decode(const char *bytes, sik::timestamp_t &timestamp,
+                   char &character) {
+    sik::timestamp_t big_endian;
+    std::memcpy(&big_endian, bytes, sizeof(big_endian));
+    timestamp = be64toh(big_endian);
+    character = bytes[sizeof(sik::timestamp_t)];
+}
+
+/**
+ * Measures encoding and decoding of headers packed one after another, so
+ * most of them are unaligned, with the function pair given.
+ * @param name name printed with the results.
+ * @param encode header encoder.
+ * @param decode header decoder.
+ */
+template<typename Encode, typename Decode>
+void bench(const char *name, Encode encode, Decode decode) {
+    const std::size_t size = sik::HeaderSchema::size;
+    std::vector<char> bytes(HEADERS * size);
+    double encoding = 0.0, decoding = 0.0;
+    uint64_t checksum = 0u;
+    for (std::size_t round = 0u; round < ROUNDS; round++) {
+        auto start = bench_clock::now();
+        for (std::size_t i = 0u; i < HEADERS; i++) {
+            encode(&bytes[i * size], (sik::timestamp_t) (i + round),
+                   (char) ('a' + i % 26u));
+        }
+        encoding += ns_per_op(start, HEADERS);
+
+        start = bench_clock::now();
+        for (std::size_t i = 0u; i < HEADERS; i++) {
+            sik::timestamp_t timestamp;
+            char character;
+            decode(&bytes[i * size], timestamp, character);
+            checksum += timestamp ^ (uint8_t) character;
+        }
+        decoding += ns_per_op(start, HEADERS);
+    }
+    std::cout << name << ": encode " << encoding / ROUNDS << " ns, decode "
+              << decoding / ROUNDS << " ns per header (checksum " << checksum
+              << ")\n";
+}
+
+int main() {
+    bench("hand-coded", legacy_encode, legacy_decode);
+    bench("WireSchema",
+          [](char *bytes, sik::timestamp_t timestamp, char character) {
+              sik::HeaderSchema::encode(bytes, timestamp, character);
+          },
+          [](const char *bytes, sik::timestamp_t &timestamp, char &character) {
+              timestamp = sik::HeaderSchema::get<sik::HEADER_TIMESTAMP>(bytes);
+              character = sik::HeaderSchema::get<sik::HEADER_CHARACTER>(bytes);
+          });
+
+    // Whole Message path: validation and content handling included.
+    sik::Message message(0u, 'a', "");
+    std::string datagram = message.to_bytes();
+    auto start = bench_clock::now();
+    std::size_t valid = 0u;
+    for (std::size_t i = 0u; i < HEADERS; i++) {
+        sik::MessageView view(datagram.data(), datagram.length());
+        valid += view.get_character() == 'a';
+        message.write_bytes(&datagram[0]);
+    }
+    std::cout << "MessageView and write_bytes: " << ns_per_op(start, HEADERS)
+              << " ns per header (" << valid << " valid)\n";
+    return 0;
+}
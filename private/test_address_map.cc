@@ -0,0 +1,65 @@
+#include <arpa/inet.h>
+#include "catch.hpp"
+#include "../address_map.h"
+
+TEST_CASE("pack_address and unpack_address are inverse", "[AddressMap]") {
+    sockaddr_in address;
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr("192.168.0.10");
+    address.sin_port = htons(10012u);
+
+    sockaddr_in unpacked = sik::unpack_address(sik::pack_address(address));
+    CHECK(unpacked.sin_family == AF_INET);
+    CHECK(unpacked.sin_addr.s_addr == address.sin_addr.s_addr);
+    REQUIRE(unpacked.sin_port == address.sin_port);
+}
+
+TEST_CASE("AddressMap insert and find work", "[AddressMap]") {
+    sik::AddressMap<int> map;
+    CHECK(map.find(42u) == nullptr);
+
+    auto inserted = map.insert(42u, 1);
+    CHECK(inserted.second);
+    CHECK(*inserted.first == 1);
+
+    inserted = map.insert(42u, 2);
+    CHECK_FALSE(inserted.second);
+    CHECK(*inserted.first == 1);
+    CHECK(map.size() == 1);
+    REQUIRE(*map.find(42u) == 1);
+}
+
+TEST_CASE("AddressMap erase removes keys", "[AddressMap]") {
+    sik::AddressMap<int> map;
+    map.insert(1u, 1);
+    map.insert(2u, 2);
+    CHECK(map.erase(1u));
+    CHECK_FALSE(map.erase(1u));
+    CHECK(map.find(1u) == nullptr);
+    CHECK(*map.find(2u) == 2);
+    REQUIRE(map.size() == 1);
+}
+
+TEST_CASE("AddressMap keeps all entries while growing and shrinking", "[AddressMap]") {
+    sik::AddressMap<sik::address_t> map;
+    const sik::address_t count = 100000u;
+    for (sik::address_t key = 0u; key < count; key++) {
+        map.insert(key << 16u | 20160u, key);
+    }
+    CHECK(map.size() == count);
+    CHECK(map.capacity() / 8u * 7u >= count);
+
+    bool all_erased = true;
+    for (sik::address_t key = 0u; key < count; key += 2) {
+        all_erased &= map.erase(key << 16u | 20160u);
+    }
+    CHECK(all_erased);
+
+    bool all_found = true;
+    for (sik::address_t key = 0u; key < count; key++) {
+        const sik::address_t *value = map.find(key << 16u | 20160u);
+        all_found &= key % 2 == 0 ? value == nullptr : *value == key;
+    }
+    CHECK(all_found);
+    REQUIRE(map.size() == count / 2);
+}
@@ -0,0 +1,83 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "catch.hpp"
+#include "../arena.h"
+
+TEST_CASE("MonotonicArena reuses memory after reset", "[Arena]") {
+    sik::MonotonicArena arena(1024u);
+    void *first = arena.allocate(100u);
+    void *aligned = arena.allocate(8u, 64u);
+    CHECK((uintptr_t) aligned % 64u == 0u);
+    CHECK(aligned != first);
+
+    arena.allocate(4096u);
+    CHECK(arena.capacity() > 1024u);
+    std::size_t capacity = arena.capacity();
+
+    arena.reset();
+    CHECK(arena.allocate(100u) == first);
+    arena.allocate(8u, 64u);
+    arena.allocate(4096u);
+    REQUIRE(arena.capacity() == capacity);
+}
+
+TEST_CASE("ObjectPool recycles freed chunks", "[Arena]") {
+    sik::ObjectPool<24u, 8u, 4u> pool;
+    std::vector<void *> chunks;
+    for (int i = 0; i < 5; i++) {
+        chunks.push_back(pool.allocate());
+    }
+    CHECK(pool.size() == 5u);
+    CHECK(pool.capacity() == 8u);
+
+    pool.deallocate(chunks[2]);
+    CHECK(pool.allocate() == chunks[2]);
+    for (void *chunk: chunks) {
+        pool.deallocate(chunk);
+    }
+    CHECK(pool.size() == 0u);
+    REQUIRE(pool.capacity() == 8u);
+}
+
+TEST_CASE("PoolAllocator takes single objects from a pool", "[Arena]") {
+    std::shared_ptr<int> value = std::allocate_shared<int>(
+            sik::PoolAllocator<int>(), 42);
+    CHECK(*value == 42);
+    value.reset();
+    std::shared_ptr<int> other = std::allocate_shared<int>(
+            sik::PoolAllocator<int>(), 7);
+    CHECK(*other == 7);
+
+    std::vector<int, sik::PoolAllocator<int>> values;
+    for (int i = 0; i < 100; i++) {
+        values.push_back(i);
+    }
+    REQUIRE(values[99] == 99);
+}
+
+TEST_CASE("StringPool keeps released strings up to its limits", "[Arena]") {
+    sik::StringPool pool(2u, 1024u);
+    std::string *first = pool.acquire();
+    first->assign(100u, 'a');
+    pool.release(first);
+    CHECK(pool.size() == 1u);
+
+    std::string *reused = pool.acquire();
+    CHECK(reused == first);
+    CHECK(reused->empty());
+    CHECK(reused->capacity() >= 100u);
+    CHECK(pool.size() == 0u);
+
+    std::string *large = pool.acquire();
+    large->assign(2048u, 'b');
+    pool.release(large);
+    CHECK(pool.size() == 0u);
+
+    pool.release(reused);
+    pool.release(pool.acquire());
+    pool.release(new std::string());
+    pool.release(new std::string());
+    REQUIRE(pool.size() == 2u);
+}
@@ -131,4 +131,38 @@ TEST_CASE("Buffer range based for loop works", "[Buffer]") {
         i++;
     }
     REQUIRE(i == 5);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Buffer with runtime capacity is initialized", "[Buffer]") {
+    Buffer<int, DYNAMIC_BUFFER_SIZE> buffer(4);
+    CHECK(buffer.capacity() == 4);
+    REQUIRE(buffer.size() == 0);
+}
+
+TEST_CASE("Buffer with runtime capacity properly cycles", "[Buffer]") {
+    Buffer<int, DYNAMIC_BUFFER_SIZE> buffer(3);
+    for (int i = 0; i < 5; i++) {
+        buffer.push(i);
+    }
+    CHECK(buffer.size() == 3);
+    CHECK(buffer[0] == 2);
+    CHECK(buffer.pop() == 2);
+    CHECK(buffer.pop() == 3);
+    CHECK(buffer.pop() == 4);
+    REQUIRE_THROWS_AS(buffer.pop(), std::out_of_range);
+}
+
+TEST_CASE("Buffer with runtime capacity holds movable items", "[Buffer]") {
+    Buffer<std::unique_ptr<int>, DYNAMIC_BUFFER_SIZE> buffer(1u << 20);
+    for (int i = 0; i < (1 << 20) + 1; i++) {
+        buffer.push(std::make_unique<int>(i));
+    }
+    CHECK(buffer.size() == 1u << 20);
+    REQUIRE(*buffer.pop() == 1);
+}
+
+TEST_CASE("Buffer throws std::invalid_argument on invalid capacity", "[Buffer]") {
+    CHECK_THROWS_AS((Buffer<int, DYNAMIC_BUFFER_SIZE>(0)), std::invalid_argument);
+    CHECK_THROWS_AS((Buffer<int, 4>(5)), std::invalid_argument);
+    REQUIRE_NOTHROW((Buffer<int, 4>(4)));
+}
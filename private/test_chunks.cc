@@ -0,0 +1,128 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "../chunks.h"
+
+namespace {
+    /**
+     * @param length text length.
+     * @return datagram with text of the given length.
+     */
+    sik::Datagram long_datagram(std::size_t length) {
+        std::string text(length, '\0');
+        for (std::size_t i = 0u; i < length; i++) {
+            text[i] = (char) ('a' + i % 26u);
+        }
+        return sik::Datagram(sik::Message(1u, 'a', ""), text, true);
+    }
+
+    /**
+     * @param datagram datagram.
+     * @return datagram bytes.
+     */
+    std::string bytes(const sik::Datagram &datagram) {
+        return std::string(datagram.data(), datagram.length());
+    }
+}
+
+TEST_CASE("split_into_chunks respects chunk size", "[chunks]") {
+    sik::Datagram datagram = long_datagram(100000u);
+    std::vector<sik::Datagram> chunks
+            = sik::split_into_chunks(datagram, 7u, 1400u);
+    // 1387 bytes of the message fit in a chunk.
+    REQUIRE(chunks.size() == 73u);
+    for (const sik::Datagram &chunk: chunks) {
+        CHECK(chunk.length() <= 1400u);
+        CHECK(sik::is_chunk(chunk.data(), chunk.length()));
+    }
+    CHECK(sik::ChunkSchema::get<sik::CHUNK_MESSAGE_ID>(chunks[5].data()) == 7u);
+    CHECK(sik::ChunkSchema::get<sik::CHUNK_INDEX>(chunks[5].data()) == 5u);
+    REQUIRE(sik::ChunkSchema::get<sik::CHUNK_COUNT>(chunks[5].data()) == 73u);
+
+    CHECK_THROWS_AS(sik::split_into_chunks(datagram, 7u, 13u),
+                    std::length_error);
+    REQUIRE_THROWS_AS(sik::split_into_chunks(
+            long_datagram(sik::MAX_MESSAGE_LENGTH), 7u, 1400u),
+                      std::length_error);
+}
+
+TEST_CASE("ChunkAssembler reassembles chunks in any order", "[chunks]") {
+    sik::Datagram datagram = long_datagram(5000u);
+    std::vector<sik::Datagram> chunks
+            = sik::split_into_chunks(datagram, 1u, 1000u);
+    REQUIRE(chunks.size() == 6u);
+
+    sik::ChunkAssembler assembler;
+    boost::string_view message;
+    for (std::size_t i = chunks.size() - 1u; i > 0u; i--) {
+        CHECK_FALSE(assembler.add(chunks[i].data(), chunks[i].length(),
+                                  message));
+    }
+    // Duplicates change nothing.
+    CHECK_FALSE(assembler.add(chunks[3].data(), chunks[3].length(), message));
+    CHECK(assembler.pending() == 1u);
+    REQUIRE(assembler.add(chunks[0].data(), chunks[0].length(), message));
+    CHECK(message.to_string() == bytes(datagram));
+    REQUIRE(assembler.pending() == 0u);
+}
+
+TEST_CASE("ChunkAssembler delivers a single chunk at once", "[chunks]") {
+    sik::Datagram datagram = long_datagram(100u);
+    std::vector<sik::Datagram> chunks
+            = sik::split_into_chunks(datagram, 1u, 1000u);
+    REQUIRE(chunks.size() == 1u);
+
+    sik::ChunkAssembler assembler;
+    boost::string_view message;
+    REQUIRE(assembler.add(chunks[0].data(), chunks[0].length(), message));
+    REQUIRE(message.to_string() == bytes(datagram));
+}
+
+TEST_CASE("ChunkAssembler evicts the longest waiting message", "[chunks]") {
+    sik::ChunkAssembler assembler(2u);
+    boost::string_view message;
+    std::vector<std::vector<sik::Datagram>> messages;
+    for (uint32_t id = 0u; id < 3u; id++) {
+        messages.push_back(sik::split_into_chunks(long_datagram(1500u), id,
+                                                  1000u));
+        REQUIRE(messages[id].size() == 2u);
+        CHECK_FALSE(assembler.add(messages[id][0].data(),
+                                  messages[id][0].length(), message));
+    }
+    CHECK(assembler.pending() == 2u);
+    CHECK(assembler.get_dropped() == 1u);
+
+    // The first message is gone, the other two complete.
+    for (uint32_t id = 1u; id < 3u; id++) {
+        CHECK(assembler.add(messages[id][1].data(), messages[id][1].length(),
+                            message));
+    }
+    CHECK_FALSE(assembler.add(messages[0][1].data(), messages[0][1].length(),
+                              message));
+    REQUIRE(assembler.pending() == 1u);
+}
+
+TEST_CASE("ChunkAssembler rejects invalid chunks", "[chunks]") {
+    sik::ChunkAssembler assembler;
+    boost::string_view message;
+    std::vector<sik::Datagram> chunks
+            = sik::split_into_chunks(long_datagram(3000u), 1u, 1000u);
+    std::string truncated = bytes(chunks[0]).substr(0u, 500u);
+    CHECK_THROWS_AS(assembler.add(truncated.data(), truncated.length(),
+                                  message), std::invalid_argument);
+    CHECK_THROWS_AS(assembler.add(truncated.data(), 5u, message),
+                    std::invalid_argument);
+
+    std::string wrong_index = bytes(chunks[0]);
+    sik::ChunkSchema::set<sik::CHUNK_INDEX>(&wrong_index[0], 4u);
+    CHECK_THROWS_AS(assembler.add(wrong_index.data(), wrong_index.length(),
+                                  message), std::invalid_argument);
+
+    CHECK_FALSE(assembler.add(chunks[0].data(), chunks[0].length(), message));
+    // Chunk of another message with the same identifier.
+    sik::Datagram other = sik::split_into_chunks(long_datagram(2500u), 1u,
+                                                 1000u)[1];
+    REQUIRE_THROWS_AS(assembler.add(other.data(), other.length(), message),
+                      std::invalid_argument);
+}
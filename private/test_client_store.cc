@@ -0,0 +1,143 @@
+#include <vector>
+#include "catch.hpp"
+#include "../client_store.h"
+
+TEST_CASE("Bitmap find_next returns set bits in order", "[Bitmap]") {
+    sik::Bitmap bitmap;
+    bitmap.resize(200);
+    CHECK(bitmap.find_next(0) == sik::NO_BIT);
+
+    bitmap.set(3);
+    bitmap.set(64);
+    bitmap.set(199);
+    CHECK(bitmap.count() == 3);
+    CHECK(bitmap.find_next(0) == 3);
+    CHECK(bitmap.find_next(4) == 64);
+    CHECK(bitmap.find_next(65) == 199);
+    CHECK(bitmap.find_next(200) == sik::NO_BIT);
+
+    bitmap.reset(64);
+    CHECK_FALSE(bitmap.test(64));
+    REQUIRE(bitmap.find_next(4) == 199);
+}
+
+TEST_CASE("mask_between SIMD and scalar versions agree", "[simd]") {
+    std::vector<int64_t> lo, hi;
+    for (int64_t i = 0; i < 1000; i++) {
+        lo.push_back(i % 7 * 10);
+        hi.push_back(i % 7 * 10 + i % 13);
+    }
+    bool all_equal = true;
+    for (int64_t value = -1; value < 80; value++) {
+        std::vector<uint64_t> scalar(16), best(16);
+        sik::mask_between_scalar(lo.data(), hi.data(), lo.size(), value,
+                                 scalar.data());
+        sik::mask_between(lo.data(), hi.data(), lo.size(), value, best.data());
+        all_equal &= scalar == best;
+        for (std::size_t i = 0; i < lo.size(); i++) {
+            bool in = lo[i] <= value && value <= hi[i];
+            all_equal &= in == (bool) ((scalar[i / 64] >> (i % 64)) & 1u);
+        }
+    }
+    REQUIRE(all_equal);
+}
+
+TEST_CASE("ClientStore select marks connected clients", "[ClientStore]") {
+    sik::ClientStore store(120);
+    auto a = store.add(1u, 1000, 1);
+    auto b = store.add(2u, 1060, 2);
+    store.connect(a, 1300);
+
+    sik::Bitmap selected;
+    store.select(1100, selected);
+    CHECK(selected.test(a));
+    CHECK(selected.test(b));
+
+    store.select(1200, selected);
+    CHECK_FALSE(selected.test(a));
+    CHECK_FALSE(selected.test(b));
+
+    store.select(1400, selected);
+    CHECK(selected.test(a));
+    REQUIRE_FALSE(selected.test(b));
+}
+
+TEST_CASE("ClientStore expire drops old intervals and reuses slots", "[ClientStore]") {
+    sik::ClientStore store(120);
+    auto a = store.add(1u, 1000, 1);
+    store.connect(a, 1300);
+    CHECK(store.first_end(a) == 1120);
+
+    CHECK(store.expire(a, 1200));
+    CHECK(store.first_end(a) == 1420);
+    CHECK_FALSE(store.is_connected(a, 1100));
+    CHECK_FALSE(store.expire(a, 1421));
+
+    store.remove(a);
+    CHECK_FALSE(store.is_used(a));
+    CHECK(store.size() == 0);
+
+    auto b = store.add(2u, 1500, 2);
+    CHECK(b == a);
+    CHECK(store.key(b) == 2u);
+    CHECK(store.joined_at(b) == 2u);
+    REQUIRE(store.size() == 1);
+}
+
+TEST_CASE("IntervalRing keeps order when moving to the heap", "[ClientStore]") {
+    sik::IntervalRing ring;
+    ring.push_back(std::make_pair(1, 2));
+    ring.push_back(std::make_pair(3, 4));
+    ring.pop_front();
+    ring.push_back(std::make_pair(5, 6));
+    CHECK(ring.size() == 2);
+    CHECK(ring.front().first == 3);
+
+    ring.push_back(std::make_pair(7, 8));
+    CHECK(ring.size() == 3);
+    CHECK(ring[0].first == 3);
+    CHECK(ring[1].first == 5);
+    CHECK(ring[2].first == 7);
+
+    ring.clear();
+    CHECK(ring.empty());
+    ring.push_back(std::make_pair(9, 10));
+    REQUIRE(ring.front().second == 10);
+}
+
+TEST_CASE("ClientStore handles many reconnections", "[ClientStore]") {
+    sik::ClientStore store(10);
+    auto a = store.add(1u, 0, 1);
+    for (std::time_t t = 20; t <= 100; t += 20) {
+        store.connect(a, t);
+    }
+    CHECK(store.is_connected(a, 5));
+    CHECK(store.is_connected(a, 65));
+    CHECK_FALSE(store.is_connected(a, 15));
+
+    CHECK(store.expire(a, 70));
+    CHECK(store.first_end(a) == 70);
+    CHECK_FALSE(store.is_connected(a, 45));
+    REQUIRE(store.is_connected(a, 85));
+}
+
+TEST_CASE("ClientStore keeps least recently active client", "[ClientStore]") {
+    sik::ClientStore store(120);
+    CHECK(store.least_recent() == sik::NO_SLOT);
+    auto a = store.add(1u, 1000, 1);
+    auto b = store.add(2u, 1001, 2);
+    auto c = store.add(3u, 1002, 3);
+    CHECK(store.least_recent() == a);
+
+    store.connect(a, 1003);
+    CHECK(store.least_recent() == b);
+
+    store.remove(b);
+    CHECK(store.least_recent() == c);
+    store.connect(c, 1004);
+    CHECK(store.least_recent() == a);
+
+    store.remove(a);
+    store.remove(c);
+    REQUIRE(store.least_recent() == sik::NO_SLOT);
+}
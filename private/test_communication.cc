@@ -0,0 +1,94 @@
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include "catch.hpp"
+#include "../communication.h"
+
+/**
+ * @param address set to the loopback address the socket is bound to.
+ * @return UDP socket bound to a free loopback port.
+ */
+static int bound_socket(sockaddr_in &address) {
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    REQUIRE(sock >= 0);
+    address = sockaddr_in();
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = inet_addr("127.0.0.1");
+    address.sin_port = 0;
+    REQUIRE(bind(sock, (sockaddr *) &address, sizeof(address)) == 0);
+    socklen_t length = sizeof(address);
+    REQUIRE(getsockname(sock, (sockaddr *) &address, &length) == 0);
+    return sock;
+}
+
+/**
+ * Sends datagram to a loopback port nobody listens on and waits for the
+ * ICMP port unreachable it causes.
+ * @param sender sender of the socket.
+ * @param sock socket with IP_RECVERR enabled.
+ * @param closed set to the closed port address.
+ */
+static void send_to_closed_port(const sik::Sender &sender, int sock,
+                                sockaddr_in &closed) {
+    close(bound_socket(closed));
+    sender.send_datagram(closed, sik::Datagram(std::string("lost")));
+    pollfd error = {sock, 0, 0};
+    REQUIRE(poll(&error, 1, 1000) == 1);
+    REQUIRE((error.revents & POLLERR) != 0);
+}
+
+TEST_CASE("Sender and Receiver leave ICMP errors to the error queue", "[communication]") {
+    sockaddr_in server_address, peer_address, closed;
+    int server = bound_socket(server_address);
+    int peer = bound_socket(peer_address);
+    int enable = 1;
+    REQUIRE(setsockopt(server, IPPROTO_IP, IP_RECVERR, &enable,
+                       sizeof(enable)) == 0);
+    sik::Sender sender(server);
+    sik::Receiver receiver(server);
+    sik::Datagram datagram(std::string("datagram"));
+    char received[16];
+
+    // Error of the closed port is not reported for the live peer.
+    send_to_closed_port(sender, server, closed);
+    sender.send_datagram(peer_address, datagram);
+    CHECK(recv(peer, received, sizeof(received), 0) == 8);
+
+    send_to_closed_port(sender, server, closed);
+    sik::address_t key = sik::pack_address(peer_address);
+    CHECK(sender.send_datagram_batch(&key, 1u, datagram) == 1u);
+    CHECK(recv(peer, received, sizeof(received), 0) == 8);
+
+    send_to_closed_port(sender, server, closed);
+    const sik::Datagram *datagrams[] = {&datagram};
+    CHECK(sender.send_datagram_batch(&key, datagrams, 1u) == 1u);
+    CHECK(recv(peer, received, sizeof(received), 0) == 8);
+
+    send_to_closed_port(sender, server, closed);
+    sik::AddressedDatagram addressed = {key, datagram};
+    CHECK(sender.send_datagrams(&addressed, 1u) == 1u);
+    CHECK(recv(peer, received, sizeof(received), 0) == 8);
+
+    send_to_closed_port(sender, server, closed);
+    sik::RequestBatch requests;
+    CHECK_THROWS_AS(receiver.receive_requests(requests),
+                    sik::WouldBlockException);
+    REQUIRE(sendto(peer, "request", 7, 0, (sockaddr *) &server_address,
+                   sizeof(server_address)) == 7);
+    pollfd request = {server, POLLIN, 0};
+    REQUIRE(poll(&request, 1, 1000) == 1);
+    CHECK(receiver.receive_requests(requests) == 1u);
+    CHECK(requests.lengths[0] == 7u);
+
+    // Errors stay queued for the server to disconnect their senders.
+    sockaddr_in unreachable = sockaddr_in();
+    for (int i = 0; i < 5; i++) {
+        CHECK(receiver.receive_error(unreachable));
+    }
+    CHECK(unreachable.sin_port == closed.sin_port);
+    CHECK_THROWS_AS(receiver.receive_error(unreachable),
+                    sik::WouldBlockException);
+
+    close(peer);
+    close(server);
+}
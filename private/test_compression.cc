@@ -0,0 +1,47 @@
+#include <string>
+
+#include "catch.hpp"
+#include "../compression.h"
+
+TEST_CASE("Compressed message decompresses to the original", "[compression]") {
+    std::string text;
+    for (int i = 0; i < 100; i++) {
+        text += "Ala ma kota\n";
+    }
+    std::string compressed = sik::compress_text(
+            std::string(text).append(1u, '\0'));
+    CHECK(compressed.length() < text.length() / 4u);
+
+    sik::Message message(42u, 'x', "");
+    sik::Datagram datagram = sik::compressed_datagram(message, compressed,
+                                                      text.length() + 1u);
+    CHECK(sik::is_compressed(datagram.data(), datagram.length()));
+    sik::Datagram plain(message, text, true);
+    CHECK_FALSE(sik::is_compressed(plain.data(), plain.length()));
+
+    std::string buffer;
+    sik::MessageView view = sik::decompress_message(
+            datagram.data(), datagram.length(), buffer);
+    CHECK(view.get_timestamp() == 42u);
+    CHECK(view.get_character() == 'x');
+    REQUIRE(view.get_message() == text);
+}
+
+TEST_CASE("decompress_message rejects corrupted data", "[compression]") {
+    std::string compressed = sik::compress_text(std::string("Ala ma kota", 12u));
+    sik::Datagram datagram = sik::compressed_datagram(
+            sik::Message(42u, 'x', ""), compressed, 12u);
+    std::string buffer;
+
+    std::string truncated(datagram.data(), datagram.length() - 2u);
+    CHECK_THROWS_AS(sik::decompress_message(truncated.data(),
+                                            truncated.length(), buffer),
+                    std::invalid_argument);
+    std::string wrong_length(datagram.data(), datagram.length());
+    wrong_length[sik::COMPRESSED_HEADER_SIZE - 1u]++;
+    CHECK_THROWS_AS(sik::decompress_message(wrong_length.data(),
+                                            wrong_length.length(), buffer),
+                    std::invalid_argument);
+    REQUIRE_THROWS_AS(sik::decompress_message(datagram.data(), 5u, buffer),
+                      std::invalid_argument);
+}
@@ -107,6 +107,7 @@ TEST_CASE("Connections get_client removes old connections", "[Connections]") {
     connections.add_client(client_a, now + 4 * 60u);
     CHECK(connections.get_clients(now).size() == 1);
     CHECK(connections.get_clients(now + 2 * 60u + 1u).size() == 0);
+    connections.expire(now + 2 * 60u + 1u);
     CHECK(connections.get_clients(now).size() == 0);
     REQUIRE(connections.get_clients(now + 5 * 60u).size() == 1);
 }
@@ -124,4 +125,301 @@ TEST_CASE("Connections get_clients excludes given address", "[Connections]") {
 
     CHECK(connections.get_clients(now).size() == 1);
     REQUIRE(connections.get_clients(now, &client_a).size() == 0);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Connections get_clients does not remove connections", "[Connections]") {
+    sik::Connections connections;
+    std::time_t now = time(0);
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+
+    connections.add_client(client_a, now);
+    CHECK(connections.get_clients(now + 2 * 60u + 1u).size() == 0);
+    CHECK(connections.get_clients(now).size() == 1);
+    REQUIRE(connections.size() == 1);
+}
+
+TEST_CASE("Connections expire keeps extended connections", "[Connections]") {
+    sik::Connections connections;
+    std::time_t now = time(0);
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+
+    sockaddr_in client_b;
+    client_b.sin_family = AF_INET;
+    client_b.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_b.sin_port = htons(10013u);
+
+    connections.add_client(client_a, now);
+    connections.add_client(client_b, now);
+    connections.add_client(client_a, now + 60u);
+
+    connections.expire(now + 2 * 60u + 1u);
+    CHECK(connections.size() == 1);
+    CHECK(connections.get_clients(now + 3 * 60u).size() == 1);
+
+    connections.expire(now + 3 * 60u + 1u);
+    CHECK(connections.size() == 0);
+    REQUIRE(connections.get_clients(now + 3 * 60u).size() == 0);
+}
+
+TEST_CASE("Connections expire handles long idle periods", "[Connections]") {
+    sik::Connections connections;
+    std::time_t now = time(0);
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+
+    connections.add_client(client_a, now);
+    connections.add_client(client_a, now + 4 * 60u);
+    connections.expire(now + 60 * 60u);
+    CHECK(connections.size() == 0);
+
+    connections.add_client(client_a, now + 60 * 60u);
+    connections.expire(now + 60 * 60u + 2 * 60u);
+    CHECK(connections.size() == 1);
+    connections.expire(now + 60 * 60u + 2 * 60u + 1u);
+    REQUIRE(connections.size() == 0);
+}
+
+TEST_CASE("Connections get_recipients is not affected by later changes", "[Connections]") {
+    sik::Connections connections;
+    std::time_t now = time(0);
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+
+    sockaddr_in client_b;
+    client_b.sin_family = AF_INET;
+    client_b.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_b.sin_port = htons(10013u);
+
+    sockaddr_in client_c;
+    client_c.sin_family = AF_INET;
+    client_c.sin_addr.s_addr = inet_addr("192.168.0.11");
+    client_c.sin_port = htons(10013u);
+
+    connections.add_client(client_a, now);
+    connections.add_client(client_b, now);
+    uint64_t generation = connections.get_generation();
+
+    auto recipients = connections.get_recipients(now, &client_a);
+    CHECK(recipients.is_current());
+    connections.add_client(client_b, now + 1u);
+    CHECK(connections.get_generation() == generation);
+    connections.add_client(client_c, now);
+    CHECK(connections.get_generation() != generation);
+    CHECK_FALSE(recipients.is_current());
+
+    sik::address_t key;
+    CHECK(recipients.next(key));
+    CHECK(key == sik::pack_address(client_b));
+    CHECK_FALSE(recipients.next(key));
+    CHECK(recipients.done());
+    REQUIRE(connections.get_clients(now, &client_a).size() == 2);
+}
+
+TEST_CASE("Connections get_recipients finds old recipients among many clients", "[Connections]") {
+    sik::Connections connections;
+    std::time_t now = time(0);
+
+    for (uint16_t port = 1; port <= 10; port++) {
+        connections.add_client(sik::unpack_address(1u << 16u | port), now);
+    }
+    for (uint16_t port = 1; port <= 1000; port++) {
+        connections.add_client(sik::unpack_address(2u << 16u | port),
+                               now + 3 * 60u);
+    }
+
+    sockaddr_in sender = sik::unpack_address(1u << 16u | 1u);
+    CHECK(connections.get_clients(now + 60u, &sender).size() == 9);
+    CHECK(connections.get_clients(now + 3 * 60u, &sender).size() == 1000);
+    REQUIRE(connections.get_clients(now + 6 * 60u).size() == 0);
+}
+
+TEST_CASE("Connections disconnect removes unreachable clients at once", "[Connections]") {
+    sik::Connections connections;
+    std::time_t now = 1000;
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+    sockaddr_in client_b = client_a;
+    client_b.sin_port = htons(10013u);
+
+    connections.add_client(client_a, now);
+    connections.add_client(client_b, now);
+    auto before = connections.get_recipients(now);
+
+    CHECK(connections.disconnect(client_a));
+    CHECK_FALSE(connections.disconnect(client_a));
+    CHECK_FALSE(connections.has_client(sik::pack_address(client_a)));
+    CHECK(connections.has_client(sik::pack_address(client_b)));
+    CHECK(connections.size() == 1);
+    CHECK(connections.get_clients(now).size() == 1);
+
+    // Lists created before the disconnection skip the client as well.
+    std::size_t recipients = 0;
+    sik::address_t key;
+    while (before.next(key)) {
+        CHECK(key == sik::pack_address(client_b));
+        recipients++;
+    }
+    CHECK(recipients == 1);
+
+    CHECK(connections.count_disconnected(now + 60) == 1);
+    CHECK(connections.count_disconnected(now + sik::TIMEOUT + 1) == 0);
+
+    connections.add_client(client_a, now + 10);
+    REQUIRE(connections.get_clients(now + 10).size() == 2);
+}
+
+TEST_CASE("Connections evicts least recently active client when full", "[Connections]") {
+    CHECK_THROWS_AS(sik::Connections(0u), std::invalid_argument);
+
+    sik::Connections connections(2u);
+    std::time_t now = 1000;
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+    sockaddr_in client_b = client_a;
+    client_b.sin_port = htons(10013u);
+    sockaddr_in client_c = client_a;
+    client_c.sin_port = htons(10014u);
+
+    connections.add_client(client_a, now);
+    connections.add_client(client_b, now + 1);
+    connections.add_client(client_a, now + 2);
+    connections.add_client(client_c, now + 3);
+
+    CHECK(connections.size() == 2);
+    CHECK(connections.get_admitted() == 3u);
+    CHECK(connections.get_evicted() == 1u);
+    CHECK(connections.is_connected(sik::pack_address(client_a), now + 3));
+    CHECK_FALSE(connections.is_connected(sik::pack_address(client_b), now + 3));
+    REQUIRE(connections.get_clients(now + 3).size() == 2);
+}
+
+TEST_CASE("Connections drop timers of removed clients", "[Connections]") {
+    sik::Connections connections(1u);
+    std::time_t now = 1000;
+
+    sockaddr_in client_a;
+    client_a.sin_family = AF_INET;
+    client_a.sin_addr.s_addr = inet_addr("192.168.0.10");
+    client_a.sin_port = htons(10012u);
+    sockaddr_in client_b = client_a;
+    client_b.sin_port = htons(10013u);
+
+    // Every client evicts the other one, addresses keep coming back.
+    for (std::time_t i = 0; i < 10; i++) {
+        connections.add_client(client_a, now + i);
+        connections.add_client(client_b, now + i);
+    }
+    connections.add_client(client_a, now + 10);
+    CHECK(connections.get_timers() == 21u);
+
+    // Timers of evicted clients fire while the address is connected again.
+    connections.expire(now + sik::TIMEOUT + 10);
+    CHECK(connections.size() == 1);
+    CHECK(connections.is_connected(sik::pack_address(client_a),
+                                   now + sik::TIMEOUT + 10));
+    CHECK(connections.get_timers() == 1u);
+
+    // Same for a client disconnected as unreachable.
+    now += sik::TIMEOUT + 10;
+    CHECK(connections.disconnect(client_a));
+    connections.add_client(client_a, now);
+    connections.expire(now + sik::TIMEOUT);
+    CHECK(connections.size() == 1);
+    CHECK(connections.get_timers() == 1u);
+
+    connections.expire(now + sik::TIMEOUT + 1);
+    CHECK(connections.size() == 0);
+    REQUIRE(connections.get_timers() == 0u);
+}
+
+TEST_CASE("Connections remember features of connected clients", "[Connections]") {
+    sik::Connections connections(1u);
+    sockaddr_in first = sockaddr_in(), second = sockaddr_in();
+    first.sin_port = htons(1000);
+    second.sin_port = htons(1001);
+
+    connections.set_features(first, sik::FEATURE_FRAMES);
+    CHECK(connections.get_features(sik::pack_address(first))
+          == sik::NO_FEATURES);
+    connections.add_client(first, 1000);
+    connections.set_features(first, sik::FEATURE_FRAMES);
+    CHECK(connections.get_features(sik::pack_address(first))
+          == sik::FEATURE_FRAMES);
+
+    // Slot reused by an evicted client's successor starts without features.
+    connections.add_client(second, 1001);
+    CHECK(connections.get_features(sik::pack_address(first))
+          == sik::NO_FEATURES);
+    REQUIRE(connections.get_features(sik::pack_address(second))
+            == sik::NO_FEATURES);
+}
+
+TEST_CASE("Connections add features until the client announces again", "[Connections]") {
+    sik::Connections connections;
+    sockaddr_in client = sockaddr_in();
+    client.sin_port = htons(1000);
+    sik::address_t key = sik::pack_address(client);
+
+    connections.add_client(client, 1000);
+    connections.set_features(client, sik::FEATURE_CONTENT_ID);
+    connections.add_features(client, sik::CONTENT_ACKNOWLEDGED);
+    CHECK(connections.get_features(key)
+          == (sik::FEATURE_CONTENT_ID | sik::CONTENT_ACKNOWLEDGED));
+
+    connections.set_features(client, sik::FEATURE_CONTENT_ID);
+    REQUIRE(connections.get_features(key) == sik::FEATURE_CONTENT_ID);
+}
+
+TEST_CASE("Connections number datagrams and count missed messages per client", "[Connections]") {
+    sik::Connections connections(1u);
+    sockaddr_in first = sockaddr_in(), second = sockaddr_in();
+    first.sin_port = htons(1000);
+    second.sin_port = htons(1001);
+    sik::address_t key = sik::pack_address(first);
+
+    CHECK(connections.next_sequence(key) == 0u);
+    connections.add_missed(key);
+    CHECK(connections.get_missed(key) == 0u);
+
+    connections.add_client(first, 1000);
+    CHECK(connections.next_sequence(key) == 0u);
+    CHECK(connections.next_sequence(key) == 1u);
+    connections.rewind_sequence(key);
+    CHECK(connections.next_sequence(key) == 1u);
+    connections.add_missed(key);
+    connections.add_missed(key);
+    CHECK(connections.get_missed(key) == 2u);
+    std::size_t visited = 0u;
+    connections.visit_missed([&](sik::address_t client, uint64_t missed) {
+        CHECK(client == key);
+        CHECK(missed == 2u);
+        visited++;
+    });
+    CHECK(visited == 1u);
+
+    // Slot reused by an evicted client's successor starts from scratch.
+    connections.add_client(second, 1001);
+    sik::address_t successor = sik::pack_address(second);
+    CHECK(connections.get_missed(successor) == 0u);
+    REQUIRE(connections.next_sequence(successor) == 0u);
+}
@@ -0,0 +1,44 @@
+#include <string>
+
+#include "catch.hpp"
+#include "../cookies.h"
+
+namespace {
+    /// Key of the SipHash reference vectors: bytes 0 to 15.
+    const uint64_t K0 = 0x0706050403020100u;
+    const uint64_t K1 = 0x0f0e0d0c0b0a0908u;
+}
+
+TEST_CASE("siphash24 matches reference vectors", "[cookies]") {
+    std::string data;
+    CHECK(sik::siphash24(K0, K1, data.data(), 0u) == 0x726fdb47dd0e0e31u);
+    for (char c = 0; c < 15; c++) {
+        data.push_back(c);
+    }
+    CHECK(sik::siphash24(K0, K1, data.data(), 8u) == 0x93f5f5799a932462u);
+    REQUIRE(sik::siphash24(K0, K1, data.data(), 15u) == 0xa129ca6149be45e5u);
+}
+
+TEST_CASE("CookieJar accepts cookies of its addresses only", "[cookies]") {
+    sik::CookieJar jar(60, K0, K1);
+    CHECK(jar.is_enabled());
+    sik::cookie_t cookie = jar.issue(1u, 6000);
+    CHECK(cookie != sik::NO_COOKIE);
+    CHECK(jar.is_valid(1u, cookie, 6000));
+    CHECK_FALSE(jar.is_valid(2u, cookie, 6000));
+    CHECK_FALSE(jar.is_valid(1u, cookie + 1u, 6000));
+    REQUIRE_FALSE(jar.is_valid(1u, sik::NO_COOKIE, 6000));
+}
+
+TEST_CASE("CookieJar cookies expire after two periods", "[cookies]") {
+    sik::CookieJar jar(60, K0, K1);
+    sik::cookie_t cookie = jar.issue(1u, 6059);
+    CHECK(jar.is_valid(1u, cookie, 6060));
+    CHECK(jar.is_valid(1u, cookie, 6119));
+    REQUIRE_FALSE(jar.is_valid(1u, cookie, 6120));
+}
+
+TEST_CASE("CookieJar keys differ between servers", "[cookies]") {
+    sik::CookieJar first(60), second(60);
+    REQUIRE(first.issue(1u, 6000) != second.issue(1u, 6000));
+}
@@ -0,0 +1,41 @@
+#include "catch.hpp"
+#include "../duplicates.h"
+
+TEST_CASE("DuplicateFilter suppresses repeats within the window", "[DuplicateFilter]") {
+    sik::DuplicateFilter filter(10);
+    CHECK_FALSE(filter.is_repeated(1u, 1500000000u, 'a', 100));
+    CHECK(filter.is_repeated(1u, 1500000000u, 'a', 105));
+    CHECK(filter.is_repeated(1u, 1500000000u, 'a', 109));
+    // Other senders, timestamps and characters are different requests.
+    CHECK_FALSE(filter.is_repeated(2u, 1500000000u, 'a', 109));
+    CHECK_FALSE(filter.is_repeated(1u, 1500000001u, 'a', 109));
+    CHECK_FALSE(filter.is_repeated(1u, 1500000000u, 'b', 109));
+    REQUIRE(filter.get_suppressed() == 2u);
+}
+
+TEST_CASE("DuplicateFilter forgets requests after the window", "[DuplicateFilter]") {
+    sik::DuplicateFilter filter(10);
+    CHECK_FALSE(filter.is_repeated(1u, 1u, 'a', 100));
+    // Previous generation still remembers the request.
+    CHECK(filter.is_repeated(1u, 1u, 'a', 115));
+    CHECK_FALSE(filter.is_repeated(1u, 1u, 'a', 125));
+    CHECK(filter.is_repeated(1u, 1u, 'a', 126));
+    // Both generations expired.
+    REQUIRE_FALSE(filter.is_repeated(1u, 1u, 'a', 200));
+}
+
+TEST_CASE("DuplicateFilter forgets rather than suppresses when full", "[DuplicateFilter]") {
+    sik::DuplicateFilter filter(10, 16u);
+    for (sik::timestamp_t timestamp = 0u; timestamp < 1000u; timestamp++) {
+        CHECK_FALSE(filter.is_repeated(1u, timestamp, 'a', 100));
+    }
+    REQUIRE(filter.is_repeated(1u, 999u, 'a', 100));
+}
+
+TEST_CASE("DuplicateFilter disabled passes every request", "[DuplicateFilter]") {
+    sik::DuplicateFilter filter;
+    CHECK_FALSE(filter.is_enabled());
+    CHECK_FALSE(filter.is_repeated(1u, 1u, 'a', 100));
+    CHECK_FALSE(filter.is_repeated(1u, 1u, 'a', 100));
+    REQUIRE(filter.get_suppressed() == 0u);
+}
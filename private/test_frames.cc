@@ -0,0 +1,105 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "../frames.h"
+
+namespace {
+    /**
+     * @param timestamp message timestamp.
+     * @param text message text.
+     * @return datagram sent to clients.
+     */
+    sik::Datagram datagram(sik::timestamp_t timestamp, const std::string &text) {
+        return sik::Datagram(sik::Message(timestamp, 'a', ""), text, true);
+    }
+
+    /**
+     * Takes all ready frames out of the packer.
+     * @param frames packer.
+     * @return ready frames, in order.
+     */
+    std::vector<sik::AddressedDatagram> take_ready(sik::FramePacker &frames) {
+        std::vector<sik::AddressedDatagram> ready(
+                frames.next_ready(), frames.next_ready() + frames.ready_count());
+        frames.pop_ready(frames.ready_count());
+        return ready;
+    }
+}
+
+TEST_CASE("FramePacker sends lone messages unchanged", "[FramePacker]") {
+    sik::FramePacker frames(1400u);
+    sik::Datagram message = datagram(1u, "Ala");
+    frames.append(1u, message);
+    frames.append(2u, message);
+    CHECK_FALSE(frames.has_ready());
+    CHECK(frames.open_count() == 2u);
+
+    frames.flush();
+    std::vector<sik::AddressedDatagram> ready = take_ready(frames);
+    REQUIRE(ready.size() == 2u);
+    CHECK(ready[0].key == 1u);
+    CHECK(ready[0].datagram.data() == message.data());
+    CHECK(ready[1].key == 2u);
+    CHECK(frames.open_count() == 0u);
+    REQUIRE(frames.get_frames() == 0u);
+}
+
+TEST_CASE("FramePacker packs messages up to the budget", "[FramePacker]") {
+    sik::Datagram message = datagram(1u, "Ala ma kota");
+    std::size_t entry = sik::Frame::entry_length(message.length());
+    sik::FramePacker frames(sik::FRAME_HEADER_SIZE + 3u * entry);
+    for (int i = 0; i < 7; i++) {
+        frames.append(1u, message);
+    }
+    // Two full frames are closed, the third one holds a single message.
+    std::vector<sik::AddressedDatagram> ready = take_ready(frames);
+    REQUIRE(ready.size() == 2u);
+    CHECK(sik::is_frame(ready[0].datagram.data(), ready[0].datagram.length()));
+    CHECK(ready[0].datagram.length() == sik::FRAME_HEADER_SIZE + 3u * entry);
+
+    frames.flush();
+    ready = take_ready(frames);
+    REQUIRE(ready.size() == 1u);
+    CHECK_FALSE(sik::is_frame(ready[0].datagram.data(),
+                              ready[0].datagram.length()));
+    CHECK(frames.get_frames() == 2u);
+    REQUIRE(frames.get_framed_messages() == 6u);
+}
+
+TEST_CASE("FramePacker keeps order of messages too long to pack", "[FramePacker]") {
+    sik::FramePacker frames(64u);
+    sik::Datagram small = datagram(1u, "Ala");
+    sik::Datagram big = datagram(2u, std::string(100u, 'x'));
+    frames.append(1u, small);
+    frames.append(2u, small);
+    frames.append(1u, big);
+
+    std::vector<sik::AddressedDatagram> ready = take_ready(frames);
+    REQUIRE(ready.size() == 2u);
+    CHECK(ready[0].datagram.data() == small.data());
+    CHECK(ready[1].datagram.data() == big.data());
+    CHECK(frames.open_count() == 1u);
+
+    frames.flush();
+    ready = take_ready(frames);
+    REQUIRE(ready.size() == 1u);
+    REQUIRE(ready[0].key == 2u);
+}
+
+TEST_CASE("FramePacker queues pushed datagrams after open frames", "[FramePacker]") {
+    sik::FramePacker packer;
+    sik::Datagram message = datagram(1u, "Ala");
+    packer.push(1u, message);
+    REQUIRE(packer.ready_count() == 1u);
+
+    sik::FramePacker frames(1400u);
+    frames.append(1u, message);
+    frames.append(1u, message);
+    frames.push(1u, message);
+    std::vector<sik::AddressedDatagram> ready = take_ready(frames);
+    REQUIRE(ready.size() == 2u);
+    CHECK(sik::is_frame(ready[0].datagram.data(), ready[0].datagram.length()));
+    CHECK(ready[1].datagram.data() == message.data());
+    REQUIRE(frames.open_count() == 0u);
+}
@@ -0,0 +1,65 @@
+#include <set>
+#include "catch.hpp"
+#include "../membership.h"
+
+namespace {
+    std::multiset<sik::address_t> connected(const sik::MembershipHistory &history,
+                                            std::time_t timestamp) {
+        std::multiset<sik::address_t> keys;
+        history.visit(timestamp, [&keys](sik::address_t key) {
+            keys.insert(key);
+        });
+        return keys;
+    }
+}
+
+TEST_CASE("MembershipHistory returns clients connected at time point", "[MembershipHistory]") {
+    sik::MembershipHistory history(120, 120);
+    history.add(1u, 1000);
+    history.add(2u, 1060);
+
+    CHECK(connected(history, 999).empty());
+    CHECK(connected(history, 1000) == std::multiset<sik::address_t>{1u});
+    CHECK(connected(history, 1060) == (std::multiset<sik::address_t>{1u, 2u}));
+    CHECK(connected(history, 1120) == (std::multiset<sik::address_t>{1u, 2u}));
+    CHECK(connected(history, 1121) == std::multiset<sik::address_t>{2u});
+    REQUIRE(connected(history, 1181).empty());
+}
+
+TEST_CASE("MembershipHistory answers queries across checkpoints", "[MembershipHistory]") {
+    sik::MembershipHistory history(120, 10);
+    // Client 1 stays connected for the whole time, client 2 reconnects.
+    for (std::time_t time = 1000; time <= 1500; time += 50) {
+        history.add(1u, time);
+        if (time == 1000 || time == 1300) {
+            history.add(2u, time);
+        }
+    }
+
+    bool all_found = true;
+    for (std::time_t time = 1000; time <= 1620; time++) {
+        std::multiset<sik::address_t> expected{1u};
+        if (time <= 1120 || (time >= 1300 && time <= 1420)) {
+            expected.insert(2u);
+        }
+        all_found &= connected(history, time) == expected;
+    }
+    CHECK(all_found);
+    REQUIRE(connected(history, 1621).empty());
+}
+
+TEST_CASE("MembershipHistory prune forgets old intervals", "[MembershipHistory]") {
+    sik::MembershipHistory history(120, 10);
+    history.add(1u, 1000);
+    history.add(2u, 1100);
+    history.add(2u, 1200);
+    history.add(3u, 1300);
+    std::size_t size = history.size();
+
+    history.prune(1200);
+    CHECK(history.size() < size);
+    CHECK(connected(history, 1000).empty());
+    CHECK(connected(history, 1100) == std::multiset<sik::address_t>{2u});
+    CHECK(connected(history, 1200) == std::multiset<sik::address_t>{2u});
+    REQUIRE(connected(history, 1300) == (std::multiset<sik::address_t>{2u, 3u}));
+}
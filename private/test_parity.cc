@@ -0,0 +1,111 @@
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+#include "../parity.h"
+
+namespace {
+    /**
+     * Datagrams of different lengths.
+     * @param count number of datagrams.
+     * @return datagrams.
+     */
+    std::vector<sik::Datagram> make_group(std::size_t count) {
+        std::vector<sik::Datagram> group;
+        for (std::size_t i = 0u; i < count; i++) {
+            group.emplace_back(std::string(10u + 7u * i, (char) ('a' + i)));
+        }
+        return group;
+    }
+
+    /**
+     * @param datagram datagram preceded by its sequence number.
+     * @param sequence set to the sequence number.
+     * @return datagram without the sequence number.
+     */
+    std::string strip(boost::string_view datagram, uint32_t &sequence) {
+        REQUIRE(sik::read_sequence(datagram.data(), datagram.length(),
+                                   sequence));
+        datagram.remove_prefix(sik::SEQUENCE_HEADER_SIZE);
+        return datagram.to_string();
+    }
+}
+
+TEST_CASE("ParityDecoder rebuilds any single datagram of a group", "[parity]") {
+    std::vector<sik::Datagram> group = make_group(4u);
+    sik::Datagram parity = sik::parity_datagram(100u, group);
+    REQUIRE(parity.length() == sik::PARITY_HEADER_SIZE + 31u);
+
+    for (uint32_t lost = 0u; lost < group.size(); lost++) {
+        sik::ParityDecoder decoder;
+        boost::string_view rebuilt;
+        // The first parity only activates the decoder.
+        CHECK_FALSE(decoder.rebuild(parity.data(), parity.length(), rebuilt));
+        for (uint32_t i = 0u; i < group.size(); i++) {
+            if (i != lost) {
+                decoder.keep(100u + i, boost::string_view(group[i].data(),
+                                                          group[i].length()));
+            }
+        }
+        REQUIRE(decoder.rebuild(parity.data(), parity.length(), rebuilt));
+        uint32_t sequence;
+        CHECK(strip(rebuilt, sequence)
+              == std::string(group[lost].data(), group[lost].length()));
+        CHECK(sequence == 100u + lost);
+        CHECK(decoder.get_recovered() == 1u);
+    }
+}
+
+TEST_CASE("ParityDecoder cannot rebuild more than one datagram", "[parity]") {
+    std::vector<sik::Datagram> group = make_group(3u);
+    sik::Datagram parity = sik::parity_datagram(0u, group);
+    sik::ParityDecoder decoder;
+    boost::string_view rebuilt;
+    decoder.rebuild(parity.data(), parity.length(), rebuilt);
+
+    decoder.keep(0u, boost::string_view(group[0].data(), group[0].length()));
+    CHECK_FALSE(decoder.rebuild(parity.data(), parity.length(), rebuilt));
+    CHECK(decoder.get_unrecoverable() == 1u);
+
+    // Nothing is missing.
+    decoder.keep(1u, boost::string_view(group[1].data(), group[1].length()));
+    decoder.keep(2u, boost::string_view(group[2].data(), group[2].length()));
+    CHECK_FALSE(decoder.rebuild(parity.data(), parity.length(), rebuilt));
+    CHECK(decoder.get_recovered() == 0u);
+
+    CHECK_THROWS_AS(decoder.rebuild(parity.data(), 3u, rebuilt),
+                    std::invalid_argument);
+    sik::Datagram single = sik::parity_datagram(0u, make_group(1u));
+    REQUIRE_THROWS_AS(decoder.rebuild(single.data(), single.length(),
+                                      rebuilt),
+                      std::invalid_argument);
+}
+
+TEST_CASE("ParityEncoder completes aligned groups of a client", "[parity]") {
+    CHECK_THROWS_AS(sik::ParityEncoder(1u), std::invalid_argument);
+    CHECK_THROWS_AS(sik::ParityEncoder(sik::MAX_PARITY_GROUP + 1u),
+                    std::invalid_argument);
+    CHECK_FALSE(sik::ParityEncoder().is_enabled());
+
+    sik::ParityEncoder encoder(2u);
+    std::vector<sik::Datagram> group = make_group(2u);
+    sik::Datagram parity;
+    // Client joined in the middle of a group.
+    CHECK_FALSE(encoder.add(1u, 1u, group[1], parity));
+    CHECK_FALSE(encoder.add(1u, 2u, group[0], parity));
+    CHECK_FALSE(encoder.add(2u, 2u, group[0], parity));
+    REQUIRE(encoder.add(1u, 3u, group[1], parity));
+
+    sik::Datagram expected = sik::parity_datagram(2u, group);
+    CHECK(std::string(parity.data(), parity.length())
+          == std::string(expected.data(), expected.length()));
+
+    // Skipped number breaks the group.
+    CHECK_FALSE(encoder.add(2u, 4u, group[0], parity));
+    CHECK(encoder.get_parities() == 1u);
+
+    encoder.prune([](sik::address_t key) {
+        return key == 2u;
+    });
+    REQUIRE_FALSE(encoder.add(1u, 5u, group[1], parity));
+}
@@ -1,5 +1,5 @@
 #include "catch.hpp"
-#include "../parse.h"
+#include "../parse_server.h"
 
 TEST_CASE("parse_port returns proper data", "[parse_port]") {
     CHECK(sik::parse_port("1") == 1);
@@ -18,6 +18,19 @@ TEST_CASE("parse_port throws errors on invalid input", "[parse_port]") {
     REQUIRE_THROWS_AS(sik::parse_port("42 42"), sik::ParseException);
 }
 
+TEST_CASE("parse_buffer_size returns proper data", "[parse_buffer_size]") {
+    CHECK(sik::parse_buffer_size("1") == 1);
+    CHECK(sik::parse_buffer_size("4096") == 4096);
+    REQUIRE(sik::parse_buffer_size("8388608") == 8388608);
+}
+
+TEST_CASE("parse_buffer_size throws errors on invalid input", "[parse_buffer_size]") {
+    CHECK_THROWS_AS(sik::parse_buffer_size("0"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_buffer_size("-1"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_buffer_size("abc"), sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_buffer_size("42 42"), sik::ParseException);
+}
+
 TEST_CASE("parse_character returns proper data", "[parse_character]") {
     CHECK(sik::parse_character("a") == 'a');
     CHECK(sik::parse_character("0") == '0');
@@ -46,4 +59,56 @@ TEST_CASE("parse_timestamp throws errors on invalid input", "[parse_timestamp]")
     CHECK_THROWS_AS(sik::parse_timestamp("abc"), sik::ParseException);
     CHECK_THROWS_AS(sik::parse_timestamp("42abc"), sik::ParseException);
     REQUIRE_THROWS_AS(sik::parse_timestamp("42 42"), sik::ParseException);
-}
\ No newline at end of file
+}
+TEST_CASE("parse_slow_client_action parses policy names", "[parse_slow_client_action]") {
+    CHECK(sik::parse_slow_client_action("none") == sik::SlowClientAction::NONE);
+    CHECK(sik::parse_slow_client_action("skip") == sik::SlowClientAction::SKIP);
+    CHECK(sik::parse_slow_client_action("defer") == sik::SlowClientAction::DEFER);
+    CHECK(sik::parse_slow_client_action("suspend") == sik::SlowClientAction::SUSPEND);
+    CHECK_THROWS_AS(sik::parse_slow_client_action(""), sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_slow_client_action("Skip"), sik::ParseException);
+}
+
+TEST_CASE("parse_frame_budget accepts lengths of UDP payload", "[parse_frame_budget]") {
+    CHECK(sik::parse_frame_budget("1") == 1u);
+    CHECK(sik::parse_frame_budget("1472") == 1472u);
+    CHECK(sik::parse_frame_budget("65507") == 65507u);
+    CHECK_THROWS_AS(sik::parse_frame_budget("0"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_frame_budget("65508"), sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_frame_budget("1k"), sik::ParseException);
+}
+
+TEST_CASE("parse_chunk_size accepts lengths carried by every path", "[parse_chunk_size]") {
+    CHECK(sik::parse_chunk_size("548") == 548u);
+    CHECK(sik::parse_chunk_size("1472") == 1472u);
+    CHECK(sik::parse_chunk_size("65507") == 65507u);
+    CHECK_THROWS_AS(sik::parse_chunk_size("547"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_chunk_size("65508"), sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_chunk_size("-1400"), sik::ParseException);
+}
+
+TEST_CASE("parse_duplicate_window accepts up to an hour", "[parse_duplicate_window]") {
+    CHECK(sik::parse_duplicate_window("1") == 1);
+    CHECK(sik::parse_duplicate_window("3600") == 3600);
+    CHECK_THROWS_AS(sik::parse_duplicate_window("0"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_duplicate_window("3601"), sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_duplicate_window("5s"), sik::ParseException);
+}
+
+TEST_CASE("parse_retransmission_rate accepts positive rates", "[parse_retransmission_rate]") {
+    CHECK(sik::parse_retransmission_rate("1") == 1u);
+    CHECK(sik::parse_retransmission_rate("1000000") == 1000000u);
+    CHECK_THROWS_AS(sik::parse_retransmission_rate("0"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_retransmission_rate("1000001"),
+                    sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_retransmission_rate("-1"),
+                      sik::ParseException);
+}
+
+TEST_CASE("parse_parity_group accepts supported group sizes", "[parse_parity_group]") {
+    CHECK(sik::parse_parity_group("2") == 2u);
+    CHECK(sik::parse_parity_group("32") == 32u);
+    CHECK_THROWS_AS(sik::parse_parity_group("1"), sik::ParseException);
+    CHECK_THROWS_AS(sik::parse_parity_group("33"), sik::ParseException);
+    REQUIRE_THROWS_AS(sik::parse_parity_group("4x"), sik::ParseException);
+}
@@ -1,3 +1,5 @@
+#include <cstring>
+#include <sstream>
 #include "catch.hpp"
 #include "../protocol.h"
 
@@ -90,4 +92,226 @@ TEST_CASE("Message ostream << operator returns proper data", "[Message]") {
     sik::Message m(654321u, 'a', "Ala ma kota");
     ss << m;
     REQUIRE(ss.str() == "654321 a Ala ma kota");
-}
\ No newline at end of file
+}
+TEST_CASE("MessageView reads unaligned datagrams without copying", "[MessageView]") {
+    char datagram[1 + 9 + 3];
+    uint64_t timestamp = htobe64(654321u);
+    std::memcpy(datagram + 1, &timestamp, sizeof(timestamp));
+    datagram[9] = 'c';
+    std::memcpy(datagram + 10, "Ala", 3);
+
+    sik::MessageView view(datagram + 1, sizeof(datagram) - 1);
+    CHECK(view.get_timestamp() == 654321u);
+    CHECK(view.get_character() == 'c');
+    CHECK(view.has_message());
+    CHECK(view.get_message() == "Ala");
+    CHECK(view.get_message().data() == datagram + 10);
+
+    sik::MessageView header(datagram + 1, 9u);
+    CHECK_FALSE(header.has_message());
+    REQUIRE_THROWS_AS(sik::MessageView(datagram + 1, 8u), std::invalid_argument);
+}
+
+TEST_CASE("MessageView trims content at null character", "[MessageView]") {
+    char datagram[] = "        dAla\0ma kota";
+    uint64_t timestamp = htobe64(42u);
+    std::memcpy(datagram, &timestamp, sizeof(timestamp));
+
+    sik::MessageView view(datagram, sizeof(datagram) - 1);
+    CHECK(view.get_message().length() == 11u);
+    view.trim_at_null();
+    CHECK(view.get_message() == "Ala");
+
+    sik::Message message(view);
+    std::stringstream ss;
+    ss << view;
+    CHECK(ss.str() == "42 d Ala");
+    REQUIRE(message.get_message() == "Ala");
+}
+
+TEST_CASE("Datagram is serialized once and shared by copies", "[Datagram]") {
+    sik::Message m(654321u, 'a', "");
+    sik::Datagram datagram(m, "Ala ma kota", true);
+    CHECK(datagram.length() == 9u + 11u + 1u);
+    CHECK(datagram.data()[datagram.length() - 1] == '\0');
+
+    sik::Datagram copy = datagram;
+    CHECK(copy.data() == datagram.data());
+
+    sik::MessageView view(datagram.data(), datagram.length() - 1);
+    CHECK(view.get_timestamp() == 654321u);
+    CHECK(view.get_character() == 'a');
+    CHECK(view.get_message() == "Ala ma kota");
+
+    CHECK(sik::Datagram().empty());
+    REQUIRE(sik::Datagram(m, "", false).length() == 9u);
+}
+
+TEST_CASE("Datagram reuses buffers of released datagrams", "[Datagram]") {
+    sik::Message m(654321u, 'a', "");
+    const char *bytes;
+    {
+        sik::Datagram datagram(m, "Ala ma kota", true);
+        sik::Datagram copy = datagram;
+        bytes = datagram.data();
+    }
+    sik::Datagram shorter(m, "Ala", true);
+    CHECK(shorter.data() == bytes);
+    CHECK(shorter.length() == 9u + 3u + 1u);
+    CHECK(shorter.data()[shorter.length() - 1] == '\0');
+    REQUIRE(sik::MessageView(shorter.data(), shorter.length() - 1)
+                    .get_message() == "Ala");
+}
+
+TEST_CASE("request_extension announces features", "[extension]") {
+    sik::Message m(42u, 'a', "");
+    sik::Datagram request(m, sik::request_extension(0x0102u), false);
+    REQUIRE(request.length() == 12u);
+
+    sik::features_t features = sik::NO_FEATURES;
+    CHECK(sik::read_request_extension(request.data(), request.length(),
+                                      features));
+    CHECK(features == 0x0102u);
+    CHECK_FALSE(sik::read_request_extension(request.data(), 9u, features));
+    std::string other(request.data(), request.length());
+    other[9] = 'x';
+    REQUIRE_FALSE(sik::read_request_extension(other.data(), other.length(),
+                                              features));
+}
+
+TEST_CASE("request_extension echoes cookie", "[extension]") {
+    sik::Message m(42u, 'a', "");
+    sik::Datagram request(m, sik::request_extension(0x0102u, 0xc0ffeeu),
+                          false);
+    REQUIRE(request.length() == 20u);
+
+    sik::features_t features = sik::NO_FEATURES;
+    sik::cookie_t cookie = sik::NO_COOKIE;
+    CHECK(sik::read_request_extension(request.data(), request.length(),
+                                      features, cookie));
+    CHECK(features == 0x0102u);
+    CHECK(cookie == 0xc0ffeeu);
+    CHECK(sik::read_request_extension(request.data(), 12u, features, cookie));
+    REQUIRE(cookie == sik::NO_COOKIE);
+}
+
+TEST_CASE("cookie_offer is read back", "[extension]") {
+    sik::Datagram offer = sik::cookie_offer(0x0102030405060708u);
+    REQUIRE(offer.length() == 9u);
+
+    sik::cookie_t cookie = sik::NO_COOKIE;
+    CHECK(sik::read_cookie_offer(offer.data(), offer.length(), cookie));
+    CHECK(cookie == 0x0102030405060708u);
+    sik::Datagram message(sik::Message(42u, 'a', ""), "", false);
+    REQUIRE_FALSE(sik::read_cookie_offer(message.data(), message.length(),
+                                         cookie));
+}
+
+TEST_CASE("Sequence number is read back", "[extension]") {
+    char prefix[sik::SEQUENCE_HEADER_SIZE];
+    sik::write_sequence(prefix, 0x01020304u);
+    CHECK(prefix[0] == sik::SEQUENCE_MARKER);
+    CHECK(prefix[1] == '\x01');
+    CHECK(prefix[4] == '\x04');
+
+    uint32_t sequence = 0u;
+    CHECK(sik::read_sequence(prefix, sizeof(prefix), sequence));
+    CHECK(sequence == 0x01020304u);
+    CHECK_FALSE(sik::read_sequence(prefix, sizeof(prefix) - 1u, sequence));
+    sik::Datagram message(sik::Message(1u, 'a', "text"), "", false);
+    REQUIRE_FALSE(sik::read_sequence(message.data(), message.length(),
+                                     sequence));
+}
+
+TEST_CASE("Report of missing datagrams is read back", "[extension]") {
+    std::string report = sik::nack(0xfffffffeu, 3u);
+    REQUIRE(report.length() == 7u);
+    CHECK(report[0] == sik::NACK_MARKER);
+
+    uint32_t first = 0u;
+    uint16_t count = 0u;
+    CHECK(sik::read_nack(report.data(), report.length(), first, count));
+    CHECK(first == 0xfffffffeu);
+    CHECK(count == 3u);
+    CHECK_FALSE(sik::read_nack(report.data(), report.length() - 1u, first,
+                               count));
+    std::string empty = sik::nack(1u, 0u);
+    REQUIRE_FALSE(sik::read_nack(empty.data(), empty.length(), first, count));
+}
+
+TEST_CASE("Frame packs messages read back by FrameReader", "[Frame]") {
+    sik::Datagram first(sik::Message(1u, 'a', ""), "Ala", true);
+    sik::Datagram second(sik::Message(2u, 'b', ""), "ma kota", true);
+    CHECK_FALSE(sik::is_frame(first.data(), first.length()));
+
+    sik::Frame frame;
+    frame.append(first.data(), first.length());
+    frame.append(second.data(), second.length());
+    CHECK(frame.count() == 2u);
+    CHECK(frame.length() == sik::FRAME_HEADER_SIZE
+                            + sik::Frame::entry_length(first.length())
+                            + sik::Frame::entry_length(second.length()));
+
+    sik::Datagram datagram = frame.to_datagram();
+    CHECK(frame.count() == 0u);
+    CHECK(sik::is_frame(datagram.data(), datagram.length()));
+
+    sik::FrameReader reader(datagram.data(), datagram.length());
+    boost::string_view message;
+    REQUIRE(reader.next(message));
+    sik::MessageView view = sik::MessageView::with_text(message.data(),
+                                                        message.length());
+    CHECK(view.get_timestamp() == 1u);
+    CHECK(view.get_message() == "Ala");
+    REQUIRE(reader.next(message));
+    CHECK(sik::MessageView::with_text(message.data(), message.length())
+                  .get_message() == "ma kota");
+    REQUIRE_FALSE(reader.next(message));
+}
+
+TEST_CASE("FrameReader rejects truncated frames", "[Frame]") {
+    sik::Datagram message(sik::Message(1u, 'a', ""), "Ala", true);
+    sik::Frame frame;
+    frame.append(message.data(), message.length());
+    sik::Datagram datagram = frame.to_datagram();
+
+    CHECK_THROWS_AS(sik::FrameReader(message.data(), message.length()),
+                    std::invalid_argument);
+    sik::FrameReader reader(datagram.data(), datagram.length() - 1u);
+    boost::string_view entry;
+    REQUIRE_THROWS_AS(reader.next(entry), std::invalid_argument);
+}
+
+TEST_CASE("Content reference replaces content with its identifier", "[reference]") {
+    sik::content_id_t id = sik::content_id("Ala ma kota");
+    CHECK(id != sik::content_id("Ala ma psa"));
+    CHECK(sik::content_id("") == 14695981039346656037u);
+
+    sik::Datagram datagram = sik::reference_datagram(
+            sik::Message(42u, 'x', ""), id);
+    CHECK(datagram.length() == 18u);
+    CHECK(sik::is_reference(datagram.data(), datagram.length()));
+
+    sik::content_id_t read = 0u;
+    sik::MessageView header = sik::read_reference(datagram.data(),
+                                                  datagram.length(), read);
+    CHECK(read == id);
+    CHECK(header.get_timestamp() == 42u);
+    CHECK(header.get_character() == 'x');
+    CHECK_FALSE(header.has_message());
+    REQUIRE_THROWS_AS(sik::read_reference(datagram.data(), 17u, read),
+                      std::invalid_argument);
+}
+
+TEST_CASE("Acknowledgement carries content identifier", "[reference]") {
+    std::string bytes = sik::acknowledgement(0x0102030405060708u);
+    REQUIRE(bytes.length() == 9u);
+
+    sik::content_id_t id = 0u;
+    CHECK(sik::read_acknowledgement(bytes.data(), bytes.length(), id));
+    CHECK(id == 0x0102030405060708u);
+    // Requests have the same length, but start with a valid timestamp.
+    std::string request = sik::Message(42u, 'a', "").to_bytes();
+    REQUIRE_FALSE(sik::read_acknowledgement(request.data(), request.length(),
+                                            id));
+}
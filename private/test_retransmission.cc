@@ -0,0 +1,47 @@
+#include "catch.hpp"
+#include "../retransmission.h"
+
+TEST_CASE("RetransmissionHistory keeps the latest datagrams of a client", "[retransmission]") {
+    CHECK_THROWS_AS(sik::RetransmissionHistory(0u), std::invalid_argument);
+
+    sik::RetransmissionHistory history(4u);
+    sik::Datagram first(std::string("first"));
+    sik::Datagram fifth(std::string("fifth"));
+    CHECK(history.find(1u, 0u) == nullptr);
+    history.record(1u, 10u, first);
+    CHECK(history.find(1u, 10u)->data() == first.data());
+    CHECK(history.find(2u, 10u) == nullptr);
+    CHECK(history.find(1u, 11u) == nullptr);
+
+    // Datagram sent depth datagrams later takes the place of the first.
+    history.record(1u, 14u, fifth);
+    CHECK(history.find(1u, 10u) == nullptr);
+    CHECK(history.find(1u, 14u)->data() == fifth.data());
+    REQUIRE(history.size() == 1u);
+}
+
+TEST_CASE("RetransmissionHistory prunes clients no longer kept", "[retransmission]") {
+    sik::RetransmissionHistory history;
+    sik::Datagram datagram(std::string("datagram"));
+    for (sik::address_t key = 1u; key <= 100u; key++) {
+        history.record(key, 0u, datagram);
+    }
+    history.prune([](sik::address_t key) {
+        return key % 2u == 0u;
+    });
+    CHECK(history.size() == 50u);
+    CHECK(history.find(1u, 0u) == nullptr);
+    REQUIRE(history.find(2u, 0u) != nullptr);
+}
+
+TEST_CASE("RetransmissionLimit allows rate retransmissions per second", "[retransmission]") {
+    sik::RetransmissionLimit disabled;
+    CHECK_FALSE(disabled.is_enabled());
+
+    sik::RetransmissionLimit limit(2u);
+    CHECK(limit.is_enabled());
+    CHECK(limit.take(1000));
+    CHECK(limit.take(1000));
+    CHECK_FALSE(limit.take(1000));
+    REQUIRE(limit.take(1001));
+}
@@ -0,0 +1,61 @@
+#include "catch.hpp"
+#include "../sequence.h"
+
+TEST_CASE("SequenceTracker counts gaps as lost", "[sequence]") {
+    sik::SequenceTracker tracker;
+    uint32_t missing;
+    CHECK(tracker.loss_rate() == 0.0);
+    // Numbers before the first one were sent before the client started.
+    CHECK(tracker.record(100u, missing));
+    CHECK(missing == 0u);
+    CHECK(tracker.record(101u, missing));
+    CHECK(tracker.record(104u, missing));
+    CHECK(missing == 2u);
+    CHECK(tracker.get_received() == 3u);
+    CHECK(tracker.get_lost() == 2u);
+    CHECK(tracker.get_reordered() == 0u);
+    REQUIRE(tracker.loss_rate() == Approx(0.4));
+}
+
+TEST_CASE("SequenceTracker corrects loss for late datagrams", "[sequence]") {
+    sik::SequenceTracker tracker;
+    uint32_t missing;
+    tracker.record(0u, missing);
+    tracker.record(2u, missing);
+    CHECK(tracker.record(1u, missing));
+    CHECK(missing == 0u);
+    CHECK(tracker.get_received() == 3u);
+    CHECK(tracker.get_lost() == 0u);
+    REQUIRE(tracker.get_reordered() == 1u);
+}
+
+TEST_CASE("SequenceTracker recognizes duplicates", "[sequence]") {
+    sik::SequenceTracker tracker;
+    uint32_t missing;
+    tracker.record(0u, missing);
+    tracker.record(3u, missing);
+    CHECK_FALSE(tracker.record(3u, missing));
+    CHECK_FALSE(tracker.record(0u, missing));
+    CHECK(tracker.record(1u, missing));
+    CHECK_FALSE(tracker.record(1u, missing));
+    CHECK(tracker.get_lost() == 1u);
+    CHECK(tracker.get_duplicates() == 3u);
+
+    // Datagrams older than the window cannot be told from duplicates.
+    tracker.record(3u + sik::SEQUENCE_WINDOW, missing);
+    CHECK(missing == sik::SEQUENCE_WINDOW - 1u);
+    CHECK_FALSE(tracker.record(2u, missing));
+    REQUIRE(tracker.record(4u, missing));
+}
+
+TEST_CASE("SequenceTracker handles wrap around", "[sequence]") {
+    sik::SequenceTracker tracker;
+    uint32_t missing;
+    tracker.record(UINT32_MAX - 1u, missing);
+    tracker.record(UINT32_MAX, missing);
+    tracker.record(1u, missing);
+    CHECK(missing == 1u);
+    CHECK(tracker.get_lost() == 1u);
+    CHECK(tracker.record(0u, missing));
+    REQUIRE(tracker.get_lost() == 0u);
+}
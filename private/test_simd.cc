@@ -0,0 +1,124 @@
+#include <cstring>
+#include <random>
+#include <vector>
+#include <endian.h>
+#include "catch.hpp"
+#include "../simd.h"
+
+namespace {
+    const std::size_t STRIDE = 16u;
+    const uint64_t MAX = 71728934399u;
+
+    /**
+     * Headers with edge case timestamps and lengths.
+     */
+    struct Headers {
+        std::vector<char> slots;
+        std::vector<uint32_t> lengths;
+
+        explicit Headers(std::size_t count)
+                : slots(count * STRIDE), lengths(count) {
+            std::mt19937_64 random(42u);
+            const uint64_t edges[] = {0u, 1u, MAX - 1u, MAX, MAX + 1u,
+                                      (uint64_t) 1 << 63u, ~(uint64_t) 0};
+            for (std::size_t i = 0u; i < count; i++) {
+                uint64_t timestamp = i % 3u == 0u ? edges[i % 7u]
+                                                  : random() % (2u * MAX);
+                uint64_t big_endian = htobe64(timestamp);
+                std::memcpy(&slots[i * STRIDE], &big_endian, sizeof(big_endian));
+                slots[i * STRIDE + 8u] = (char) ('a' + i % 26u);
+                lengths[i] = i % 5u == 0u ? (uint32_t) (i % 17u) : 9u;
+            }
+        }
+    };
+}
+
+TEST_CASE("validate_headers_scalar decodes and checks headers", "[simd]") {
+    const uint64_t values[] = {0u, MAX, MAX + 1u, (uint64_t) 1 << 63u, 7u};
+    const uint32_t lengths[] = {9u, 9u, 9u, 9u, 16u};
+    char slots[5 * STRIDE];
+    for (std::size_t i = 0u; i < 5u; i++) {
+        uint64_t big_endian = htobe64(values[i]);
+        std::memcpy(&slots[i * STRIDE], &big_endian, sizeof(big_endian));
+        slots[i * STRIDE + 8u] = (char) ('a' + i);
+    }
+    uint64_t timestamps[5];
+    char characters[5];
+    uint64_t accept = sik::validate_headers_scalar(
+            slots, STRIDE, lengths, 5u, 9u, MAX, timestamps, characters);
+
+    CHECK(timestamps[1] == MAX);
+    CHECK(characters[1] == 'b');
+    REQUIRE(accept == 0x3u);
+}
+
+TEST_CASE("validate_headers variants agree with scalar version", "[simd]") {
+    for (std::size_t count: {1u, 2u, 3u, 5u, 31u, 64u}) {
+        Headers headers(count);
+        uint64_t expected_timestamps[64], timestamps[64];
+        char expected_characters[64], characters[64];
+        uint64_t expected = sik::validate_headers_scalar(
+                headers.slots.data(), STRIDE, headers.lengths.data(), count,
+                9u, MAX, expected_timestamps, expected_characters);
+
+        uint64_t accept = sik::validate_headers(
+                headers.slots.data(), STRIDE, headers.lengths.data(), count,
+                9u, MAX, timestamps, characters);
+        CHECK(accept == expected);
+        CHECK(std::memcmp(timestamps, expected_timestamps, count * 8u) == 0);
+        CHECK(std::memcmp(characters, expected_characters, count) == 0);
+
+#ifdef SIK_UDP_X86
+        if (sik::has_sse42()) {
+            accept = sik::validate_headers_sse42(
+                    headers.slots.data(), STRIDE, headers.lengths.data(),
+                    count, 9u, MAX, timestamps, characters);
+            CHECK(accept == expected);
+            CHECK(std::memcmp(timestamps, expected_timestamps, count * 8u) == 0);
+        }
+        if (sik::has_avx2()) {
+            accept = sik::validate_headers_avx2(
+                    headers.slots.data(), STRIDE, headers.lengths.data(),
+                    count, 9u, MAX, timestamps, characters);
+            CHECK(accept == expected);
+            CHECK(std::memcmp(timestamps, expected_timestamps, count * 8u) == 0);
+        }
+#endif
+    }
+}
+
+TEST_CASE("xor_into variants agree with scalar version", "[simd]") {
+    std::mt19937 random(7u);
+    for (std::size_t length: {0u, 1u, 7u, 8u, 15u, 16u, 31u, 33u, 64u, 100u,
+                              1500u}) {
+        std::vector<char> source(length + 1u), destination(length + 1u);
+        for (std::size_t i = 0u; i <= length; i++) {
+            source[i] = (char) random();
+            destination[i] = (char) random();
+        }
+        std::vector<char> expected = destination;
+        for (std::size_t i = 0u; i < length; i++) {
+            expected[i] ^= source[i];
+        }
+
+        // Unaligned by one byte, the byte past the end stays intact.
+        std::vector<char> result = destination;
+        sik::xor_into_scalar(result.data(), source.data(), length);
+        CHECK(result == expected);
+        result = destination;
+        sik::xor_into(result.data(), source.data(), length);
+        CHECK(result == expected);
+#ifdef SIK_UDP_X86
+        if (sik::has_sse2()) {
+            result = destination;
+            sik::xor_into_sse2(result.data(), source.data(), length);
+            CHECK(result == expected);
+        }
+        if (sik::has_avx2()) {
+            result = destination;
+            sik::xor_into_avx2(result.data(), source.data(), length);
+            CHECK(result == expected);
+        }
+#endif
+    }
+}
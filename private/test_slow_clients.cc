@@ -0,0 +1,79 @@
+#include "catch.hpp"
+#include "../slow_clients.h"
+
+TEST_CASE("SlowClients applies policy after threshold", "[SlowClients]") {
+    sik::SlowClientPolicy policy;
+    policy.action = sik::SlowClientAction::SUSPEND;
+    policy.threshold = 3u;
+    policy.suspension = 10;
+    sik::SlowClients clients(policy);
+
+    CHECK(clients.find(1u) == nullptr);
+    CHECK(clients.block(1u, 100, 2, 5u) == sik::SlowClientAction::NONE);
+    clients.deliver(1u);
+    CHECK(clients.block(1u, 100, 1, 4u) == sik::SlowClientAction::NONE);
+    CHECK(clients.block(1u, 100, 3, 4u) == sik::SlowClientAction::NONE);
+    CHECK_FALSE(clients.is_suspended(1u, 100));
+    CHECK(clients.block(1u, 100, 3, 4u) == sik::SlowClientAction::SUSPEND);
+
+    CHECK(clients.is_suspended(1u, 105));
+    CHECK_FALSE(clients.is_suspended(2u, 105));
+    CHECK_FALSE(clients.is_suspended(1u, 110));
+    clients.skip(1u);
+
+    const sik::ClientLag *lag = clients.find(1u);
+    REQUIRE(lag != nullptr);
+    CHECK(lag->blocks == 4u);
+    CHECK(lag->max_lag == 3);
+    CHECK(lag->outstanding == 4u);
+    CHECK(lag->penalties == 1u);
+    REQUIRE(lag->skipped == 2u);
+}
+
+TEST_CASE("SlowClients without policy only collects statistics", "[SlowClients]") {
+    sik::SlowClients clients;
+    for (int i = 0; i < 100; i++) {
+        CHECK(clients.block(7u, 100, 0, 0u) == sik::SlowClientAction::NONE);
+    }
+    std::size_t visited = 0u;
+    clients.visit([&visited](sik::address_t key, const sik::ClientLag &lag) {
+        CHECK(key == 7u);
+        CHECK(lag.blocks == 100u);
+        visited++;
+    });
+    REQUIRE(visited == 1u);
+}
+
+TEST_CASE("SlowClients credits every client of a delivered batch", "[SlowClients]") {
+    sik::SlowClientPolicy policy;
+    policy.action = sik::SlowClientAction::SKIP;
+    policy.threshold = 2u;
+    sik::SlowClients clients(policy);
+
+    const sik::address_t batch[] = {1u, 2u, 3u};
+    for (sik::address_t key: batch) {
+        CHECK(clients.block(key, 100, 0, 0u) == sik::SlowClientAction::NONE);
+    }
+    clients.deliver(batch, 2u);
+    CHECK(clients.block(1u, 100, 0, 0u) == sik::SlowClientAction::NONE);
+    CHECK(clients.block(2u, 100, 0, 0u) == sik::SlowClientAction::NONE);
+    // Client past the delivered part is not credited.
+    REQUIRE(clients.block(3u, 100, 0, 0u) == sik::SlowClientAction::SKIP);
+}
+
+TEST_CASE("SlowClients prunes clients no longer tracked", "[SlowClients]") {
+    sik::SlowClients clients;
+    clients.prune([](sik::address_t) {
+        return false;
+    });
+    for (sik::address_t key = 1u; key <= 100u; key++) {
+        clients.block(key, 100, 0, 0u);
+    }
+    CHECK(clients.size() == 100u);
+    clients.prune([](sik::address_t key) {
+        return key % 2u == 0u;
+    });
+    CHECK(clients.size() == 50u);
+    CHECK(clients.find(1u) == nullptr);
+    REQUIRE(clients.find(2u)->blocks == 1u);
+}
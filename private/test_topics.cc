@@ -0,0 +1,72 @@
+#include <algorithm>
+#include <vector>
+#include <arpa/inet.h>
+#include "catch.hpp"
+#include "../connections.h"
+
+TEST_CASE("TopicIndex moves clients between topics", "[TopicIndex]") {
+    sik::TopicIndex index;
+    index.subscribe(0u, 'a');
+    index.subscribe(1u, 'a');
+    index.subscribe(2u, 'b');
+    CHECK(index.get_subscribers('a').size() == 2);
+    CHECK(index.get_subscribers('b').size() == 1);
+
+    index.subscribe(0u, 'b');
+    CHECK(index.topic(0u) == 'b');
+    CHECK(index.get_subscribers('a') == std::vector<sik::TopicIndex::slot_t>{1u});
+    CHECK(index.get_subscribers('b').size() == 2);
+
+    index.unsubscribe(2u);
+    index.unsubscribe(2u);
+    CHECK_FALSE(index.is_subscribed(2u));
+    CHECK(index.get_subscribers('b') == std::vector<sik::TopicIndex::slot_t>{0u});
+    REQUIRE(index.get_subscribers('z').empty());
+}
+
+TEST_CASE("Connections topic recipients are connected subscribers", "[TopicIndex]") {
+    sik::Connections connections;
+    std::time_t now = 1000;
+
+    std::vector<sockaddr_in> clients(4);
+    for (std::size_t i = 0; i < clients.size(); i++) {
+        clients[i] = sockaddr_in();
+        clients[i].sin_family = AF_INET;
+        clients[i].sin_addr.s_addr = inet_addr("10.0.0.1");
+        clients[i].sin_port = htons((uint16_t) (10000u + i));
+    }
+    connections.add_client(clients[0], now, 'a');
+    connections.add_client(clients[1], now, 'a');
+    connections.add_client(clients[2], now, 'b');
+    connections.add_client(clients[3], now);
+
+    std::vector<sik::address_t> received;
+    sik::Connections::Recipients recipients;
+    connections.get_recipients(now, &clients[0], 'a', recipients);
+    sik::address_t key;
+    while (recipients.next(key)) {
+        received.push_back(key);
+    }
+    CHECK(recipients.done());
+    CHECK(received == std::vector<sik::address_t>{
+            sik::pack_address(clients[1])});
+
+    // Client changing topic keeps receiving messages of the new one only.
+    connections.add_client(clients[1], now + 10, 'b');
+    received.clear();
+    connections.get_recipients(now + 10, nullptr, 'b', recipients);
+    while (recipients.next(key)) {
+        received.push_back(key);
+    }
+    std::sort(received.begin(), received.end());
+    std::vector<sik::address_t> expected{sik::pack_address(clients[1]),
+                                         sik::pack_address(clients[2])};
+    std::sort(expected.begin(), expected.end());
+    CHECK(received == expected);
+
+    // Expired subscribers are gone.
+    connections.expire(now + 10 + sik::TIMEOUT + 1);
+    connections.get_recipients(now + 10 + sik::TIMEOUT + 1, nullptr, 'b',
+                               recipients);
+    REQUIRE_FALSE(recipients.next(key));
+}
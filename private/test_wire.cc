@@ -0,0 +1,39 @@
+#include <cstring>
+#include <tuple>
+
+#include "catch.hpp"
+#include "../wire.h"
+
+namespace {
+    using Schema = sik::WireSchema<char, uint64_t, uint16_t, uint32_t>;
+
+    static_assert(Schema::size == 15u, "Fields are packed");
+    static_assert(Schema::offset<0u>() == 0u, "First field starts schema");
+    static_assert(Schema::offset<1u>() == 1u, "Offsets are unaligned");
+    static_assert(Schema::offset<2u>() == 9u, "Offsets follow sizes");
+    static_assert(Schema::offset<3u>() == 11u, "Offsets follow sizes");
+}
+
+TEST_CASE("WireSchema encodes fields in network byte order", "[WireSchema]") {
+    char bytes[Schema::size + 1u];
+    Schema::encode(bytes + 1, 'x', 0x0102030405060708u, 0x090au, 0x0b0c0d0eu);
+
+    const unsigned char expected[] = {'x', 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+                                      12, 13, 14};
+    REQUIRE(std::memcmp(bytes + 1, expected, sizeof(expected)) == 0);
+}
+
+TEST_CASE("WireSchema decodes unaligned fields", "[WireSchema]") {
+    char bytes[Schema::size + 3u];
+    Schema::encode(bytes + 3, 'y', 71728934399u, 65535u, 42u);
+
+    CHECK(Schema::get<0u>(bytes + 3) == 'y');
+    CHECK(Schema::get<1u>(bytes + 3) == 71728934399u);
+    CHECK(Schema::get<2u>(bytes + 3) == 65535u);
+    CHECK(Schema::get<3u>(bytes + 3) == 42u);
+
+    Schema::set<2u>(bytes + 3, 7u);
+    REQUIRE(Schema::decode(bytes + 3)
+            == std::make_tuple('y', (uint64_t) 71728934399u, (uint16_t) 7u,
+                               (uint32_t) 42u));
+}
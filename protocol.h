@@ -6,6 +6,13 @@
 #include <endian.h>
 #include <cstring>
 #include <stdexcept>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+#include "arena.h"
+#include "wire.h"
 
 namespace sik {
     using timestamp_t = uint64_t;
@@ -15,6 +22,171 @@ namespace sik {
     /// Maximum IP Packet size - 64KB.
     const std::size_t PACKET_SIZE = 65536u;
 
+    /// Set of protocol extensions, one bit each.
+    using features_t = uint16_t;
+    /// No protocol extensions, the original single message format.
+    const features_t NO_FEATURES = 0u;
+    /// Several messages may be packed into a single frame.
+    const features_t FEATURE_FRAMES = 1u << 0u;
+    /// Message text may be compressed.
+    const features_t FEATURE_COMPRESSION = 1u << 1u;
+    /// Message text may be replaced by the identifier of content the client
+    /// acknowledged.
+    const features_t FEATURE_CONTENT_ID = 1u << 2u;
+    /// Messages longer than the path MTU may be split into chunks.
+    const features_t FEATURE_CHUNKS = 1u << 3u;
+    /// Requests may be refused with a cookie the client has to echo.
+    const features_t FEATURE_COOKIES = 1u << 4u;
+    /// Every datagram is preceded by a sequence number of the client.
+    const features_t FEATURE_SEQUENCE = 1u << 5u;
+    /// Numbered datagrams reported missing by the client are sent again.
+    const features_t FEATURE_RETRANSMISSION = 1u << 6u;
+    /// Every group of numbered datagrams is followed by their XOR parity.
+    const features_t FEATURE_PARITY = 1u << 7u;
+    /// Extensions understood by this implementation.
+    const features_t SUPPORTED_FEATURES
+            = FEATURE_FRAMES | FEATURE_COMPRESSION | FEATURE_CONTENT_ID
+              | FEATURE_CHUNKS | FEATURE_COOKIES | FEATURE_SEQUENCE
+              | FEATURE_RETRANSMISSION | FEATURE_PARITY;
+    /// Set by the server once the client acknowledged the content, never
+    /// announced by clients.
+    const features_t CONTENT_ACKNOWLEDGED = 1u << 15u;
+
+    /// Identifier of the file content.
+    using content_id_t = uint64_t;
+
+    /// Proof that the client receives datagrams sent to its address.
+    using cookie_t = uint64_t;
+    /// No cookie, never issued by the server.
+    const cookie_t NO_COOKIE = 0u;
+
+    /// Message header: timestamp and character.
+    using HeaderSchema = WireSchema<timestamp_t, char>;
+    /// Fields of HeaderSchema.
+    enum HeaderField : std::size_t {
+        HEADER_TIMESTAMP, HEADER_CHARACTER
+    };
+    static_assert(HeaderSchema::size == 9u, "Header must take 9 bytes");
+
+    /// Extension following a request header: marker and features.
+    using ExtensionSchema = WireSchema<char, features_t>;
+    /// Fields of ExtensionSchema.
+    enum ExtensionField : std::size_t {
+        EXTENSION_MARKER_FIELD, EXTENSION_FEATURES
+    };
+
+    /// Cookie echoed by the client after the extension.
+    using CookieSchema = WireSchema<cookie_t>;
+
+    /// Cookie offered by the server: marker and cookie.
+    using CookieOfferSchema = WireSchema<char, cookie_t>;
+    /// Fields of CookieOfferSchema.
+    enum CookieOfferField : std::size_t {
+        COOKIE_MARKER_FIELD, COOKIE_OFFERED
+    };
+    static_assert(CookieOfferSchema::size == HeaderSchema::size,
+                  "Cookie offer must not be longer than a request");
+
+    /// Sequence number preceding a datagram: marker and number.
+    using SequenceSchema = WireSchema<char, uint32_t>;
+    /// Fields of SequenceSchema.
+    enum SequenceField : std::size_t {
+        SEQUENCE_MARKER_FIELD, SEQUENCE_NUMBER
+    };
+
+    /// Message referring to content: marker, header and content identifier.
+    using ReferenceSchema = WireSchema<char, timestamp_t, char, content_id_t>;
+    /// Fields of ReferenceSchema.
+    enum ReferenceField : std::size_t {
+        REFERENCE_MARKER_FIELD, REFERENCE_TIMESTAMP, REFERENCE_CHARACTER,
+        REFERENCE_ID
+    };
+    static_assert(ReferenceSchema::offset<REFERENCE_TIMESTAMP>() == 1u,
+                  "Reference must embed the header after the marker");
+
+    /// Acknowledgement of content: marker and content identifier.
+    using AcknowledgementSchema = WireSchema<char, content_id_t>;
+    /// Fields of AcknowledgementSchema.
+    enum AcknowledgementField : std::size_t {
+        ACKNOWLEDGEMENT_MARKER_FIELD, ACKNOWLEDGEMENT_ID
+    };
+    static_assert(AcknowledgementSchema::size == HeaderSchema::size,
+                  "Acknowledgement must fit in a request slot");
+
+    /// Report of missing datagrams: marker, sequence number of the first
+    /// one and their number.
+    using NackSchema = WireSchema<char, uint32_t, uint16_t>;
+    /// Fields of NackSchema.
+    enum NackField : std::size_t {
+        NACK_MARKER_FIELD, NACK_FIRST, NACK_COUNT
+    };
+
+    /// Parity of a group of numbered datagrams before the XOR of their
+    /// bytes: marker, sequence number of the first datagram, number of
+    /// datagrams and XOR of their lengths.
+    using ParitySchema = WireSchema<char, uint32_t, uint8_t, uint32_t>;
+    /// Fields of ParitySchema.
+    enum ParityField : std::size_t {
+        PARITY_MARKER_FIELD, PARITY_FIRST, PARITY_COUNT, PARITY_LENGTH
+    };
+
+    /// Frame header: marker and number of messages.
+    using FrameSchema = WireSchema<char, uint8_t>;
+    /// Fields of FrameSchema.
+    enum FrameField : std::size_t {
+        FRAME_MARKER_FIELD, FRAME_COUNT
+    };
+    /// Header of a message in a frame: message length.
+    using FrameEntrySchema = WireSchema<uint16_t>;
+
+    /// Chunk of a long message: marker, message identifier, chunk index,
+    /// number of chunks and message length.
+    using ChunkSchema = WireSchema<char, uint32_t, uint16_t, uint16_t,
+            uint32_t>;
+    /// Fields of ChunkSchema.
+    enum ChunkField : std::size_t {
+        CHUNK_MARKER_FIELD, CHUNK_MESSAGE_ID, CHUNK_INDEX, CHUNK_COUNT,
+        CHUNK_MESSAGE_LENGTH
+    };
+
+    /// Byte following the header of a request announcing extensions.
+    const char EXTENSION_MARKER = '\xe5';
+    /// First byte of a frame. Messages start with the most significant byte
+    /// of a valid timestamp, which is always 0.
+    const char FRAME_MARKER = '\xff';
+    /// First byte of a message with compressed text.
+    const char COMPRESSED_MARKER = '\xfe';
+    /// First byte of a message referring to acknowledged content.
+    const char REFERENCE_MARKER = '\xfd';
+    /// First byte of a client acknowledgement of the content.
+    const char ACKNOWLEDGEMENT_MARKER = '\xac';
+    /// First byte of a chunk of a long message.
+    const char CHUNK_MARKER = '\xfc';
+    /// First byte of a cookie offered by the server.
+    const char COOKIE_MARKER = '\xc0';
+    /// First byte of a sequence number preceding a datagram.
+    const char SEQUENCE_MARKER = '\xfb';
+    /// First byte of a client report of missing datagrams.
+    const char NACK_MARKER = '\xad';
+    /// First byte of a parity of numbered datagrams.
+    const char PARITY_MARKER = '\xfa';
+    /// Bytes of a frame header: marker and number of messages.
+    const std::size_t FRAME_HEADER_SIZE = FrameSchema::size;
+    /// Bytes preceding every message in a frame: its big endian length.
+    const std::size_t FRAME_ENTRY_HEADER_SIZE = FrameEntrySchema::size;
+    /// Maximum number of messages in a frame.
+    const std::size_t MAX_FRAME_MESSAGES = 255u;
+    /// Maximum frame length, the largest UDP payload over IPv4.
+    const std::size_t MAX_FRAME_LENGTH = 65507u;
+    /// Bytes preceding a datagram with a sequence number.
+    const std::size_t SEQUENCE_HEADER_SIZE = SequenceSchema::size;
+    /// Bytes of a parity datagram before the XOR of datagram bytes.
+    const std::size_t PARITY_HEADER_SIZE = ParitySchema::size;
+    /// Bytes of a chunk header.
+    const std::size_t CHUNK_HEADER_SIZE = ChunkSchema::size;
+    /// Maximum length of a message delivered in chunks.
+    const std::size_t MAX_MESSAGE_LENGTH = 1u << 24u;
+
     /**
      * Validates timestamp.
      * @param timestamp timestamp to validate.
@@ -24,6 +196,119 @@ namespace sik {
         return timestamp <= MAX_TIMESTAMP;
     }
 
+    /**
+     * Non-owning message read straight from a datagram:
+     * - 8 bytes as timestamp (timestamp_t in big endian)
+     * - 1 byte as character (char)
+     * - remaining bytes as message
+     * Message refers to the datagram memory and is valid as long as it is.
+     */
+    class MessageView {
+    private:
+        /// Message timestamp
+        timestamp_t timestamp;
+        /// Message character.
+        char character;
+        /// Message content.
+        boost::string_view message;
+
+    public:
+        /// Bytes offset of message content.
+        static const std::size_t message_offset = HeaderSchema::size;
+
+        /**
+         * Decodes message header, content is everything after it.
+         * @param bytes datagram.
+         * @param length datagram length.
+         * @throws std::invalid_argument when datagram is too short or
+         * timestamp is invalid.
+         */
+        MessageView(const char *bytes, std::size_t length) {
+            if (length < message_offset) {
+                throw std::invalid_argument("Invalid message data");
+            }
+            timestamp = HeaderSchema::get<HEADER_TIMESTAMP>(bytes);
+            character = HeaderSchema::get<HEADER_CHARACTER>(bytes);
+            message = boost::string_view(bytes + message_offset,
+                                         length - message_offset);
+            if (!is_proper_timestamp(timestamp)) {
+                throw std::invalid_argument("Invalid timestamp");
+            }
+        }
+
+        /**
+         * Decodes message sent by the server: header followed by a null
+         * terminated text. Text ends at its first NULL character.
+         * @param bytes datagram.
+         * @param length datagram length.
+         * @return message without the terminating NULL character.
+         * @throws std::invalid_argument when datagram is not a valid message
+         * with text.
+         */
+        static MessageView with_text(const char *bytes, std::size_t length) {
+            if (length <= message_offset) {
+                throw std::invalid_argument("Message must contain text");
+            } else if (bytes[length - 1] != '\0') {
+                throw std::invalid_argument(
+                        "Message text must be null terminated");
+            }
+            // Null character terminates the text, it is not a part of it.
+            MessageView view(bytes, length - 1u);
+            view.trim_at_null();
+            return view;
+        }
+
+        /**
+         * Drops everything from the first NULL character of the content.
+         */
+        void trim_at_null() noexcept {
+            std::size_t end = message.find('\0');
+            if (end != boost::string_view::npos) {
+                message = message.substr(0, end);
+            }
+        }
+
+        /**
+         * @return whether message content is not empty.
+         */
+        bool has_message() const noexcept {
+            return !message.empty();
+        }
+
+        /**
+         * @return message timestamp.
+         */
+        timestamp_t get_timestamp() const noexcept {
+            return timestamp;
+        }
+
+        /**
+         * @return message character.
+         */
+        char get_character() const noexcept {
+            return character;
+        }
+
+        /**
+         * @return message content.
+         */
+        boost::string_view get_message() const noexcept {
+            return message;
+        }
+    };
+
+    /**
+     * Prints MessageView.
+     * @param os stream to print to.
+     * @param m message to print.
+     * @return stream.
+     */
+    inline std::ostream &operator<<(std::ostream &os, const MessageView &m) {
+        os << m.get_timestamp() << " " << m.get_character() << " "
+           << m.get_message();
+        return os;
+    }
+
     /**
      * Message structure.
      */
@@ -47,10 +332,19 @@ namespace sik {
             }
         }
 
+        /**
+         * @param view message read from a datagram.
+         * @return view with content ending before the first NULL character.
+         */
+        static MessageView trimmed(MessageView view) noexcept {
+            view.trim_at_null();
+            return view;
+        }
+
     public:
         // Bytes offset of message content.
         static const std::size_t message_offset
-                = sizeof(timestamp_t) + sizeof(char);
+                = MessageView::message_offset;
 
         Message(const Message &) = delete;
 
@@ -81,26 +375,57 @@ namespace sik {
             validate();
         }
 
+        /**
+         * Constructs new Message copying the view.
+         * @param view message read from a datagram.
+         */
+        explicit Message(const MessageView &view)
+                : timestamp(view.get_timestamp()),
+                  character(view.get_character()),
+                  message(view.get_message().data(),
+                          view.get_message().length()) {}
+
         /**
          * Constructs new Message from raw bytes formatted as follows:
          * - 8 bytes as timestamp (timestamp_t in big endian)
          * - 1 byte as character (char)
-         * - up to 65527 bytes as message (std::string)
+         * - up to 65527 bytes as message, up to the first NULL character
          * @param bytes raw bytes with given format
+         * @param length number of bytes
          */
-        Message(const char *bytes, std::size_t length) {
-            if (length < message_offset) {
-                throw std::invalid_argument("Invalid message data");
-            }
-            // Get first sizeof(timestamp_t) bytes and save it as timestamp
-            // after converting from big endian to host number system
-            timestamp = be64toh(((timestamp_t *) bytes)[0]);
-            // Save next byte as the message character
-            character = bytes[sizeof(timestamp_t)];
-            // Save remaining bytes as message content
-            const char *data = bytes + message_offset;
-            message = data;
-            validate();
+        Message(const char *bytes, std::size_t length)
+                : Message(trimmed(MessageView(bytes, length))) {}
+
+        /**
+         * Allocates message from the message pool.
+         * @param size size of the object.
+         * @return memory for the message.
+         */
+        static void *operator new(std::size_t size);
+
+        /**
+         * Returns message memory to the message pool.
+         * @param pointer message memory.
+         * @param size size of the object.
+         */
+        static void operator delete(void *pointer, std::size_t size) noexcept;
+
+        /**
+         * @return number of bytes returned by to_bytes.
+         */
+        std::size_t bytes_length() const noexcept {
+            return message_offset + message.length();
+        }
+
+        /**
+         * Writes message as raw bytes in the to_bytes format.
+         * @param bytes output of at least bytes_length() bytes.
+         */
+        void write_bytes(char *bytes) const noexcept {
+            HeaderSchema::encode(bytes, timestamp, character);
+            // Append remaining message content
+            std::memcpy(bytes + message_offset, message.data(),
+                        message.length());
         }
 
         /**
@@ -111,14 +436,9 @@ namespace sik {
          * @return raw bytes representing message
          */
         std::string to_bytes() const noexcept {
-            std::string bytes(message_offset, 0);
-            // Save timestamp in big endian form at the beginning of the data
-            ((timestamp_t *) bytes.c_str())[0] = htobe64(timestamp);
-            // Save character after the timestamp
-            bytes[sizeof(timestamp_t)] = character;
-            // Append remaining message content
-            bytes.append(message);
-            return std::move(bytes);
+            std::string bytes(bytes_length(), 0);
+            write_bytes(&bytes[0]);
+            return bytes;
         }
 
         /**
@@ -168,13 +488,539 @@ namespace sik {
         friend std::ostream &operator<<(std::ostream &, const Message &);
     };
 
+    /// Pool of memory for messages.
+    using MessagePool = ObjectPool<sizeof(Message), alignof(Message)>;
+
+    /**
+     * Messages are created for every datagram and live until it is handled,
+     * so their memory is recycled instead of going through malloc.
+     * @return pool messages are allocated from.
+     */
+    inline MessagePool &message_pool() {
+        // Never destroyed, messages may outlive static objects at exit.
+        static MessagePool *pool = new MessagePool();
+        return *pool;
+    }
+
+    inline void *Message::operator new(std::size_t size) {
+        if (size != sizeof(Message)) {
+            return ::operator new(size);
+        }
+        return message_pool().allocate();
+    }
+
+    inline void Message::operator delete(void *pointer,
+                                         std::size_t size) noexcept {
+        if (size != sizeof(Message)) {
+            ::operator delete(pointer);
+            return;
+        }
+        message_pool().deallocate(pointer);
+    }
+
+    /// Maximum number of released datagram buffers kept for reuse.
+    const std::size_t DATAGRAM_POOL_SIZE = 256u;
+    /// Maximum total size of released datagram buffers kept for reuse.
+    const std::size_t DATAGRAM_POOL_BYTES = 4u * 1024u * 1024u;
+
+    /**
+     * A datagram is serialized for every message sent, its buffer is
+     * recycled instead of going through malloc.
+     * @return pool datagram buffers are taken from.
+     */
+    inline StringPool &datagram_pool() {
+        // Never destroyed, datagrams may outlive static objects at exit.
+        static StringPool *pool = new StringPool(DATAGRAM_POOL_SIZE,
+                                                 DATAGRAM_POOL_BYTES);
+        return *pool;
+    }
+
+    /**
+     * Message serialized once and shared, without copying, by everyone
+     * sending it. Copies refer to the same bytes. Bytes go back to the
+     * datagram pool with the last copy, reference counts live in pooled
+     * memory as well.
+     */
+    class Datagram {
+    private:
+        /**
+         * Returns bytes of the last copy to the datagram pool.
+         */
+        struct Recycle {
+            void operator()(const std::string *bytes) const noexcept {
+                datagram_pool().release(const_cast<std::string *>(bytes));
+            }
+        };
+
+        /// Datagram bytes.
+        std::shared_ptr<const std::string> bytes;
+
+        /**
+         * Shares bytes between copies.
+         * @param data bytes from the datagram pool or created with new.
+         */
+        void share(std::string *data) {
+            bytes = std::shared_ptr<const std::string>(
+                    data, Recycle(), PoolAllocator<char>());
+        }
+
+    public:
+        Datagram() = default;
+
+        /**
+         * Takes ownership of prepared bytes. Their memory joins the datagram
+         * pool once released.
+         * @param bytes datagram bytes.
+         */
+        explicit Datagram(std::string &&bytes) {
+            share(new std::string(std::move(bytes)));
+        }
+
+        /**
+         * Serializes message followed by the text into a buffer from the
+         * datagram pool.
+         * @param message message to serialize.
+         * @param text text appended after the message content.
+         * @param null_terminated whether null character ends the datagram.
+         */
+        Datagram(const Message &message, boost::string_view text,
+                 bool null_terminated) {
+            std::size_t header = message.bytes_length();
+            std::string *data = datagram_pool().acquire();
+            try {
+                data->resize(header + text.length()
+                             + (null_terminated ? 1u : 0u), '\0');
+            } catch (...) {
+                datagram_pool().release(data);
+                throw;
+            }
+            message.write_bytes(&(*data)[0]);
+            std::memcpy(&(*data)[header], text.data(), text.length());
+            share(data);
+        }
+
+        /**
+         * @return datagram bytes.
+         */
+        const char *data() const noexcept {
+            return bytes->data();
+        }
+
+        /**
+         * @return number of bytes.
+         */
+        std::size_t length() const noexcept {
+            return bytes ? bytes->length() : 0u;
+        }
+
+        /**
+         * @return whether there is no datagram.
+         */
+        bool empty() const noexcept {
+            return !bytes;
+        }
+    };
+
+    /**
+     * Extension appended by a client to its request, announcing protocol
+     * extensions it understands:
+     * - 1 byte EXTENSION_MARKER
+     * - 2 bytes as features (features_t in big endian)
+     * - 8 bytes as cookie offered by the server (cookie_t in big endian),
+     *   only once the client got one
+     * Servers which do not know extensions reject such requests.
+     * @param features announced extensions.
+     * @param cookie cookie to echo or NO_COOKIE.
+     * @return bytes following the request header.
+     */
+    inline std::string request_extension(features_t features,
+                                         cookie_t cookie = NO_COOKIE) {
+        std::size_t length = ExtensionSchema::size
+                             + (cookie != NO_COOKIE ? CookieSchema::size : 0u);
+        std::string bytes(length, '\0');
+        ExtensionSchema::encode(&bytes[0], EXTENSION_MARKER, features);
+        if (cookie != NO_COOKIE) {
+            CookieSchema::encode(&bytes[ExtensionSchema::size], cookie);
+        }
+        return bytes;
+    }
+
+    /**
+     * Reads extensions announced in a request and the echoed cookie.
+     * @param bytes request.
+     * @param length request length.
+     * @param features set to the announced extensions.
+     * @param cookie set to the echoed cookie or NO_COOKIE.
+     * @return whether request is a header followed by an extension.
+     */
+    inline bool read_request_extension(const char *bytes, std::size_t length,
+                                       features_t &features,
+                                       cookie_t &cookie) noexcept {
+        const std::size_t extended = HeaderSchema::size + ExtensionSchema::size;
+        const char *extension = bytes + HeaderSchema::size;
+        if ((length != extended && length != extended + CookieSchema::size)
+            || ExtensionSchema::get<EXTENSION_MARKER_FIELD>(extension)
+               != EXTENSION_MARKER) {
+            return false;
+        }
+        features = ExtensionSchema::get<EXTENSION_FEATURES>(extension);
+        cookie = length == extended
+                 ? NO_COOKIE : CookieSchema::get<0u>(bytes + extended);
+        return true;
+    }
+
+    /**
+     * Reads extensions announced in a request, ignoring the cookie.
+     * @param bytes request.
+     * @param length request length.
+     * @param features set to the announced extensions.
+     * @return whether request is a header followed by an extension.
+     */
+    inline bool read_request_extension(const char *bytes, std::size_t length,
+                                       features_t &features) noexcept {
+        cookie_t cookie;
+        return read_request_extension(bytes, length, features, cookie);
+    }
+
+    /**
+     * Cookie offered by the server in reply to a request without a valid
+     * one, from a client which announced FEATURE_COOKIES:
+     * - 1 byte COOKIE_MARKER
+     * - 8 bytes as cookie (cookie_t in big endian)
+     * It is no longer than the request, so spoofed requests are not
+     * amplified.
+     * @param cookie cookie for the client address.
+     * @return datagram.
+     */
+    inline Datagram cookie_offer(cookie_t cookie) {
+        std::string bytes(CookieOfferSchema::size, '\0');
+        CookieOfferSchema::encode(&bytes[0], COOKIE_MARKER, cookie);
+        return Datagram(std::move(bytes));
+    }
+
+    /**
+     * Reads cookie offered by the server.
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @param cookie set to the offered cookie.
+     * @return whether datagram is a cookie offer.
+     */
+    inline bool read_cookie_offer(const char *bytes, std::size_t length,
+                                  cookie_t &cookie) noexcept {
+        if (length != CookieOfferSchema::size
+            || CookieOfferSchema::get<COOKIE_MARKER_FIELD>(bytes)
+               != COOKIE_MARKER) {
+            return false;
+        }
+        cookie = CookieOfferSchema::get<COOKIE_OFFERED>(bytes);
+        return true;
+    }
+
+    /**
+     * Identifies content with its 64-bit FNV-1a hash.
+     * @param content file content.
+     * @return content identifier.
+     */
+    inline content_id_t content_id(boost::string_view content) noexcept {
+        content_id_t hash = 14695981039346656037u;
+        for (char c: content) {
+            hash = (hash ^ (uint8_t) c) * 1099511628211u;
+        }
+        return hash;
+    }
+
+    /**
+     * Serializes message referring to content the client already has, for
+     * clients which acknowledged it:
+     * - 1 byte REFERENCE_MARKER
+     * - 9 bytes of the message header
+     * - 8 bytes as content identifier (content_id_t in big endian)
+     * @param message message header, its content is not sent.
+     * @param id identifier of the content.
+     * @return datagram.
+     */
+    inline Datagram reference_datagram(const Message &message,
+                                       content_id_t id) {
+        std::string bytes(ReferenceSchema::size, '\0');
+        ReferenceSchema::encode(&bytes[0], REFERENCE_MARKER,
+                                message.get_timestamp(),
+                                message.get_character(), id);
+        return Datagram(std::move(bytes));
+    }
+
+    /**
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @return whether datagram refers to acknowledged content.
+     */
+    inline bool is_reference(const char *bytes, std::size_t length) noexcept {
+        return length > 0u && bytes[0] == REFERENCE_MARKER;
+    }
+
+    /**
+     * Decodes message sent with reference_datagram.
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @param id set to the identifier of the content.
+     * @return message header, without content.
+     * @throws std::invalid_argument when datagram is not a valid reference.
+     */
+    inline MessageView read_reference(const char *bytes, std::size_t length,
+                                      content_id_t &id) {
+        if (length != ReferenceSchema::size || !is_reference(bytes, length)) {
+            throw std::invalid_argument("Invalid content reference");
+        }
+        id = ReferenceSchema::get<REFERENCE_ID>(bytes);
+        return MessageView(
+                bytes + ReferenceSchema::offset<REFERENCE_TIMESTAMP>(),
+                HeaderSchema::size);
+    }
+
+    /**
+     * Acknowledgement sent by a client which received the content:
+     * - 1 byte ACKNOWLEDGEMENT_MARKER
+     * - 8 bytes as content identifier (content_id_t in big endian)
+     * It is not a request, the server does not send it to anyone.
+     * @param id identifier of the received content.
+     * @return acknowledgement bytes.
+     */
+    inline std::string acknowledgement(content_id_t id) {
+        std::string bytes(AcknowledgementSchema::size, '\0');
+        AcknowledgementSchema::encode(&bytes[0], ACKNOWLEDGEMENT_MARKER, id);
+        return bytes;
+    }
+
+    /**
+     * Reads acknowledgement of the content.
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @param id set to the identifier of the acknowledged content.
+     * @return whether datagram is an acknowledgement.
+     */
+    inline bool read_acknowledgement(const char *bytes, std::size_t length,
+                                     content_id_t &id) noexcept {
+        if (length != AcknowledgementSchema::size
+            || AcknowledgementSchema::get<ACKNOWLEDGEMENT_MARKER_FIELD>(bytes)
+               != ACKNOWLEDGEMENT_MARKER) {
+            return false;
+        }
+        id = AcknowledgementSchema::get<ACKNOWLEDGEMENT_ID>(bytes);
+        return true;
+    }
+
+    /**
+     * Writes sequence number sent before every datagram to clients which
+     * announced FEATURE_SEQUENCE:
+     * - 1 byte SEQUENCE_MARKER
+     * - 4 bytes as the number of datagrams sent to the client before
+     *   (uint32_t in big endian)
+     * - the datagram exactly as it would be sent alone
+     * @param bytes output of SEQUENCE_HEADER_SIZE bytes.
+     * @param sequence sequence number.
+     */
+    inline void write_sequence(char *bytes, uint32_t sequence) noexcept {
+        SequenceSchema::encode(bytes, SEQUENCE_MARKER, sequence);
+    }
+
+    /**
+     * Reads sequence number preceding a datagram.
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @param sequence set to the sequence number.
+     * @return whether datagram has a sequence number, the datagram follows
+     * SEQUENCE_HEADER_SIZE bytes.
+     */
+    inline bool read_sequence(const char *bytes, std::size_t length,
+                              uint32_t &sequence) noexcept {
+        if (length < SEQUENCE_HEADER_SIZE
+            || SequenceSchema::get<SEQUENCE_MARKER_FIELD>(bytes)
+               != SEQUENCE_MARKER) {
+            return false;
+        }
+        sequence = SequenceSchema::get<SEQUENCE_NUMBER>(bytes);
+        return true;
+    }
+
+    /**
+     * Report sent by a client which missed numbered datagrams:
+     * - 1 byte NACK_MARKER
+     * - 4 bytes as sequence number of the first missing datagram (uint32_t
+     *   in big endian)
+     * - 2 bytes as number of consecutive missing datagrams (uint16_t in big
+     *   endian)
+     * It is not a request, the server does not send it to anyone.
+     * @param first sequence number of the first missing datagram.
+     * @param count number of missing datagrams, positive.
+     * @return report bytes.
+     */
+    inline std::string nack(uint32_t first, uint16_t count) {
+        std::string bytes(NackSchema::size, '\0');
+        NackSchema::encode(&bytes[0], NACK_MARKER, first, count);
+        return bytes;
+    }
+
+    /**
+     * Reads report of missing datagrams.
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @param first set to sequence number of the first missing datagram.
+     * @param count set to number of missing datagrams.
+     * @return whether datagram is a valid report.
+     */
+    inline bool read_nack(const char *bytes, std::size_t length,
+                          uint32_t &first, uint16_t &count) noexcept {
+        if (length != NackSchema::size
+            || NackSchema::get<NACK_MARKER_FIELD>(bytes) != NACK_MARKER
+            || NackSchema::get<NACK_COUNT>(bytes) == 0u) {
+            return false;
+        }
+        first = NackSchema::get<NACK_FIRST>(bytes);
+        count = NackSchema::get<NACK_COUNT>(bytes);
+        return true;
+    }
+
+    /**
+     * @param bytes datagram.
+     * @param length datagram length.
+     * @return whether datagram is a frame rather than a single message.
+     */
+    inline bool is_frame(const char *bytes, std::size_t length) noexcept {
+        return length > 0u && bytes[0] == FRAME_MARKER;
+    }
+
+    /**
+     * Several messages packed into a single datagram, for clients which
+     * announced FEATURE_FRAMES:
+     * - 1 byte FRAME_MARKER
+     * - 1 byte as number of messages
+     * - every message as 2 bytes of its length (big endian) followed by the
+     *   message exactly as it would be sent alone
+     */
+    class Frame {
+    private:
+        /// Frame bytes.
+        std::string bytes;
+
+    public:
+        /**
+         * Constructs empty frame.
+         * @param capacity expected frame length.
+         */
+        explicit Frame(std::size_t capacity = 0u) {
+            bytes.reserve(capacity);
+            bytes.resize(FrameSchema::size);
+            FrameSchema::encode(&bytes[0], FRAME_MARKER, 0u);
+        }
+
+        /**
+         * @param length message length.
+         * @return number of bytes message takes in a frame.
+         */
+        static std::size_t entry_length(std::size_t length) noexcept {
+            return FRAME_ENTRY_HEADER_SIZE + length;
+        }
+
+        /**
+         * Appends message.
+         * @param message message bytes.
+         * @param length message length, below 64KB.
+         * @throws std::length_error when the frame is full.
+         */
+        void append(const char *message, std::size_t length) {
+            if (count() == MAX_FRAME_MESSAGES || length > UINT16_MAX) {
+                throw std::length_error("Message does not fit in frame");
+            }
+            std::size_t entry = bytes.length();
+            bytes.resize(entry + FrameEntrySchema::size);
+            FrameEntrySchema::set<0u>(&bytes[entry], (uint16_t) length);
+            bytes.append(message, length);
+            FrameSchema::set<FRAME_COUNT>(&bytes[0], (uint8_t) (count() + 1u));
+        }
+
+        /**
+         * @return number of messages.
+         */
+        std::size_t count() const noexcept {
+            return FrameSchema::get<FRAME_COUNT>(bytes.data());
+        }
+
+        /**
+         * @return frame length.
+         */
+        std::size_t length() const noexcept {
+            return bytes.length();
+        }
+
+        /**
+         * Moves frame bytes into a datagram, leaving the frame empty.
+         * @return datagram.
+         */
+        Datagram to_datagram() {
+            Datagram datagram(std::move(bytes));
+            *this = Frame();
+            return datagram;
+        }
+    };
+
+    /**
+     * Reads messages packed in a frame without copying them.
+     */
+    class FrameReader {
+    private:
+        /// Next byte to read.
+        const char *position;
+        /// Past the last byte of the frame.
+        const char *end;
+        /// Messages left to read.
+        std::size_t left;
+
+    public:
+        /**
+         * Constructs reader of the frame.
+         * @param bytes frame bytes.
+         * @param length frame length.
+         * @throws std::invalid_argument when datagram is not a frame.
+         */
+        FrameReader(const char *bytes, std::size_t length)
+                : position(bytes + FRAME_HEADER_SIZE), end(bytes + length) {
+            if (length < FRAME_HEADER_SIZE || !is_frame(bytes, length)) {
+                throw std::invalid_argument("Invalid frame");
+            }
+            left = FrameSchema::get<FRAME_COUNT>(bytes);
+        }
+
+        /**
+         * Reads next message.
+         * @param message set to the message bytes.
+         * @return whether there was a message left.
+         * @throws std::invalid_argument when frame is truncated.
+         */
+        bool next(boost::string_view &message) {
+            if (left == 0u) {
+                return false;
+            }
+            if ((std::size_t) (end - position) < FRAME_ENTRY_HEADER_SIZE) {
+                throw std::invalid_argument("Truncated frame");
+            }
+            std::size_t length = FrameEntrySchema::get<0u>(position);
+            position += FRAME_ENTRY_HEADER_SIZE;
+            if ((std::size_t) (end - position) < length) {
+                throw std::invalid_argument("Truncated frame");
+            }
+            message = boost::string_view(position, length);
+            position += length;
+            left--;
+            return true;
+        }
+    };
+
     /**
      * Prints Message.
      * @param os stream to print to.
      * @param m message to print.
      * @return stream.
      */
-    std::ostream &operator<<(std::ostream &os, const Message &m) {
+    inline std::ostream &operator<<(std::ostream &os, const Message &m) {
         os << m.timestamp << " " << m.character << " " << m.message;
         return os;
     }
@@ -0,0 +1,171 @@
+#ifndef SIK_UDP_RETRANSMISSION_H
+#define SIK_UDP_RETRANSMISSION_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <vector>
+
+#include "address_map.h"
+#include "protocol.h"
+
+namespace sik {
+    /// Rate meaning missing datagrams are never sent again.
+    const uint32_t NO_RETRANSMISSION = 0u;
+    /// Maximum number of retransmitted datagrams per second.
+    const uint32_t MAX_RETRANSMISSION_RATE = 1000000u;
+    /// Number of the latest datagrams kept for every client by default, also
+    /// the longest gap a client reports.
+    const std::size_t RETRANSMISSION_DEPTH = 64u;
+
+    /**
+     * Keeps the latest numbered datagrams sent to every client, so the ones
+     * the client reports missing may be sent again. Every client has a ring
+     * of depth entries indexed by the sequence number modulo depth, so
+     * a datagram is found with a single lookup and a newer datagram replaces
+     * the one sent depth datagrams earlier. Datagrams are shared with the
+     * ones being sent, they are not copied.
+     */
+    class RetransmissionHistory {
+    private:
+        /**
+         * Datagram sent to a client.
+         */
+        struct Entry {
+            /// Sequence number the datagram was sent with.
+            uint32_t sequence = 0u;
+            /// Datagram, empty if no datagram was recorded.
+            Datagram datagram;
+        };
+
+        /// Number of datagrams kept for a client.
+        std::size_t depth;
+        /// Ring of the latest datagrams of every client.
+        AddressMap<std::vector<Entry>> clients;
+        /// Clients removed by prune.
+        std::vector<address_t> removed;
+
+    public:
+        /**
+         * Constructs history.
+         * @param depth number of datagrams kept for a client.
+         * @throws std::invalid_argument when depth is 0.
+         */
+        explicit RetransmissionHistory(std::size_t depth
+                                       = RETRANSMISSION_DEPTH)
+                : depth(depth) {
+            if (depth == 0u) {
+                throw std::invalid_argument("Depth must be positive");
+            }
+        }
+
+        /**
+         * Records datagram sent to the client.
+         * @param key client address.
+         * @param sequence sequence number the datagram was sent with.
+         * @param datagram datagram without the sequence number.
+         */
+        void record(address_t key, uint32_t sequence,
+                    const Datagram &datagram) {
+            std::vector<Entry> &ring = *clients.insert(
+                    key, std::vector<Entry>()).first;
+            if (ring.empty()) {
+                ring.resize(depth);
+            }
+            Entry &entry = ring[sequence % depth];
+            entry.sequence = sequence;
+            entry.datagram = datagram;
+        }
+
+        /**
+         * @param key client address.
+         * @param sequence sequence number.
+         * @return datagram sent to the client with the sequence number or
+         * nullptr if it is no longer kept.
+         */
+        const Datagram *find(address_t key, uint32_t sequence) const noexcept {
+            const std::vector<Entry> *ring = clients.find(key);
+            if (ring == nullptr) {
+                return nullptr;
+            }
+            const Entry &entry = (*ring)[sequence % depth];
+            return entry.datagram.empty() || entry.sequence != sequence
+                   ? nullptr : &entry.datagram;
+        }
+
+        /**
+         * Forgets datagrams of clients which are no longer kept.
+         * @tparam F predicate type.
+         * @param keep predicate returning whether datagrams of the client
+         * are still needed.
+         */
+        template<typename F>
+        void prune(F &&keep) {
+            removed.clear();
+            clients.visit([&](address_t key, const std::vector<Entry> &) {
+                if (!keep(key)) {
+                    removed.push_back(key);
+                }
+            });
+            for (address_t key: removed) {
+                clients.erase(key);
+            }
+        }
+
+        /**
+         * @return number of clients with datagrams kept.
+         */
+        std::size_t size() const noexcept {
+            return clients.size();
+        }
+    };
+
+    /**
+     * Limits retransmissions to a number per second, so reports of missing
+     * datagrams cannot make the server flood the network.
+     */
+    class RetransmissionLimit {
+    private:
+        /// Retransmissions allowed per second.
+        uint32_t rate;
+        /// Second the budget is for.
+        std::time_t second = 0;
+        /// Retransmissions left in the second.
+        uint32_t budget = 0u;
+
+    public:
+        /**
+         * @param rate retransmissions allowed per second.
+         */
+        explicit RetransmissionLimit(uint32_t rate = NO_RETRANSMISSION) noexcept
+                : rate(rate) {}
+
+        /**
+         * @return whether retransmissions are allowed at all.
+         */
+        bool is_enabled() const noexcept {
+            return rate != NO_RETRANSMISSION;
+        }
+
+        /**
+         * Takes a single retransmission from the budget.
+         * @param now current time.
+         * @return whether retransmission is allowed.
+         */
+        bool take(std::time_t now) noexcept {
+            if (now != second) {
+                second = now;
+                budget = rate;
+            }
+            if (budget == 0u) {
+                return false;
+            }
+            budget--;
+            return true;
+        }
+    };
+}
+
+#endif //SIK_UDP_RETRANSMISSION_H
@@ -0,0 +1,122 @@
+#ifndef SIK_UDP_SEQUENCE_H
+#define SIK_UDP_SEQUENCE_H
+
+
+#include <cstdint>
+#include <ctime>
+
+namespace sik {
+    /// Seconds between loss reports of the client.
+    const std::time_t LOSS_REPORT_INTERVAL = 10;
+    /// Number of the latest sequence numbers remembered, datagrams older
+    /// than that cannot be told from duplicates.
+    const uint32_t SEQUENCE_WINDOW = 64u;
+
+    /**
+     * Accounts for datagrams lost or reordered on the way from the server,
+     * from their sequence numbers. A number past the expected one counts
+     * the ones skipped as lost, a number before it is a late datagram which
+     * was counted as lost before, so loss is corrected once it arrives.
+     * The latest SEQUENCE_WINDOW numbers are remembered, so a datagram
+     * which came twice, e.g. sent again after it was reported missing,
+     * is recognized. Numbers are compared modulo 2^32, so they may wrap
+     * around.
+     */
+    class SequenceTracker {
+    private:
+        /// Whether any datagram was recorded.
+        bool started = false;
+        /// Sequence number expected next.
+        uint32_t expected = 0u;
+        /// Number of datagrams received.
+        uint64_t received = 0u;
+        /// Number of datagrams missing.
+        uint64_t lost = 0u;
+        /// Number of datagrams received after a later one.
+        uint64_t reordered = 0u;
+        /// Number of datagrams received again or too late to tell.
+        uint64_t duplicates = 0u;
+        /// Bit i set if number expected - 1 - i was received.
+        uint64_t window = 0u;
+
+    public:
+        /**
+         * Records received datagram.
+         * @param sequence its sequence number.
+         * @param missing set to the number of datagrams skipped just before
+         * this one.
+         * @return whether datagram is new rather than a duplicate.
+         */
+        bool record(uint32_t sequence, uint32_t &missing) noexcept {
+            missing = 0u;
+            if (!started) {
+                // Datagrams sent before the client started are not lost.
+                started = true;
+                expected = sequence + 1u;
+                window = 1u;
+                received++;
+                return true;
+            }
+            int32_t distance = (int32_t) (sequence - expected);
+            if (distance >= 0) {
+                missing = (uint32_t) distance;
+                lost += missing;
+                window = missing + 1u >= SEQUENCE_WINDOW
+                         ? 1u : (window << (missing + 1u)) | 1u;
+                expected = sequence + 1u;
+                received++;
+                return true;
+            }
+            uint32_t age = expected - 1u - sequence;
+            if (age >= SEQUENCE_WINDOW || ((window >> age) & 1u)) {
+                duplicates++;
+                return false;
+            }
+            window |= (uint64_t) 1u << age;
+            reordered++;
+            received++;
+            if (lost > 0u) {
+                lost--;
+            }
+            return true;
+        }
+
+        /**
+         * @return number of datagrams received.
+         */
+        uint64_t get_received() const noexcept {
+            return received;
+        }
+
+        /**
+         * @return number of datagrams missing.
+         */
+        uint64_t get_lost() const noexcept {
+            return lost;
+        }
+
+        /**
+         * @return number of datagrams received after a later one.
+         */
+        uint64_t get_reordered() const noexcept {
+            return reordered;
+        }
+
+        /**
+         * @return number of datagrams received again or too late to tell.
+         */
+        uint64_t get_duplicates() const noexcept {
+            return duplicates;
+        }
+
+        /**
+         * @return fraction of datagrams missing among the ones sent.
+         */
+        double loss_rate() const noexcept {
+            uint64_t sent = received + lost;
+            return sent == 0u ? 0.0 : (double) lost / (double) sent;
+        }
+    };
+}
+
+#endif //SIK_UDP_SEQUENCE_H
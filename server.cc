@@ -3,10 +3,10 @@
 #include <memory>
 
 #include "error.h"
-#include "parse.h"
+#include "parse_server.h"
 #include "server.h"
 
-const std::size_t BUFFER_SIZE = 4096u;
+const std::size_t DEFAULT_BUFFER_SIZE = 4096u;
 
 // Name of an executable program was run as.
 std::string executable;
@@ -14,17 +14,68 @@ std::string executable;
 uint16_t port;
 // File which content will be added to every packet.
 std::string filename;
+// Number of datagrams the server can queue.
+std::size_t buffer_size = DEFAULT_BUFFER_SIZE;
+// Optional server features.
+sik::ServerOptions options;
 // Server
-std::unique_ptr<sik::Server<BUFFER_SIZE>> server;
+std::unique_ptr<sik::Server<DYNAMIC_BUFFER_SIZE>> server;
 
 /**
  * Prints usage.
  */
 void usage() {
-    std::cout << "Usage: " << executable << " port filename\n\n"
+    std::cout << "Usage: " << executable
+              << " port filename [buffer_size] [--topics]"
+                 " [--slow-clients=policy] [--max-clients=count]"
+                 " [--frame-budget=bytes] [--compress] [--content-id]"
+                 " [--chunk-size=bytes] [--dedup-window=seconds]"
+                 " [--cookies] [--sequence] [--retransmit=rate]"
+                 " [--parity=count]\n\n"
         "Parameters:\n"
         " - port        Port number, on which server listens for data\n"
-        " - filename    File which content is added to udp packets\n";
+        " - filename    File which content is added to udp packets\n"
+        " - buffer_size Optional number of queued datagrams (default: 4096)\n"
+        " - --topics    Send messages only to clients registered with the\n"
+        "               same character\n"
+        " - --slow-clients=policy\n"
+        "               What to do with a client which sends keep blocking:\n"
+        "               none (default), skip the message, defer it after\n"
+        "               other clients or suspend the client for a while\n"
+        " - --max-clients=count\n"
+        "               Limit of clients, the least recently active client\n"
+        "               is removed to make room for a new one\n"
+        " - --frame-budget=bytes\n"
+        "               Pack messages for a client into frames of up to\n"
+        "               bytes when it announced support for frames\n"
+        " - --compress  Send file content compressed to clients which\n"
+        "               announced support for compression\n"
+        " - --content-id\n"
+        "               Send only an identifier of the file content to\n"
+        "               clients which acknowledged receiving it\n"
+        " - --chunk-size=bytes\n"
+        "               Split messages longer than bytes into chunks for\n"
+        "               clients which announced support for chunks, so\n"
+        "               datagrams are not fragmented and files may exceed\n"
+        "               64KB\n"
+        " - --dedup-window=seconds\n"
+        "               Do not send again a request repeated by the same\n"
+        "               client within seconds\n"
+        " - --cookies   Send and register only requests echoing a cookie\n"
+        "               offered to their sender, so spoofed requests are\n"
+        "               not amplified\n"
+        " - --sequence  Number datagrams for clients which announced support\n"
+        "               for sequence numbers and count messages dropped\n"
+        "               from the full buffer for every client which missed\n"
+        "               them\n"
+        " - --retransmit=rate\n"
+        "               Send again up to rate datagrams per second which\n"
+        "               clients reported missing, implies --sequence\n"
+        " - --parity=count\n"
+        "               Follow every count datagrams by their parity for\n"
+        "               clients which announced support for it, so a lost\n"
+        "               datagram of the group is rebuilt without asking,\n"
+        "               implies --sequence\n";
 }
 
 /**
@@ -32,11 +83,70 @@ void usage() {
  * @param argc arguments count.
  * @param argv argument values.
  */
-void parse_arguments(const int argc, char * const argv[]) {
+void parse_arguments(int argc, char * const argv[]) {
     // Save executable for `usage` function.
     executable = std::move(argv[0]);
 
-    if (argc != 3) {
+    const std::string SLOW_CLIENTS = "--slow-clients=";
+    const std::string MAX_CLIENTS = "--max-clients=";
+    const std::string FRAME_BUDGET = "--frame-budget=";
+    const std::string CHUNK_SIZE = "--chunk-size=";
+    const std::string DEDUP_WINDOW = "--dedup-window=";
+    const std::string RETRANSMIT = "--retransmit=";
+    const std::string PARITY = "--parity=";
+    try {
+        // Options follow positional arguments.
+        for (; argc > 1 && std::string(argv[argc - 1]).compare(0, 2, "--") == 0;
+               argc--) {
+            std::string option = argv[argc - 1];
+            if (option == "--topics") {
+                options.topics = true;
+            } else if (option == "--compress") {
+                options.compression = true;
+            } else if (option == "--content-id") {
+                options.content_id = true;
+            } else if (option == "--cookies") {
+                options.cookies = true;
+            } else if (option == "--sequence") {
+                options.sequence_numbers = true;
+            } else if (option.compare(0, SLOW_CLIENTS.length(),
+                                      SLOW_CLIENTS) == 0) {
+                options.slow_client_policy.action
+                        = sik::parse_slow_client_action(
+                                option.substr(SLOW_CLIENTS.length()));
+            } else if (option.compare(0, MAX_CLIENTS.length(),
+                                      MAX_CLIENTS) == 0) {
+                options.max_clients = sik::parse_client_limit(
+                        option.substr(MAX_CLIENTS.length()));
+            } else if (option.compare(0, FRAME_BUDGET.length(),
+                                      FRAME_BUDGET) == 0) {
+                options.frame_budget = sik::parse_frame_budget(
+                        option.substr(FRAME_BUDGET.length()));
+            } else if (option.compare(0, CHUNK_SIZE.length(),
+                                      CHUNK_SIZE) == 0) {
+                options.chunk_size = sik::parse_chunk_size(
+                        option.substr(CHUNK_SIZE.length()));
+            } else if (option.compare(0, DEDUP_WINDOW.length(),
+                                      DEDUP_WINDOW) == 0) {
+                options.duplicate_window = sik::parse_duplicate_window(
+                        option.substr(DEDUP_WINDOW.length()));
+            } else if (option.compare(0, RETRANSMIT.length(),
+                                      RETRANSMIT) == 0) {
+                options.retransmission_rate = sik::parse_retransmission_rate(
+                        option.substr(RETRANSMIT.length()));
+            } else if (option.compare(0, PARITY.length(), PARITY) == 0) {
+                options.parity_group = sik::parse_parity_group(
+                        option.substr(PARITY.length()));
+            } else {
+                throw sik::ParseException("Unknown option " + option);
+            }
+        }
+    } catch (const sik::ParseException &e) {
+        usage();
+        fatal(e.what(), Status::ERROR_ARGS);
+    }
+
+    if (argc < 3 || argc > 4) {
         usage();
         fatal("Invalid arguments count", Status::ERROR_ARGS);
     }
@@ -44,6 +154,9 @@ void parse_arguments(const int argc, char * const argv[]) {
     try {
         port = sik::parse_port(argv[1]);
         filename = std::move(argv[2]);
+        if (argc == 4) {
+            buffer_size = sik::parse_buffer_size(argv[3]);
+        }
     } catch (const sik::ParseException &e) {
         usage();
         fatal(e.what(), Status::ERROR_ARGS);
@@ -67,11 +180,93 @@ int main(int argc, char * argv[]) {
     register_signals();
 
     try {
-        server = std::make_unique<sik::Server<BUFFER_SIZE>>(port, filename);
+        server = std::make_unique<sik::Server<DYNAMIC_BUFFER_SIZE>>(
+                port, filename, buffer_size, options);
     } catch (const sik::ServerException &e) {
         fatal(e.what(), Status::ERROR_ARGS);
     }
 
     server->run();
+
+    const sik::ServerStatistics &statistics = server->get_statistics();
+    std::cerr << "Unreachable clients: " << statistics.unreachable_clients
+              << ", datagrams saved: " << statistics.saved_datagrams
+              << " (" << statistics.saved_bytes << " bytes)" << std::endl;
+    if (options.compression) {
+        std::cerr << "Compressed datagrams: "
+                  << statistics.compressed_datagrams << ", bytes saved: "
+                  << statistics.compression_saved_bytes << std::endl;
+    }
+    if (options.content_id) {
+        std::cerr << "Content references: "
+                  << statistics.referenced_datagrams << ", bytes saved: "
+                  << statistics.reference_saved_bytes << std::endl;
+    }
+    if (options.chunk_size != sik::NO_CHUNKS) {
+        std::cerr << "Chunked datagrams: " << statistics.chunked_datagrams
+                  << " in " << statistics.chunks << " chunks" << std::endl;
+    }
+    if (statistics.oversized_datagrams > 0u) {
+        std::cerr << "Datagrams too long to send: "
+                  << statistics.oversized_datagrams << std::endl;
+    }
+    if (options.cookies) {
+        std::cerr << "Cookies offered: " << statistics.offered_cookies
+                  << ", requests refused: " << statistics.refused_requests
+                  << std::endl;
+    }
+    if (statistics.overwritten_messages > 0u) {
+        std::cerr << "Messages dropped from the full buffer: "
+                  << statistics.overwritten_messages;
+        if (options.sequence_numbers
+            || options.retransmission_rate != sik::NO_RETRANSMISSION
+            || options.parity_group != sik::NO_PARITY) {
+            std::cerr << ", missed by clients: " << statistics.missed_messages;
+        }
+        std::cerr << std::endl;
+    }
+    if (options.retransmission_rate != sik::NO_RETRANSMISSION) {
+        std::cerr << "Datagrams retransmitted: "
+                  << statistics.retransmitted_datagrams << ", throttled: "
+                  << statistics.throttled_retransmissions
+                  << ", no longer kept: "
+                  << statistics.unavailable_retransmissions << std::endl;
+    }
+    if (options.parity_group != sik::NO_PARITY) {
+        std::cerr << "Parity datagrams: " << statistics.parity_datagrams
+                  << " (" << statistics.parity_bytes << " bytes), dropped: "
+                  << statistics.dropped_parities << ", too long: "
+                  << server->get_parity().get_oversized() << std::endl;
+    }
+    const sik::DuplicateFilter &duplicates = server->get_duplicates();
+    if (duplicates.is_enabled()) {
+        std::cerr << "Duplicate requests suppressed: "
+                  << duplicates.get_suppressed() << std::endl;
+    }
+    const sik::Connections &connections = server->get_connections();
+    std::cerr << "Clients admitted: " << connections.get_admitted()
+              << ", evicted: " << connections.get_evicted() << std::endl;
+    const sik::FramePacker &frames = server->get_frames();
+    if (frames.is_enabled()) {
+        std::cerr << "Frames sent: " << frames.get_frames() << " with "
+                  << frames.get_framed_messages() << " messages" << std::endl;
+    }
+    server->get_slow_clients().visit(
+            [](sik::address_t key, const sik::ClientLag &lag) {
+                sockaddr_in address = sik::unpack_address(key);
+                std::cerr << "Slow client " << inet_ntoa(address.sin_addr)
+                          << ":" << ntohs(address.sin_port)
+                          << ": blocked " << lag.blocks
+                          << ", max lag " << lag.max_lag
+                          << " s, outstanding " << lag.outstanding
+                          << ", penalties " << lag.penalties
+                          << ", skipped " << lag.skipped << std::endl;
+            });
+    connections.visit_missed([](sik::address_t key, uint64_t missed) {
+        sockaddr_in address = sik::unpack_address(key);
+        std::cerr << "Client " << inet_ntoa(address.sin_addr) << ":"
+                  << ntohs(address.sin_port) << " missed " << missed
+                  << " messages" << std::endl;
+    });
     return (int) Status::OK;
 }
\ No newline at end of file
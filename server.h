@@ -3,8 +3,12 @@
 
 
 #include <cstddef>
+#include <cstring>
 #include <string>
 #include <memory>
+#include <array>
+#include <vector>
+#include <algorithm>
 
 #include <sys/socket.h>
 #include <netinet/in.h>
@@ -12,12 +16,21 @@
 #include <unistd.h>
 #include <fcntl.h>
 
+#include "arena.h"
+#include "chunks.h"
+#include "compression.h"
 #include "poll.h"
 #include "buffer.h"
 #include "connections.h"
+#include "cookies.h"
+#include "duplicates.h"
+#include "frames.h"
+#include "slow_clients.h"
 #include "protocol.h"
 #include "communication.h"
 #include "file.h"
+#include "parity.h"
+#include "retransmission.h"
 
 namespace sik {
     /**
@@ -32,9 +45,112 @@ namespace sik {
                 std::move(message)) {}
     };
 
+    /// Milliseconds between expiring connections when server is idle.
+    const int TICK_INTERVAL = 1000;
+    /// Slow clients a message may be deferred for without allocating.
+    const std::size_t DEFERRED_CAPACITY = 1024u;
+
+    /**
+     * Optional server features.
+     */
+    struct ServerOptions {
+        /// Whether messages go only to clients which registered with the
+        /// same character.
+        bool topics = false;
+        /// Handling of clients which sends block.
+        SlowClientPolicy slow_client_policy;
+        /// Maximum number of clients, least recently active ones are
+        /// evicted to make room for new ones.
+        std::size_t max_clients = NO_CLIENT_LIMIT;
+        /// Maximum length of a frame packing several messages for a client
+        /// which announced FEATURE_FRAMES, NO_FRAMES disables packing.
+        std::size_t frame_budget = NO_FRAMES;
+        /// Whether file content is sent compressed to clients which
+        /// announced FEATURE_COMPRESSION.
+        bool compression = false;
+        /// Whether clients which announced FEATURE_CONTENT_ID and
+        /// acknowledged the file content get only its identifier.
+        bool content_id = false;
+        /// Maximum length of a datagram sent to clients which announced
+        /// FEATURE_CHUNKS, longer messages are split into chunks. NO_CHUNKS
+        /// disables splitting.
+        std::size_t chunk_size = NO_CHUNKS;
+        /// Seconds a request repeated by the same client is not sent to
+        /// anyone again, NO_DUPLICATE_WINDOW sends every request.
+        std::time_t duplicate_window = NO_DUPLICATE_WINDOW;
+        /// Whether only requests echoing a cookie are sent and register
+        /// their senders.
+        bool cookies = false;
+        /// Whether datagrams to clients which announced FEATURE_SEQUENCE
+        /// are numbered and messages dropped from the full buffer are
+        /// counted for every client which missed them.
+        bool sequence_numbers = false;
+        /// Datagrams per second sent again to clients which announced
+        /// FEATURE_RETRANSMISSION and reported them missing,
+        /// NO_RETRANSMISSION disables retransmission. Enables sequence
+        /// numbers.
+        uint32_t retransmission_rate = NO_RETRANSMISSION;
+        /// Number of numbered datagrams followed by their parity for clients
+        /// which announced FEATURE_PARITY, NO_PARITY sends no parity.
+        /// Enables sequence numbers.
+        std::size_t parity_group = NO_PARITY;
+    };
+
+    /**
+     * Server counters.
+     */
+    struct ServerStatistics {
+        /// Clients disconnected after ICMP unreachable errors.
+        uint64_t unreachable_clients = 0u;
+        /// Estimated number of datagrams not sent to disconnected clients,
+        /// counting messages arriving before their intervals would end.
+        uint64_t saved_datagrams = 0u;
+        /// Bytes of saved_datagrams.
+        uint64_t saved_bytes = 0u;
+        /// Datagrams sent with compressed file content.
+        uint64_t compressed_datagrams = 0u;
+        /// Bytes not sent thanks to compression.
+        uint64_t compression_saved_bytes = 0u;
+        /// Datagrams sent with the content identifier instead of content.
+        uint64_t referenced_datagrams = 0u;
+        /// Bytes not sent thanks to content identifiers.
+        uint64_t reference_saved_bytes = 0u;
+        /// Messages sent split into chunks.
+        uint64_t chunked_datagrams = 0u;
+        /// Chunks of chunked_datagrams.
+        uint64_t chunks = 0u;
+        /// Messages not sent to clients unable to receive them, as they
+        /// were too long for a single datagram.
+        uint64_t oversized_datagrams = 0u;
+        /// Cookies offered to senders of requests without a valid one.
+        uint64_t offered_cookies = 0u;
+        /// Requests without a valid cookie from clients which do not
+        /// understand cookies.
+        uint64_t refused_requests = 0u;
+        /// Messages dropped from the full buffer before they were sent.
+        uint64_t overwritten_messages = 0u;
+        /// Clients which would have received overwritten_messages, counted
+        /// only with sequence numbers enabled.
+        uint64_t missed_messages = 0u;
+        /// Datagrams sent again after clients reported them missing.
+        uint64_t retransmitted_datagrams = 0u;
+        /// Missing datagrams not sent again because of the rate limit or
+        /// a blocked socket.
+        uint64_t throttled_retransmissions = 0u;
+        /// Missing datagrams no longer kept in the history.
+        uint64_t unavailable_retransmissions = 0u;
+        /// Parity datagrams sent.
+        uint64_t parity_datagrams = 0u;
+        /// Bytes of parity_datagrams.
+        uint64_t parity_bytes = 0u;
+        /// Parity datagrams dropped because the socket would block.
+        uint64_t dropped_parities = 0u;
+    };
+
     /**
      * Server
-     * @tparam buffer_size size of the datagram buffer.
+     * @tparam buffer_size size of the datagram buffer or DYNAMIC_BUFFER_SIZE
+     * if the size is passed to the constructor.
      */
     template<std::size_t buffer_size>
     class Server {
@@ -44,10 +160,23 @@ namespace sik {
     private:
         /// Indicates whether server should terminate.
         bool stopping = false;
+        /// Whether messages go only to clients subscribed to their character.
+        bool topics;
         /// UDP Server socket.
         int sock;
         /// File content to add to every message.
         std::string file_content;
+        /// File content with the NULL character compressed, empty when
+        /// compression is disabled or does not make datagrams shorter.
+        std::string compressed_content;
+        /// Whether acknowledged content is replaced by its identifier.
+        bool content_references;
+        /// Identifier of the file content.
+        content_id_t file_id = 0u;
+        /// Maximum length of a datagram for clients which understand chunks.
+        std::size_t chunk_size;
+        /// Identifier of the next message split into chunks.
+        uint32_t next_chunked_id = 0u;
         /// Server address bound to the socket.
         sockaddr_in address;
         /// Poll set.
@@ -57,11 +186,73 @@ namespace sik {
         std::unique_ptr<Buffer<BufferData, buffer_size>> buffer;
         /// First message received (front of messages stack), ready to send
         std::unique_ptr<Message> current_message;
+        /// Arrival time of current_message.
+        std::time_t current_time = 0;
+        /// current_message with file content, sent to every recipient.
+        Datagram current_datagram;
+        /// current_message with compressed file content.
+        Datagram current_compressed;
+        /// current_message with the file content identifier.
+        Datagram current_reference;
+        /// current_datagram split into chunks, once a client needed them.
+        std::vector<Datagram> current_chunks;
+        /// current_compressed split into chunks, once a client needed them.
+        std::vector<Datagram> compressed_chunks;
 
         /// Client connections
         std::unique_ptr<Connections> connections;
         /// Clients to receive current message
-        std::queue<sockaddr_in> current_clients;
+        Connections::Recipients current_clients;
+        /// Next clients to receive current message, sent with one call
+        std::array<address_t, SEND_BATCH_SIZE> batch;
+        /// Encoding of current message for every client in batch
+        std::array<const Datagram *, SEND_BATCH_SIZE> batch_datagrams;
+        /// First client in batch not sent to yet
+        std::size_t batch_begin = 0u;
+        /// Past the last client in batch
+        std::size_t batch_end = 0u;
+        /// Slow clients receiving current message after everyone else
+        std::vector<address_t> deferred;
+        /// Next client in deferred to send to
+        std::size_t deferred_position = 0u;
+        /// Clients which sends blocked
+        SlowClients slow_clients;
+        /// Frames packing messages for clients which understand them
+        FramePacker frames;
+        /// Requests received recently, repeats are not sent again
+        DuplicateFilter duplicates;
+        /// Cookies proving senders receive datagrams sent to them
+        CookieJar cookies;
+        /// Cookies offered during a single receive
+        std::vector<AddressedDatagram> offers;
+        /// Whether datagrams are numbered for clients which want it
+        bool sequence_numbers;
+        /// Sequence numbers of datagrams sent with a single call
+        std::array<DatagramPrefix, SEND_BATCH_SIZE> prefixes;
+        /// Clients which would have received a message dropped from the
+        /// full buffer
+        Connections::Recipients dropped_recipients;
+        /// Latest numbered datagrams of clients which may report them
+        /// missing
+        RetransmissionHistory history;
+        /// Limit of datagrams sent again
+        RetransmissionLimit retransmission_limit;
+        /// Datagrams sent again during a single receive
+        std::vector<AddressedDatagram> retransmissions;
+        /// Sequence numbers of retransmissions
+        std::vector<DatagramPrefix> retransmission_prefixes;
+        /// Time the history was last pruned
+        std::time_t pruned_at = 0;
+        /// Groups of numbered datagrams of clients which get parity
+        ParityEncoder parity;
+        /// Parity datagrams of groups completed by a single send
+        std::vector<AddressedDatagram> parities;
+
+        /// Memory for data needed during a single loop iteration
+        MonotonicArena scratch;
+
+        /// Server counters
+        ServerStatistics statistics;
 
         /// Message sender
         std::unique_ptr<Sender> sender;
@@ -77,6 +268,12 @@ namespace sik {
             if (sock < 0) {
                 throw ServerException("Error opening socket");
             }
+            // Queue ICMP errors, so clients which went away are noticed.
+            int enable = 1;
+            if (setsockopt(sock, IPPROTO_IP, IP_RECVERR, &enable,
+                           sizeof(enable)) < 0) {
+                throw ServerException("Error enabling socket error queue");
+            }
         }
 
         /**
@@ -96,87 +293,766 @@ namespace sik {
         }
 
         /**
-         * Opens file socket for read only use.
+         * Opens file socket for read only use. Content is compressed once,
+         * every datagram shares the result.
          * @param filename file to open.
+         * @param compress whether to compress the content.
          */
-        void read_file(const std::string &filename) {
+        void read_file(const std::string &filename, bool compress) {
             try {
                 File file(filename);
                 file_content = file.read_content();
+                if (compress) {
+                    compressed_content = compress_text(
+                            std::string(file_content).append(1u, '\0'));
+                }
             } catch (const std::invalid_argument &e) {
                 throw ServerException(e.what());
             } catch (const std::runtime_error &e) {
                 throw ServerException(e.what());
             }
+            file_id = content_id(file_content);
+            if (chunk_size != NO_CHUNKS && Message::message_offset
+                                           + file_content.length() + 1u
+                                           > MAX_MESSAGE_LENGTH) {
+                throw ServerException("File too long to send in chunks");
+            }
+            // Incompressible content goes out as it is.
+            if (COMPRESSED_HEADER_SIZE + compressed_content.length()
+                >= Message::message_offset + file_content.length() + 1u) {
+                compressed_content.clear();
+            }
         }
 
         /**
-         * Handles receiving data from client.
+         * Chooses encoding of the current message for the client.
+         * @param features extensions announced by the client.
+         * @return datagram to send to the client.
          */
-        void receive() noexcept {
-            sockaddr_in client_address = sockaddr_in();
+        const Datagram &encoding(features_t features) noexcept {
+            if ((features & CONTENT_ACKNOWLEDGED) && content_references) {
+                statistics.referenced_datagrams++;
+                statistics.reference_saved_bytes
+                        += current_datagram.length()
+                           - current_reference.length();
+                return current_reference;
+            }
+            if ((features & FEATURE_COMPRESSION)
+                && !current_compressed.empty()) {
+                statistics.compressed_datagrams++;
+                statistics.compression_saved_bytes
+                        += current_datagram.length()
+                           - current_compressed.length();
+                return current_compressed;
+            }
+            return current_datagram;
+        }
+
+        /**
+         * Splits encoding of the current message into chunks, once for all
+         * clients. References are always shorter than chunks.
+         * @param datagram current_datagram or current_compressed.
+         * @return chunks of the datagram.
+         */
+        const std::vector<Datagram> &chunks_of(const Datagram &datagram) {
+            std::vector<Datagram> &chunks = &datagram == &current_compressed
+                                            ? compressed_chunks
+                                            : current_chunks;
+            if (chunks.empty()) {
+                chunks = split_into_chunks(datagram, next_chunked_id++,
+                                           chunk_size);
+            }
+            return chunks;
+        }
+
+        /**
+         * Queues chunks of the datagram for the client, after its frame if
+         * it understands frames.
+         * @param key client address.
+         * @param features extensions announced by the client.
+         * @param datagram encoding of the current message for the client.
+         */
+        void send_chunks(address_t key, features_t features,
+                         const Datagram &datagram) {
+            const std::vector<Datagram> &chunks = chunks_of(datagram);
+            bool framed = frames.is_enabled() && (features & FEATURE_FRAMES);
+            for (const Datagram &chunk: chunks) {
+                if (framed) {
+                    frames.append(key, chunk);
+                } else {
+                    frames.push(key, chunk);
+                }
+            }
+            statistics.chunked_datagrams++;
+            statistics.chunks += chunks.size();
+        }
+
+        /**
+         * Explains why request was rejected.
+         * @param requests received requests.
+         * @param index index of the rejected request.
+         */
+        void report_rejected(const RequestBatch &requests,
+                             std::size_t index) const noexcept {
             try {
-                std::unique_ptr<Message> message =
-                        receiver->receive_message(client_address);
-                if (message->has_message()) {
+                MessageView view(requests.slots + index * REQUEST_SLOT_SIZE,
+                                 requests.lengths[index]);
+                if (view.has_message()) {
                     throw std::invalid_argument(
                             "Only timestamp and a single character expected");
                 }
-                sockaddr_in client_copy = client_address;
-                buffer->push(
-                        std::make_tuple<std::time_t, std::unique_ptr<Message>,
-                                sockaddr_in>(
-                                std::time(0),
-                                std::move(message),
-                                std::move(client_copy)
-                        ));
-                (*poll)[sock].events = POLLIN | POLLOUT;
             } catch (const std::invalid_argument &e) {
-                print_error(client_address, e.what());
+                print_error(requests.addresses[index], e.what());
+            }
+        }
+
+        /**
+         * Handles acknowledgement of the file content. Content is replaced by
+         * its identifier from now on, until the client sends a request again.
+         * Acknowledgements are ignored unless content identifiers are sent.
+         * @param address client address.
+         * @param id identifier of the acknowledged content.
+         * @param now current time.
+         */
+        void acknowledge(const sockaddr_in &address, content_id_t id,
+                         std::time_t now) {
+            if (!content_references) {
+                return;
+            }
+            // Acknowledgements carry no cookie, only validated clients may
+            // send them.
+            if (cookies.is_enabled()
+                && !connections->is_connected(pack_address(address), now)) {
+                return;
+            }
+            // Acknowledgement is not a message, but the client sent it.
+            connections->add_client(address, now);
+            if (id != file_id) {
+                print_error(address, "Acknowledged unknown content");
+                return;
+            }
+            if (connections->get_features(pack_address(address))
+                & FEATURE_CONTENT_ID) {
+                connections->add_features(address, CONTENT_ACKNOWLEDGED);
+            }
+        }
+
+        /**
+         * Offers cookie to the sender of a request without a valid one. The
+         * offer is sent only to clients which understand cookies.
+         * @param address client address.
+         * @param features extensions announced by the client.
+         * @param now current time.
+         */
+        void offer_cookie(const sockaddr_in &address, features_t features,
+                          std::time_t now) {
+            if (!(features & FEATURE_COOKIES)) {
+                statistics.refused_requests++;
+                return;
+            }
+            address_t key = pack_address(address);
+            offers.push_back({key, cookie_offer(cookies.issue(key, now))});
+            statistics.offered_cookies++;
+        }
+
+        /**
+         * Sends cookies offered during receive with a single call. Offers
+         * which would block are dropped, clients send requests again.
+         */
+        void send_offers() noexcept {
+            try {
+                sender->send_datagrams(offers.data(), offers.size());
+            } catch (const WouldBlockException &) {
+            } catch (const ConnectionException &) {
+            }
+            offers.clear();
+        }
+
+        /**
+         * Queues datagrams the client reported missing, as long as they are
+         * kept and the rate limit allows. Only connected clients are
+         * answered, so a spoofed report cannot direct datagrams elsewhere.
+         * @param address client address.
+         * @param first sequence number of the first missing datagram.
+         * @param count number of missing datagrams.
+         * @param now current time.
+         */
+        void retransmit(const sockaddr_in &address, uint32_t first,
+                        uint16_t count, std::time_t now) {
+            address_t key = pack_address(address);
+            if (!retransmission_limit.is_enabled()
+                || !connections->is_connected(key, now)) {
+                return;
+            }
+            // Older datagrams are replaced in the history anyway.
+            count = (uint16_t) std::min<std::size_t>(count,
+                                                     RETRANSMISSION_DEPTH);
+            for (uint32_t sequence = first; sequence != first + count;
+                 sequence++) {
+                const Datagram *datagram = history.find(key, sequence);
+                if (datagram == nullptr) {
+                    statistics.unavailable_retransmissions++;
+                } else if (!retransmission_limit.take(now)) {
+                    statistics.throttled_retransmissions++;
+                } else {
+                    retransmissions.push_back({key, *datagram});
+                    retransmission_prefixes.emplace_back();
+                    write_sequence(retransmission_prefixes.back().bytes,
+                                   sequence);
+                    retransmission_prefixes.back().length
+                            = SEQUENCE_HEADER_SIZE;
+                }
+            }
+        }
+
+        /**
+         * Sends datagrams queued by retransmit. Retransmissions which would
+         * block are dropped rather than delay messages not sent yet,
+         * clients report them again with the next gap.
+         */
+        void send_retransmissions() noexcept {
+            std::size_t sent = 0u;
+            while (sent < retransmissions.size()) {
+                try {
+                    std::size_t count = sender->send_datagrams(
+                            retransmissions.data() + sent,
+                            retransmissions.size() - sent,
+                            retransmission_prefixes.data() + sent);
+                    statistics.retransmitted_datagrams += count;
+                    sent += count;
+                } catch (const WouldBlockException &) {
+                    break;
+                } catch (const ConnectionException &) {
+                    sent++;
+                }
+            }
+            statistics.throttled_retransmissions
+                    += retransmissions.size() - sent;
+            retransmissions.clear();
+            retransmission_prefixes.clear();
+        }
+
+        /**
+         * Counts the oldest message in the full buffer, which is about to be
+         * dropped, as missed by every client which would have received it.
+         */
+        void drop_oldest() {
+            statistics.overwritten_messages++;
+            if (!sequence_numbers) {
+                return;
+            }
+            const BufferData &oldest = (*buffer)[0];
+            if (topics) {
+                connections->get_recipients(
+                        std::get<0>(oldest), &std::get<2>(oldest),
+                        std::get<1>(oldest)->get_character(),
+                        dropped_recipients);
+            } else {
+                connections->get_recipients(std::get<0>(oldest),
+                                            &std::get<2>(oldest),
+                                            dropped_recipients);
+            }
+            address_t key;
+            while (dropped_recipients.next(key)) {
+                connections->add_missed(key);
+                statistics.missed_messages++;
+            }
+        }
+
+        /**
+         * Handles receiving data from clients. All waiting requests are
+         * received at once and validated together.
+         */
+        void receive() noexcept {
+            RequestBatch &requests = *new(scratch.allocate(
+                    sizeof(RequestBatch), alignof(RequestBatch))) RequestBatch;
+            std::size_t count;
+            try {
+                count = receiver->receive_requests(requests);
+            } catch (const WouldBlockException &) {
+                return;
             } catch (const ConnectionException &) {
                 std::cerr << "Unexpected error occurred while receiving message"
                           << std::endl;
+                return;
             }
 
-            // Add client address to send him messages.
-            connections->add_client(client_address, std::time(0));
+            // Extensions follow the header, only the header is validated.
+            // Acknowledgements and reports of missing datagrams are not
+            // requests, they are handled apart.
+            features_t *features = (features_t *) scratch.allocate(
+                    count * sizeof(features_t), alignof(features_t));
+            cookie_t *echoed = (cookie_t *) scratch.allocate(
+                    count * sizeof(cookie_t), alignof(cookie_t));
+            uint64_t controls = 0u;
+            std::time_t now = std::time(0);
+            for (std::size_t i = 0u; i < count; i++) {
+                const char *request = requests.slots + i * REQUEST_SLOT_SIZE;
+                features[i] = NO_FEATURES;
+                echoed[i] = NO_COOKIE;
+                content_id_t id;
+                uint32_t first;
+                uint16_t missing;
+                if (read_request_extension(request, requests.lengths[i],
+                                           features[i], echoed[i])) {
+                    requests.lengths[i] = Message::message_offset;
+                } else if (read_acknowledgement(request, requests.lengths[i],
+                                                id)) {
+                    controls |= (uint64_t) 1u << i;
+                    acknowledge(requests.addresses[i], id, now);
+                } else if (read_nack(request, requests.lengths[i], first,
+                                     missing)) {
+                    controls |= (uint64_t) 1u << i;
+                    retransmit(requests.addresses[i], first, missing, now);
+                }
+            }
+
+            // Decoded headers, in structure of arrays form.
+            uint64_t *timestamps = (uint64_t *) scratch.allocate(
+                    count * sizeof(uint64_t), alignof(uint64_t));
+            char *characters = (char *) scratch.allocate(count, 1u);
+            uint64_t accepted = validate_headers(
+                    requests.slots, REQUEST_SLOT_SIZE, requests.lengths, count,
+                    Message::message_offset, MAX_TIMESTAMP, timestamps,
+                    characters);
+
+            for (std::size_t i = 0u; i < count; i++) {
+                if ((controls >> i) & 1u) {
+                    continue;
+                }
+                const sockaddr_in &client_address = requests.addresses[i];
+                bool accept = (accepted >> i) & 1u;
+                // Senders which may be spoofed are neither sent to nor
+                // registered.
+                if (cookies.is_enabled()
+                    && !cookies.is_valid(pack_address(client_address),
+                                         echoed[i], now)) {
+                    if (accept) {
+                        offer_cookie(client_address, features[i], now);
+                    } else {
+                        report_rejected(requests, i);
+                    }
+                    accepted &= ~((uint64_t) 1u << i);
+                    continue;
+                }
+                if (!accept) {
+                    report_rejected(requests, i);
+                } else if (!duplicates.is_repeated(
+                        pack_address(client_address), timestamps[i],
+                        characters[i], now)) {
+                    // Repeated requests still keep the client active.
+                    if (buffer->size() == buffer->capacity()) {
+                        drop_oldest();
+                    }
+                    buffer->push(std::make_tuple(
+                            now,
+                            std::make_unique<Message>(timestamps[i],
+                                                      characters[i],
+                                                      std::string()),
+                            client_address));
+                }
+
+                // Add client address to send him messages.
+                if (accept && topics) {
+                    connections->add_client(client_address, now,
+                                            characters[i]);
+                } else {
+                    connections->add_client(client_address, now);
+                }
+                connections->set_features(
+                        client_address,
+                        accept ? features[i] & SUPPORTED_FEATURES
+                               : NO_FEATURES);
+            }
+            if (!offers.empty()) {
+                send_offers();
+            }
+            if (!retransmissions.empty()) {
+                send_retransmissions();
+            }
+            if (accepted != 0u) {
+                (*poll)[sock].events = POLLIN | POLLOUT;
+            }
         }
 
         /**
-         * Prepares data to send to client.
+         * Handles errors queued on the socket, disconnecting clients reported
+         * as unreachable.
          */
-        void prepare_send_data() {
-            while (current_clients.size() == 0 && buffer->size() > 0) {
+        void receive_errors() noexcept {
+            for (;;) {
+                sockaddr_in client_address = sockaddr_in();
+                try {
+                    if (receiver->receive_error(client_address)
+                        && connections->disconnect(client_address)) {
+                        statistics.unreachable_clients++;
+                    }
+                } catch (const WouldBlockException &) {
+                    return;
+                } catch (const ConnectionException &) {
+                    return;
+                }
+            }
+        }
+
+        /**
+         * Finds next recipient of the current message, deferred slow clients
+         * come last.
+         * @param key set to the recipient address.
+         * @return whether there was a recipient left.
+         */
+        bool next_recipient(address_t &key) noexcept {
+            if (current_clients.next(key)) {
+                return true;
+            }
+            if (deferred_position < deferred.size()) {
+                key = deferred[deferred_position++];
+                return true;
+            }
+            return false;
+        }
+
+        /**
+         * Fills the batch with the next recipients of the current message,
+         * dropping it for suspended clients. Clients which understand frames
+         * get the message packed into their frame instead, clients which
+         * understand chunks get long messages in chunks.
+         */
+        void fill_batch() {
+            std::time_t now = std::time(0);
+            // Features are looked up only when some extension is enabled.
+            bool extended = frames.is_enabled() || !compressed_content.empty()
+                            || content_references || chunk_size != NO_CHUNKS;
+            address_t key;
+            // Queued frames and chunks are bounded like the batch.
+            while (batch_end < batch.size()
+                   && frames.ready_count() < batch.size()
+                   && next_recipient(key)) {
+                if (slow_clients.is_suspended(key, now)) {
+                    slow_clients.skip(key);
+                    continue;
+                }
+                features_t features = extended ? connections->get_features(key)
+                                               : NO_FEATURES;
+                const Datagram &datagram = encoding(features);
+                if (chunk_size != NO_CHUNKS && (features & FEATURE_CHUNKS)
+                    && datagram.length() > chunk_size) {
+                    send_chunks(key, features, datagram);
+                } else if (datagram.length() > MAX_FRAME_LENGTH) {
+                    statistics.oversized_datagrams++;
+                } else if (frames.is_enabled() && (features & FEATURE_FRAMES)) {
+                    frames.append(key, datagram);
+                } else {
+                    batch_datagrams[batch_end] = &datagram;
+                    batch[batch_end++] = key;
+                }
+            }
+        }
+
+        /**
+         * Handles blocked send to the first client in the batch, applying
+         * the slow client policy once the client blocked too many times.
+         * Without memory to track the client, its send is simply retried.
+         */
+        void handle_block() noexcept {
+            address_t key = batch[batch_begin];
+            std::time_t now = std::time(0);
+            try {
+                switch (slow_clients.block(key, now, now - current_time,
+                                           buffer->size())) {
+                    case SlowClientAction::DEFER:
+                        if (std::find(deferred.begin(),
+                                      deferred.begin() + deferred_position,
+                                      key)
+                            == deferred.begin() + deferred_position) {
+                            deferred.push_back(key);
+                        } else {
+                            // Deferred once already, there is no one to wait
+                            // for.
+                            slow_clients.skip(key);
+                        }
+                        batch_begin++;
+                        break;
+                    case SlowClientAction::SKIP:
+                    case SlowClientAction::SUSPEND:
+                        batch_begin++;
+                        break;
+                    default:
+                        break;
+                }
+            } catch (const std::bad_alloc &) {
+                // Same as SlowClientAction::NONE.
+            }
+        }
+
+        /**
+         * Prepares data to send to clients, filling the batch with the next
+         * recipients of the current message. Frames are closed once the
+         * buffer is empty, ending the burst.
+         * @return whether there is anything to send.
+         */
+        bool prepare_send_data() {
+            while (batch_begin == batch_end) {
+                batch_begin = batch_end = 0u;
+                fill_batch();
+                if (batch_end > 0 || frames.has_ready()) {
+                    return true;
+                }
+                if (buffer->size() == 0) {
+                    frames.flush();
+                    return frames.has_ready();
+                }
+                deferred.clear();
+                deferred_position = 0u;
                 BufferData current_item = buffer->pop();
-                current_clients = connections->get_clients(
-                        std::get<0>(current_item), &std::get<2>(current_item));
+                current_time = std::get<0>(current_item);
                 current_message = std::move(std::get<1>(current_item));
-                current_message->set_message(file_content);
+                if (topics) {
+                    connections->get_recipients(
+                            current_time, &std::get<2>(current_item),
+                            current_message->get_character(), current_clients);
+                } else {
+                    connections->get_recipients(current_time,
+                                                &std::get<2>(current_item),
+                                                current_clients);
+                }
+                // Received messages have no content, file content is
+                // appended and the datagram is null terminated.
+                current_datagram = Datagram(*current_message, file_content,
+                                            true);
+                if (!compressed_content.empty()) {
+                    current_compressed = compressed_datagram(
+                            *current_message, compressed_content,
+                            file_content.length() + 1u);
+                }
+                if (content_references) {
+                    current_reference = reference_datagram(*current_message,
+                                                           file_id);
+                }
+                current_chunks.clear();
+                compressed_chunks.clear();
+                std::size_t saved
+                        = connections->count_disconnected(current_time);
+                statistics.saved_datagrams += saved;
+                statistics.saved_bytes += saved * current_datagram.length();
+            }
+            return true;
+        }
+
+        /**
+         * Expires client connections which ended before the arrival of the
+         * oldest message that has not been sent yet.
+         */
+        void expire_connections() {
+            std::time_t watermark = std::time(0);
+            if (!current_clients.done() || batch_begin < batch_end
+                || deferred_position < deferred.size()) {
+                watermark = current_time;
+            } else if (buffer->size() > 0) {
+                watermark = std::get<0>((*buffer)[0]);
+            }
+            connections->expire(watermark);
+            std::time_t now = std::time(0);
+            if (now == pruned_at) {
+                return;
+            }
+            pruned_at = now;
+            if (retransmission_limit.is_enabled()) {
+                history.prune([this](address_t key) {
+                    return (connections->get_features(key)
+                            & FEATURE_RETRANSMISSION) != 0u;
+                });
+            }
+            if (parity.is_enabled()) {
+                parity.prune([this](address_t key) {
+                    return (connections->get_features(key)
+                            & FEATURE_PARITY) != 0u;
+                });
+            }
+            slow_clients.prune([this](address_t key) {
+                return connections->has_client(key);
+            });
+        }
+
+        /**
+         * Numbers datagrams about to be sent with a single call, for clients
+         * which announced FEATURE_SEQUENCE.
+         * @param key_of function returning receiver of the datagram at index.
+         * @param count number of datagrams.
+         * @return prefixes of the datagrams, nullptr if datagrams are not
+         * numbered.
+         */
+        template<typename F>
+        const DatagramPrefix *number(F key_of, std::size_t count) {
+            if (!sequence_numbers) {
+                return nullptr;
+            }
+            count = std::min(count, SEND_BATCH_SIZE);
+            for (std::size_t i = 0u; i < count; i++) {
+                address_t key = key_of(i);
+                prefixes[i].length = 0u;
+                if (connections->get_features(key) & FEATURE_SEQUENCE) {
+                    write_sequence(prefixes[i].bytes,
+                                   connections->next_sequence(key));
+                    prefixes[i].length = SEQUENCE_HEADER_SIZE;
+                }
+            }
+            return prefixes.data();
+        }
+
+        /**
+         * Records numbered datagrams which were sent for retransmission and
+         * parity and returns sequence numbers of the ones which were not
+         * sent after all, so receivers see no gap. Dropped datagrams keep
+         * theirs.
+         * @param key_of function returning receiver of the datagram at index.
+         * @param datagram_of function returning the datagram at index.
+         * @param count number of numbered datagrams.
+         * @param used number of leading datagrams sent or dropped.
+         */
+        template<typename F, typename G>
+        void settle(F key_of, G datagram_of, std::size_t count,
+                    std::size_t used) {
+            if (!sequence_numbers) {
+                return;
+            }
+            count = std::min(count, SEND_BATCH_SIZE);
+            bool recorded = retransmission_limit.is_enabled()
+                            || parity.is_enabled();
+            for (std::size_t i = 0u; recorded && i < used; i++) {
+                uint32_t sequence;
+                if (!read_sequence(prefixes[i].bytes, prefixes[i].length,
+                                   sequence)) {
+                    continue;
+                }
+                address_t key = key_of(i);
+                features_t features = connections->get_features(key);
+                if (retransmission_limit.is_enabled()
+                    && (features & FEATURE_RETRANSMISSION)) {
+                    history.record(key, sequence, datagram_of(i));
+                }
+                Datagram group_parity;
+                if (parity.is_enabled() && (features & FEATURE_PARITY)
+                    && parity.add(key, sequence, datagram_of(i),
+                                  group_parity)) {
+                    parities.push_back({key, std::move(group_parity)});
+                }
+            }
+            for (std::size_t i = count; i > used; i--) {
+                if (prefixes[i - 1u].length > 0u) {
+                    connections->rewind_sequence(key_of(i - 1u));
+                }
+            }
+        }
+
+        /**
+         * Sends parity of groups completed by the last send. Parity which
+         * would block is dropped rather than delay messages not sent yet,
+         * it only protects datagrams sent already.
+         */
+        void send_parities() noexcept {
+            std::size_t sent = 0u;
+            while (sent < parities.size()) {
+                try {
+                    std::size_t count = sender->send_datagrams(
+                            parities.data() + sent, parities.size() - sent);
+                    for (std::size_t i = sent; i < sent + count; i++) {
+                        statistics.parity_bytes
+                                += parities[i].datagram.length();
+                    }
+                    statistics.parity_datagrams += count;
+                    sent += count;
+                } catch (const WouldBlockException &) {
+                    break;
+                } catch (const ConnectionException &) {
+                    sent++;
+                }
+            }
+            statistics.dropped_parities += parities.size() - sent;
+            parities.clear();
+        }
+
+        /**
+         * Sends closed frames, as many as a single call allows. Frames which
+         * could not be sent yet because the socket would block stay queued.
+         */
+        void send_frames() noexcept {
+            const AddressedDatagram *ready = frames.next_ready();
+            auto key_of = [ready](std::size_t i) {
+                return ready[i].key;
+            };
+            auto datagram_of = [ready](std::size_t i) -> const Datagram & {
+                return ready[i].datagram;
+            };
+            std::size_t count = frames.ready_count();
+            std::size_t used = 0u;
+            try {
+                used = sender->send_datagrams(ready, count,
+                                              number(key_of, count));
+            } catch (const WouldBlockException &) {
+            } catch (const ConnectionException &) {
+                sockaddr_in client_address = unpack_address(ready->key);
+                std::cerr << "Error occurred while sending message to "
+                          << inet_ntoa(client_address.sin_addr) << ":"
+                          << ntohs(client_address.sin_port) << std::endl;
+                used = 1u;
+            }
+            settle(key_of, datagram_of, count, used);
+            frames.pop_ready(used);
+            if (!parities.empty()) {
+                send_parities();
             }
         }
 
         /**
-         * Sends data of current_message to the first client in current_clients
-         * list. If there are no clients left moves onto next message.
+         * Sends data of current_message to the next batch of clients in
+         * current_clients list. If there are no clients left moves onto next
+         * message. Clients the message could not be sent to yet because the
+         * socket would block stay in the batch. Closed frames go first.
          */
         void send() noexcept {
-            prepare_send_data();
-            if (current_clients.size() == 0) {
+            if (frames.has_ready()) {
+                send_frames();
+                return;
+            }
+            if (!prepare_send_data()) {
                 (*poll)[sock].events = POLLIN;
                 return;
             }
+            if (frames.has_ready()) {
+                send_frames();
+                return;
+            }
 
-            sockaddr_in client_address = current_clients.front();
-            current_clients.pop();
-
+            const address_t *keys = batch.data() + batch_begin;
+            const Datagram *const *datagrams
+                    = batch_datagrams.data() + batch_begin;
+            auto key_of = [keys](std::size_t i) {
+                return keys[i];
+            };
+            auto datagram_of = [datagrams](std::size_t i) -> const Datagram & {
+                return *datagrams[i];
+            };
+            std::size_t count = batch_end - batch_begin;
+            std::size_t used = 0u;
             try {
-                sender->send_message(client_address, current_message, true);
+                used = sender->send_datagram_batch(
+                        keys, datagrams, count, number(key_of, count));
+                slow_clients.deliver(keys, used);
+                batch_begin += used;
             } catch (const WouldBlockException &) {
-                current_clients.push(client_address);
+                handle_block();
             } catch (const ConnectionException &) {
+                sockaddr_in client_address = unpack_address(batch[batch_begin]);
                 std::cerr << "Error occurred while sending message to "
-                          << inet_ntoa(address.sin_addr) << ":"
-                          << address.sin_port << std::endl;
+                          << inet_ntoa(client_address.sin_addr) << ":"
+                          << ntohs(client_address.sin_port) << std::endl;
+                batch_begin++;
+                used = 1u;
+            }
+            settle(key_of, datagram_of, count, used);
+            if (!parities.empty()) {
+                send_parities();
             }
         }
 
@@ -185,14 +1061,40 @@ namespace sik {
          * Creates new server instance.
          * @param port port to bind server to.
          * @param filename filename which content to add to every message sent.
+         * @param capacity number of datagrams the buffer can hold.
+         * @param options optional features.
+         * @throws ServerException when buffer cannot be allocated.
          */
-        Server(uint16_t port, const std::string &filename) {
+        Server(uint16_t port, const std::string &filename,
+               std::size_t capacity = buffer_size,
+               const ServerOptions &options = ServerOptions())
+                : topics(options.topics),
+                  content_references(options.content_id),
+                  chunk_size(options.chunk_size),
+                  slow_clients(options.slow_client_policy),
+                  frames(options.frame_budget),
+                  duplicates(options.duplicate_window),
+                  cookies(options.cookies ? COOKIE_LIFETIME : NO_COOKIES),
+                  sequence_numbers(options.sequence_numbers
+                                   || options.retransmission_rate
+                                      != NO_RETRANSMISSION
+                                   || options.parity_group != NO_PARITY),
+                  retransmission_limit(options.retransmission_rate),
+                  parity(options.parity_group) {
             open_socket();
             bind_socket(port);
-            read_file(filename);
+            read_file(filename, options.compression);
 
-            buffer = std::make_unique<Buffer<BufferData, buffer_size>>();
-            connections = std::make_unique<Connections>();
+            try {
+                buffer = std::make_unique<Buffer<BufferData, buffer_size>>(
+                        capacity);
+            } catch (const std::invalid_argument &e) {
+                throw ServerException(e.what());
+            } catch (const std::bad_alloc &) {
+                throw ServerException("Unable to allocate buffer");
+            }
+            deferred.reserve(std::min(options.max_clients, DEFERRED_CAPACITY));
+            connections = std::make_unique<Connections>(options.max_clients);
             poll = std::make_unique<Poll<1>>();
             poll->add_descriptor(sock, POLLIN | POLLOUT);
 
@@ -217,7 +1119,8 @@ namespace sik {
             stopping = false;
             while (!stopping) {
                 try {
-                    poll->wait(-1);
+                    poll->wait(TICK_INTERVAL);
+                } catch (const PollTimeoutException &) {
                 } catch (const std::exception &) {
                     continue;
                 }
@@ -226,6 +1129,12 @@ namespace sik {
                     return;
                 }
 
+                scratch.reset();
+                if ((*poll)[sock].revents & POLLERR) {
+                    receive_errors();
+                }
+                expire_connections();
+
                 if ((*poll)[sock].revents & POLLIN) {
                     receive();
                 }
@@ -236,6 +1145,48 @@ namespace sik {
             }
         }
 
+        /**
+         * @return server counters.
+         */
+        const ServerStatistics &get_statistics() const noexcept {
+            return statistics;
+        }
+
+        /**
+         * @return client connections.
+         */
+        const Connections &get_connections() const noexcept {
+            return *connections;
+        }
+
+        /**
+         * @return frames packing messages for clients.
+         */
+        const FramePacker &get_frames() const noexcept {
+            return frames;
+        }
+
+        /**
+         * @return groups of datagrams of clients which get parity.
+         */
+        const ParityEncoder &get_parity() const noexcept {
+            return parity;
+        }
+
+        /**
+         * @return filter of repeated requests.
+         */
+        const DuplicateFilter &get_duplicates() const noexcept {
+            return duplicates;
+        }
+
+        /**
+         * @return statistics of clients which sends blocked.
+         */
+        const SlowClients &get_slow_clients() const noexcept {
+            return slow_clients;
+        }
+
         /**
          * Stops server main loop.
          */
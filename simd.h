@@ -0,0 +1,426 @@
+#ifndef SIK_UDP_SIMD_H
+#define SIK_UDP_SIMD_H
+
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <endian.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIK_UDP_X86 1
+#endif
+
+namespace sik {
+    /**
+     * @return whether the processor supports AVX2 instructions.
+     */
+    inline bool has_avx2() noexcept {
+#ifdef SIK_UDP_X86
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+        return avx2;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @return whether the processor supports SSE2 instructions.
+     */
+    inline bool has_sse2() noexcept {
+#ifdef SIK_UDP_X86
+        static const bool sse2 = __builtin_cpu_supports("sse2");
+        return sse2;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * @return whether the processor supports SSE4.2 instructions.
+     */
+    inline bool has_sse42() noexcept {
+#ifdef SIK_UDP_X86
+        static const bool sse42 = __builtin_cpu_supports("sse4.2");
+        return sse42;
+#else
+        return false;
+#endif
+    }
+
+    /**
+     * Sets bit i of words when lo[i] <= value <= hi[i]. Scalar version.
+     * @param lo lower bounds.
+     * @param hi upper bounds.
+     * @param length number of bounds.
+     * @param value compared value.
+     * @param words bitmap of (length + 63) / 64 words, overwritten.
+     */
+    inline void mask_between_scalar(const int64_t *lo, const int64_t *hi,
+                                    std::size_t length, int64_t value,
+                                    uint64_t *words) noexcept {
+        for (std::size_t base = 0u; base < length; base += 64u) {
+            std::size_t count = std::min<std::size_t>(64u, length - base);
+            uint64_t word = 0u;
+            for (std::size_t i = 0u; i < count; i++) {
+                uint64_t in = (lo[base + i] <= value) & (hi[base + i] >= value);
+                word |= in << i;
+            }
+            words[base / 64u] = word;
+        }
+    }
+
+#ifdef SIK_UDP_X86
+    /**
+     * Sets bit i of words when lo[i] <= value <= hi[i]. AVX2 version
+     * comparing four bounds at once.
+     * @param lo lower bounds.
+     * @param hi upper bounds.
+     * @param length number of bounds.
+     * @param value compared value.
+     * @param words bitmap of (length + 63) / 64 words, overwritten.
+     */
+    __attribute__((target("avx2")))
+    inline void mask_between_avx2(const int64_t *lo, const int64_t *hi,
+                                  std::size_t length, int64_t value,
+                                  uint64_t *words) noexcept {
+        const __m256i values = _mm256_set1_epi64x(value);
+        std::size_t base = 0u;
+        for (; base + 64u <= length; base += 64u) {
+            uint64_t word = 0u;
+            for (std::size_t i = 0u; i < 64u; i += 4u) {
+                __m256i low = _mm256_loadu_si256(
+                        (const __m256i *) (lo + base + i));
+                __m256i high = _mm256_loadu_si256(
+                        (const __m256i *) (hi + base + i));
+                __m256i outside = _mm256_or_si256(
+                        _mm256_cmpgt_epi64(low, values),
+                        _mm256_cmpgt_epi64(values, high));
+                uint64_t bits = (uint64_t) _mm256_movemask_pd(
+                        _mm256_castsi256_pd(outside));
+                word |= (~bits & 0xfu) << i;
+            }
+            words[base / 64u] = word;
+        }
+        if (base < length) {
+            mask_between_scalar(lo + base, hi + base, length - base, value,
+                                words + base / 64u);
+        }
+    }
+#endif
+
+    /**
+     * Sets bit i of words when lo[i] <= value <= hi[i], using the widest
+     * instructions the processor supports.
+     * @param lo lower bounds.
+     * @param hi upper bounds.
+     * @param length number of bounds.
+     * @param value compared value.
+     * @param words bitmap of (length + 63) / 64 words, overwritten.
+     */
+    inline void mask_between(const int64_t *lo, const int64_t *hi,
+                             std::size_t length, int64_t value,
+                             uint64_t *words) noexcept {
+#ifdef SIK_UDP_X86
+        if (has_avx2()) {
+            mask_between_avx2(lo, hi, length, value, words);
+            return;
+        }
+#endif
+        mask_between_scalar(lo, hi, length, value, words);
+    }
+
+    /**
+     * Sets destination to its XOR with the source. Scalar version working
+     * on 64-bit words.
+     * @param destination bytes to update, may be unaligned.
+     * @param source bytes to XOR with, may be unaligned.
+     * @param length number of bytes.
+     */
+    inline void xor_into_scalar(char *destination, const char *source,
+                                std::size_t length) noexcept {
+        std::size_t i = 0u;
+        for (; i + 8u <= length; i += 8u) {
+            uint64_t a, b;
+            std::memcpy(&a, destination + i, sizeof(a));
+            std::memcpy(&b, source + i, sizeof(b));
+            a ^= b;
+            std::memcpy(destination + i, &a, sizeof(a));
+        }
+        for (; i < length; i++) {
+            destination[i] ^= source[i];
+        }
+    }
+
+#ifdef SIK_UDP_X86
+    /**
+     * Sets destination to its XOR with the source. SSE2 version working on
+     * 16 bytes at once.
+     * @param destination bytes to update, may be unaligned.
+     * @param source bytes to XOR with, may be unaligned.
+     * @param length number of bytes.
+     */
+    __attribute__((target("sse2")))
+    inline void xor_into_sse2(char *destination, const char *source,
+                              std::size_t length) noexcept {
+        std::size_t i = 0u;
+        for (; i + 16u <= length; i += 16u) {
+            __m128i a = _mm_loadu_si128((const __m128i *) (destination + i));
+            __m128i b = _mm_loadu_si128((const __m128i *) (source + i));
+            _mm_storeu_si128((__m128i *) (destination + i),
+                             _mm_xor_si128(a, b));
+        }
+        xor_into_scalar(destination + i, source + i, length - i);
+    }
+
+    /**
+     * Sets destination to its XOR with the source. AVX2 version working on
+     * 64 bytes at once, in two independent registers.
+     * @param destination bytes to update, may be unaligned.
+     * @param source bytes to XOR with, may be unaligned.
+     * @param length number of bytes.
+     */
+    __attribute__((target("avx2")))
+    inline void xor_into_avx2(char *destination, const char *source,
+                              std::size_t length) noexcept {
+        std::size_t i = 0u;
+        for (; i + 64u <= length; i += 64u) {
+            __m256i a0 = _mm256_loadu_si256(
+                    (const __m256i *) (destination + i));
+            __m256i a1 = _mm256_loadu_si256(
+                    (const __m256i *) (destination + i + 32u));
+            __m256i b0 = _mm256_loadu_si256((const __m256i *) (source + i));
+            __m256i b1 = _mm256_loadu_si256(
+                    (const __m256i *) (source + i + 32u));
+            _mm256_storeu_si256((__m256i *) (destination + i),
+                                _mm256_xor_si256(a0, b0));
+            _mm256_storeu_si256((__m256i *) (destination + i + 32u),
+                                _mm256_xor_si256(a1, b1));
+        }
+        for (; i + 32u <= length; i += 32u) {
+            __m256i a = _mm256_loadu_si256(
+                    (const __m256i *) (destination + i));
+            __m256i b = _mm256_loadu_si256((const __m256i *) (source + i));
+            _mm256_storeu_si256((__m256i *) (destination + i),
+                                _mm256_xor_si256(a, b));
+        }
+        xor_into_scalar(destination + i, source + i, length - i);
+    }
+#endif
+
+    /**
+     * Sets destination to its XOR with the source, using the widest
+     * instructions the processor supports.
+     * @param destination bytes to update, may be unaligned.
+     * @param source bytes to XOR with, may be unaligned.
+     * @param length number of bytes.
+     */
+    inline void xor_into(char *destination, const char *source,
+                         std::size_t length) noexcept {
+#ifdef SIK_UDP_X86
+        if (has_avx2()) {
+            xor_into_avx2(destination, source, length);
+            return;
+        }
+        if (has_sse2()) {
+            xor_into_sse2(destination, source, length);
+            return;
+        }
+#endif
+        xor_into_scalar(destination, source, length);
+    }
+
+    /// Maximum number of headers validated at once.
+    const std::size_t HEADER_BATCH_SIZE = 64u;
+
+    /**
+     * Decodes and validates headers of datagrams stored in slots of equal
+     * size. Header i starts at slots + i * stride with a big endian 64-bit
+     * timestamp followed by a character. Scalar version.
+     * @param slots datagrams, every slot at least 16 bytes long.
+     * @param stride distance between slots.
+     * @param lengths datagram lengths.
+     * @param count number of datagrams, at most HEADER_BATCH_SIZE.
+     * @param length only datagrams of this length are accepted.
+     * @param max_timestamp only timestamps up to this one are accepted.
+     * @param timestamps decoded timestamps, overwritten.
+     * @param characters decoded characters, overwritten.
+     * @return mask with bit i set when datagram i is accepted.
+     */
+    inline uint64_t validate_headers_scalar(const char *slots,
+                                            std::size_t stride,
+                                            const uint32_t *lengths,
+                                            std::size_t count,
+                                            uint32_t length,
+                                            uint64_t max_timestamp,
+                                            uint64_t *timestamps,
+                                            char *characters) noexcept {
+        uint64_t accept = 0u;
+        for (std::size_t i = 0u; i < count; i++) {
+            uint64_t big_endian;
+            std::memcpy(&big_endian, slots + i * stride, sizeof(big_endian));
+            timestamps[i] = be64toh(big_endian);
+            characters[i] = slots[i * stride + sizeof(big_endian)];
+            uint64_t valid = (timestamps[i] <= max_timestamp)
+                             & (lengths[i] == length);
+            accept |= valid << i;
+        }
+        return accept;
+    }
+
+#ifdef SIK_UDP_X86
+    /**
+     * Validates headers like validate_headers_scalar, two at a time with
+     * SSE4.2 instructions. Timestamps above 2^63 - 1 are rejected.
+     * @param slots datagrams, every slot at least 16 bytes long.
+     * @param stride distance between slots.
+     * @param lengths datagram lengths.
+     * @param count number of datagrams, at most HEADER_BATCH_SIZE.
+     * @param length only datagrams of this length are accepted.
+     * @param max_timestamp only timestamps up to this one are accepted.
+     * @param timestamps decoded timestamps, overwritten.
+     * @param characters decoded characters, overwritten.
+     * @return mask with bit i set when datagram i is accepted.
+     */
+    __attribute__((target("sse4.2")))
+    inline uint64_t validate_headers_sse42(const char *slots,
+                                           std::size_t stride,
+                                           const uint32_t *lengths,
+                                           std::size_t count,
+                                           uint32_t length,
+                                           uint64_t max_timestamp,
+                                           uint64_t *timestamps,
+                                           char *characters) noexcept {
+        const __m128i swap = _mm_set_epi8(8, 9, 10, 11, 12, 13, 14, 15,
+                                          0, 1, 2, 3, 4, 5, 6, 7);
+        const __m128i max = _mm_set1_epi64x((long long) max_timestamp);
+        const __m128i expected = _mm_set1_epi32((int) length);
+        const __m128i zero = _mm_setzero_si128();
+        uint64_t accept = 0u;
+        std::size_t i = 0u;
+        for (; i + 2u <= count; i += 2u) {
+            uint64_t first, second;
+            std::memcpy(&first, slots + i * stride, sizeof(first));
+            std::memcpy(&second, slots + (i + 1u) * stride, sizeof(second));
+            __m128i values = _mm_shuffle_epi8(
+                    _mm_set_epi64x((long long) second, (long long) first),
+                    swap);
+            _mm_storeu_si128((__m128i *) (timestamps + i), values);
+            __m128i invalid = _mm_or_si128(_mm_cmpgt_epi64(values, max),
+                                           _mm_cmpgt_epi64(zero, values));
+            __m128i proper_length = _mm_cvtepi32_epi64(_mm_cmpeq_epi32(
+                    _mm_loadl_epi64((const __m128i *) (lengths + i)),
+                    expected));
+            __m128i valid = _mm_andnot_si128(invalid, proper_length);
+            accept |= (uint64_t) _mm_movemask_pd(_mm_castsi128_pd(valid)) << i;
+            characters[i] = slots[i * stride + sizeof(uint64_t)];
+            characters[i + 1u] = slots[(i + 1u) * stride + sizeof(uint64_t)];
+        }
+        if (i < count) {
+            accept |= validate_headers_scalar(
+                    slots + i * stride, stride, lengths + i, count - i, length,
+                    max_timestamp, timestamps + i, characters + i) << i;
+        }
+        return accept;
+    }
+
+    /**
+     * Validates headers like validate_headers_scalar, four at a time with
+     * AVX2 instructions. Timestamps above 2^63 - 1 are rejected.
+     * @param slots datagrams, every slot at least 16 bytes long.
+     * @param stride distance between slots.
+     * @param lengths datagram lengths.
+     * @param count number of datagrams, at most HEADER_BATCH_SIZE.
+     * @param length only datagrams of this length are accepted.
+     * @param max_timestamp only timestamps up to this one are accepted.
+     * @param timestamps decoded timestamps, overwritten.
+     * @param characters decoded characters, overwritten.
+     * @return mask with bit i set when datagram i is accepted.
+     */
+    __attribute__((target("avx2")))
+    inline uint64_t validate_headers_avx2(const char *slots,
+                                          std::size_t stride,
+                                          const uint32_t *lengths,
+                                          std::size_t count,
+                                          uint32_t length,
+                                          uint64_t max_timestamp,
+                                          uint64_t *timestamps,
+                                          char *characters) noexcept {
+        const __m256i swap = _mm256_set_epi8(
+                8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7,
+                8, 9, 10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i max = _mm256_set1_epi64x((long long) max_timestamp);
+        const __m128i expected = _mm_set1_epi32((int) length);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i offsets = _mm256_set_epi64x(
+                (long long) (3u * stride), (long long) (2u * stride),
+                (long long) stride, 0);
+        uint64_t accept = 0u;
+        std::size_t i = 0u;
+        for (; i + 4u <= count; i += 4u) {
+            __m256i values = _mm256_shuffle_epi8(_mm256_i64gather_epi64(
+                    (const long long *) (slots + i * stride), offsets, 1),
+                                                 swap);
+            _mm256_storeu_si256((__m256i *) (timestamps + i), values);
+            __m256i invalid = _mm256_or_si256(
+                    _mm256_cmpgt_epi64(values, max),
+                    _mm256_cmpgt_epi64(zero, values));
+            __m256i proper_length = _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(
+                    _mm_loadu_si128((const __m128i *) (lengths + i)),
+                    expected));
+            __m256i valid = _mm256_andnot_si256(invalid, proper_length);
+            accept |= (uint64_t) _mm256_movemask_pd(
+                    _mm256_castsi256_pd(valid)) << i;
+            for (std::size_t j = i; j < i + 4u; j++) {
+                characters[j] = slots[j * stride + sizeof(uint64_t)];
+            }
+        }
+        if (i < count) {
+            accept |= validate_headers_scalar(
+                    slots + i * stride, stride, lengths + i, count - i, length,
+                    max_timestamp, timestamps + i, characters + i) << i;
+        }
+        return accept;
+    }
+#endif
+
+    /**
+     * Validates headers like validate_headers_scalar, using the widest
+     * instructions the processor supports.
+     * @param slots datagrams, every slot at least 16 bytes long.
+     * @param stride distance between slots.
+     * @param lengths datagram lengths.
+     * @param count number of datagrams, at most HEADER_BATCH_SIZE.
+     * @param length only datagrams of this length are accepted.
+     * @param max_timestamp only timestamps up to this one are accepted,
+     * at most 2^63 - 1.
+     * @param timestamps decoded timestamps, overwritten.
+     * @param characters decoded characters, overwritten.
+     * @return mask with bit i set when datagram i is accepted.
+     */
+    inline uint64_t validate_headers(const char *slots, std::size_t stride,
+                                     const uint32_t *lengths,
+                                     std::size_t count, uint32_t length,
+                                     uint64_t max_timestamp,
+                                     uint64_t *timestamps,
+                                     char *characters) noexcept {
+#ifdef SIK_UDP_X86
+        if (has_avx2()) {
+            return validate_headers_avx2(slots, stride, lengths, count, length,
+                                         max_timestamp, timestamps,
+                                         characters);
+        }
+        if (has_sse42()) {
+            return validate_headers_sse42(slots, stride, lengths, count,
+                                          length, max_timestamp, timestamps,
+                                          characters);
+        }
+#endif
+        return validate_headers_scalar(slots, stride, lengths, count, length,
+                                       max_timestamp, timestamps, characters);
+    }
+}
+
+#endif //SIK_UDP_SIMD_H
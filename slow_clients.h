@@ -0,0 +1,230 @@
+#ifndef SIK_UDP_SLOW_CLIENTS_H
+#define SIK_UDP_SLOW_CLIENTS_H
+
+
+#include <ctime>
+#include <cstdint>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "address_map.h"
+
+namespace sik {
+    /// Number of consecutive blocked sends after which a client is slow.
+    const uint32_t SLOW_CLIENT_THRESHOLD = 8u;
+    /// Seconds a slow client is suspended for.
+    const std::time_t SUSPENSION_TIME = 10;
+
+    /**
+     * Action taken when a client becomes slow.
+     */
+    enum class SlowClientAction {
+        /// Keep retrying the client, delaying everyone behind it.
+        NONE,
+        /// Drop the current message for the client.
+        SKIP,
+        /// Send the current message to the client after everyone else.
+        DEFER,
+        /// Drop messages for the client for the suspension time.
+        SUSPEND
+    };
+
+    /**
+     * Configuration of slow client handling.
+     */
+    struct SlowClientPolicy {
+        /// Action taken when a client becomes slow.
+        SlowClientAction action = SlowClientAction::NONE;
+        /// Number of consecutive blocked sends after which a client is slow.
+        uint32_t threshold = SLOW_CLIENT_THRESHOLD;
+        /// Seconds a slow client is suspended for.
+        std::time_t suspension = SUSPENSION_TIME;
+    };
+
+    /**
+     * Delivery statistics of a client which sends were blocked.
+     */
+    struct ClientLag {
+        /// Blocked sends since the last delivery.
+        uint32_t consecutive_blocks = 0u;
+        /// All blocked sends.
+        uint64_t blocks = 0u;
+        /// Messages queued behind the one being sent at the last block.
+        std::size_t outstanding = 0u;
+        /// Longest time between arrival of a message and a blocked send.
+        std::time_t max_lag = 0;
+        /// Times the policy action was taken.
+        uint64_t penalties = 0u;
+        /// Messages dropped for the client by the policy.
+        uint64_t skipped = 0u;
+        /// Messages are dropped for the client until this time.
+        std::time_t suspended_until = 0;
+    };
+
+    /**
+     * Tracks clients which sends block and decides when the slow client
+     * policy applies to them. Sends block for the whole socket, so the
+     * client at the head of the blocked batch is held responsible. Only
+     * clients which blocked are tracked, keeping the common path to a size
+     * check.
+     */
+    class SlowClients {
+    private:
+        /// Slow client handling configuration.
+        SlowClientPolicy policy;
+        /// Statistics of clients which sends blocked.
+        AddressMap<ClientLag> lags;
+        /// No client is suspended after this time.
+        std::time_t suspensions_end = 0;
+        /// Clients removed by prune.
+        std::vector<address_t> removed;
+
+    public:
+        /**
+         * Constructs tracker.
+         * @param policy slow client handling configuration.
+         */
+        explicit SlowClients(SlowClientPolicy policy = SlowClientPolicy())
+                : policy(policy) {}
+
+        /**
+         * Records blocked send to the client.
+         * @param key client address.
+         * @param now current time.
+         * @param lag time since the arrival of the message being sent.
+         * @param outstanding messages queued behind the message being sent.
+         * @return action to take now, NONE until the client is slow.
+         */
+        SlowClientAction block(address_t key, std::time_t now, std::time_t lag,
+                               std::size_t outstanding) {
+            ClientLag &client = *lags.insert(key, ClientLag()).first;
+            client.blocks++;
+            client.outstanding = outstanding;
+            client.max_lag = std::max(client.max_lag, lag);
+            if (policy.action == SlowClientAction::NONE
+                || ++client.consecutive_blocks < policy.threshold) {
+                return SlowClientAction::NONE;
+            }
+            client.consecutive_blocks = 0u;
+            client.penalties++;
+            if (policy.action == SlowClientAction::SUSPEND) {
+                client.suspended_until = now + policy.suspension;
+                suspensions_end = std::max(suspensions_end,
+                                           client.suspended_until);
+            }
+            if (policy.action != SlowClientAction::DEFER) {
+                client.skipped++;
+            }
+            return policy.action;
+        }
+
+        /**
+         * Records delivery to the client.
+         * @param key client address.
+         */
+        void deliver(address_t key) noexcept {
+            if (lags.size() == 0) {
+                return;
+            }
+            ClientLag *client = lags.find(key);
+            if (client != nullptr) {
+                client->consecutive_blocks = 0u;
+            }
+        }
+
+        /**
+         * Records delivery to every client of a sent batch.
+         * @param keys client addresses.
+         * @param count number of clients.
+         */
+        void deliver(const address_t *keys, std::size_t count) noexcept {
+            if (lags.size() == 0) {
+                return;
+            }
+            for (std::size_t i = 0u; i < count; i++) {
+                deliver(keys[i]);
+            }
+        }
+
+        /**
+         * Records message dropped for the client.
+         * @param key client address.
+         */
+        void skip(address_t key) noexcept {
+            ClientLag *client = lags.find(key);
+            if (client != nullptr) {
+                client->skipped++;
+            }
+        }
+
+        /**
+         * @param key client address.
+         * @param now current time.
+         * @return whether messages for the client should be dropped.
+         */
+        bool is_suspended(address_t key, std::time_t now) const noexcept {
+            if (now >= suspensions_end) {
+                return false;
+            }
+            const ClientLag *client = lags.find(key);
+            return client != nullptr && now < client->suspended_until;
+        }
+
+        /**
+         * Forgets clients which are no longer tracked, with their
+         * statistics.
+         * @tparam F predicate type.
+         * @param keep predicate returning whether the client is still
+         * tracked.
+         */
+        template<typename F>
+        void prune(F &&keep) {
+            if (lags.size() == 0) {
+                return;
+            }
+            removed.clear();
+            lags.visit([&](address_t key, const ClientLag &) {
+                if (!keep(key)) {
+                    removed.push_back(key);
+                }
+            });
+            for (address_t key: removed) {
+                lags.erase(key);
+            }
+        }
+
+        /**
+         * @return number of tracked clients.
+         */
+        std::size_t size() const noexcept {
+            return lags.size();
+        }
+
+        /**
+         * @param key client address.
+         * @return statistics of the client or nullptr if it never blocked.
+         */
+        const ClientLag *find(address_t key) const noexcept {
+            return lags.find(key);
+        }
+
+        /**
+         * Calls function for every client which sends blocked.
+         * @param f function called with client address and its statistics.
+         */
+        template<typename F>
+        void visit(F &&f) const {
+            lags.visit(std::forward<F>(f));
+        }
+
+        /**
+         * @return slow client handling configuration.
+         */
+        const SlowClientPolicy &get_policy() const noexcept {
+            return policy;
+        }
+    };
+}
+
+#endif //SIK_UDP_SLOW_CLIENTS_H
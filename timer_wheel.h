@@ -0,0 +1,121 @@
+#ifndef SIK_UDP_TIMER_WHEEL_H
+#define SIK_UDP_TIMER_WHEEL_H
+
+
+#include <ctime>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "address_map.h"
+
+namespace sik {
+    /**
+     * Hashed timer wheel with one second resolution. Timers are kept in
+     * buckets indexed by expiry time modulo wheel size, so scheduling is O(1)
+     * and advancing the wheel visits every timer once per rotation. Timers
+     * are not cancelled, every one carries a tag the owner checks when it
+     * fires, e.g. to tell a timer of a removed client from a timer of a new
+     * client with the same address.
+     * @tparam wheel_size number of buckets (seconds in one rotation).
+     */
+    template<std::size_t wheel_size>
+    class TimerWheel {
+        static_assert(wheel_size > 0, "Wheel size must be greater than 0");
+    private:
+        struct Timer {
+            /// Address of the client timer belongs to.
+            address_t key;
+            /// Tag given when the timer was scheduled.
+            uint64_t tag;
+            /// Time when timer fires.
+            std::time_t expiry;
+        };
+
+        /// Timers grouped by expiry time modulo wheel size.
+        std::vector<Timer> buckets[wheel_size];
+        /// Timers of the bucket being processed.
+        std::vector<Timer> firing;
+        /// All timers with expiry up to this time have fired.
+        std::time_t current;
+        /// Number of scheduled timers.
+        std::size_t length = 0u;
+
+        /**
+         * @param time time point.
+         * @return bucket of timers expiring at the time point.
+         */
+        std::vector<Timer> &bucket(std::time_t time) noexcept {
+            return buckets[(std::size_t) time % wheel_size];
+        }
+
+    public:
+        /**
+         * Constructs empty wheel.
+         * @param now all timers expiring up to this time fire on next advance.
+         */
+        explicit TimerWheel(std::time_t now = 0) noexcept : current(now) {}
+
+        /**
+         * Schedules timer. Timers already expired fire on next advance.
+         * @param key address of the client timer belongs to.
+         * @param expiry time when timer fires.
+         * @param tag value passed back when the timer fires.
+         */
+        void schedule(address_t key, std::time_t expiry, uint64_t tag = 0u) {
+            if (expiry <= current) {
+                expiry = current + 1;
+            }
+            bucket(expiry).push_back(Timer{key, tag, expiry});
+            length++;
+        }
+
+        /**
+         * Fires all timers expiring up to given time. The callback may
+         * schedule new timers.
+         * @param now time point.
+         * @param on_expire function called with the key and the tag of every
+         * fired timer.
+         */
+        template<typename F>
+        void advance(std::time_t now, F &&on_expire) {
+            if (now <= current) {
+                return;
+            }
+            // Bucket for every second is visited at most once, later timers
+            // sharing the bucket wait for the next rotation.
+            std::time_t steps = now - current;
+            if (steps > (std::time_t) wheel_size) {
+                steps = wheel_size;
+            }
+            std::time_t from = current;
+            current = now;
+            for (std::time_t step = 1; step <= steps; step++) {
+                firing.clear();
+                if (firing.capacity() > length) {
+                    // Storage is handed over to the swapped bucket, do not
+                    // let a burst of timers keep it allocated forever.
+                    std::vector<Timer>().swap(firing);
+                }
+                std::swap(firing, bucket(from + step));
+                for (const Timer &timer: firing) {
+                    if (timer.expiry <= now) {
+                        length--;
+                        on_expire(timer.key, timer.tag);
+                    } else {
+                        bucket(timer.expiry).push_back(timer);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @return number of scheduled timers.
+         */
+        std::size_t size() const noexcept {
+            return length;
+        }
+    };
+}
+
+#endif //SIK_UDP_TIMER_WHEEL_H
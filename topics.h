@@ -0,0 +1,102 @@
+#ifndef SIK_UDP_TOPICS_H
+#define SIK_UDP_TOPICS_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "client_store.h"
+
+namespace sik {
+    /// Number of topics, one for every value of the message character.
+    const std::size_t TOPIC_COUNT = 256u;
+    /// Position of a slot which is not subscribed to any topic.
+    const ClientStore::slot_t NOT_SUBSCRIBED = ~(ClientStore::slot_t) 0;
+
+    /**
+     * Index of clients subscribed to every topic. A client is subscribed to
+     * the character of the last datagram it registered with. Subscribers of
+     * a topic are kept in a dense list of client slots, so listing them costs
+     * O(subscribers) and subscribing or unsubscribing costs O(1).
+     */
+    class TopicIndex {
+    public:
+        using slot_t = ClientStore::slot_t;
+
+    private:
+        /// Subscribed slots of every topic, in no particular order.
+        std::vector<slot_t> subscribers[TOPIC_COUNT];
+        /// Topic of every subscribed slot.
+        std::vector<uint8_t> topics;
+        /// Position of every slot in the list of its topic subscribers.
+        std::vector<slot_t> positions;
+
+    public:
+        /**
+         * Subscribes client to the topic, unsubscribing it from the previous
+         * one.
+         * @param slot client slot.
+         * @param topic message character.
+         */
+        void subscribe(slot_t slot, char topic) {
+            if (slot >= positions.size()) {
+                positions.resize((std::size_t) slot + 1u, NOT_SUBSCRIBED);
+                topics.resize((std::size_t) slot + 1u);
+            }
+            uint8_t index = (uint8_t) topic;
+            if (positions[slot] != NOT_SUBSCRIBED) {
+                if (topics[slot] == index) {
+                    return;
+                }
+                unsubscribe(slot);
+            }
+            topics[slot] = index;
+            positions[slot] = (slot_t) subscribers[index].size();
+            subscribers[index].push_back(slot);
+        }
+
+        /**
+         * Removes client subscription, if any.
+         * @param slot client slot.
+         */
+        void unsubscribe(slot_t slot) noexcept {
+            if (slot >= positions.size() || positions[slot] == NOT_SUBSCRIBED) {
+                return;
+            }
+            std::vector<slot_t> &list = subscribers[topics[slot]];
+            // Move the last subscriber into the freed position.
+            slot_t last = list.back();
+            list[positions[slot]] = last;
+            positions[last] = positions[slot];
+            list.pop_back();
+            positions[slot] = NOT_SUBSCRIBED;
+        }
+
+        /**
+         * @param slot client slot.
+         * @return whether client is subscribed to any topic.
+         */
+        bool is_subscribed(slot_t slot) const noexcept {
+            return slot < positions.size() && positions[slot] != NOT_SUBSCRIBED;
+        }
+
+        /**
+         * @param slot subscribed client slot.
+         * @return topic of the client.
+         */
+        char topic(slot_t slot) const noexcept {
+            return (char) topics[slot];
+        }
+
+        /**
+         * @param topic message character.
+         * @return slots of clients subscribed to the topic.
+         */
+        const std::vector<slot_t> &get_subscribers(char topic) const noexcept {
+            return subscribers[(uint8_t) topic];
+        }
+    };
+}
+
+#endif //SIK_UDP_TOPICS_H
@@ -0,0 +1,182 @@
+#ifndef SIK_UDP_WIRE_H
+#define SIK_UDP_WIRE_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <endian.h>
+
+namespace sik {
+    /**
+     * Conversion of a field between host and network byte order.
+     * @tparam T field type, an integer of 1, 2, 4 or 8 bytes.
+     * @tparam size size of the field.
+     */
+    template<typename T, std::size_t size = sizeof(T)>
+    struct ByteOrder;
+
+    template<typename T>
+    struct ByteOrder<T, 1u> {
+        static T to_network(T value) noexcept {
+            return value;
+        }
+
+        static T to_host(T value) noexcept {
+            return value;
+        }
+    };
+
+    template<typename T>
+    struct ByteOrder<T, 2u> {
+        static T to_network(T value) noexcept {
+            return (T) htobe16((uint16_t) value);
+        }
+
+        static T to_host(T value) noexcept {
+            return (T) be16toh((uint16_t) value);
+        }
+    };
+
+    template<typename T>
+    struct ByteOrder<T, 4u> {
+        static T to_network(T value) noexcept {
+            return (T) htobe32((uint32_t) value);
+        }
+
+        static T to_host(T value) noexcept {
+            return (T) be32toh((uint32_t) value);
+        }
+    };
+
+    template<typename T>
+    struct ByteOrder<T, 8u> {
+        static T to_network(T value) noexcept {
+            return (T) htobe64((uint64_t) value);
+        }
+
+        static T to_host(T value) noexcept {
+            return (T) be64toh((uint64_t) value);
+        }
+    };
+
+    /**
+     * @tparam Ts types.
+     * @param count number of leading types.
+     * @return sum of sizes of the first count types.
+     */
+    template<typename... Ts>
+    constexpr std::size_t packed_offset(std::size_t count) noexcept {
+        const std::size_t sizes[] = {sizeof(Ts)...};
+        std::size_t offset = 0u;
+        for (std::size_t i = 0u; i < count; i++) {
+            offset += sizes[i];
+        }
+        return offset;
+    }
+
+    /**
+     * Wire layout of packed fields in network byte order, described by their
+     * types. Offsets are computed at compile time, so reading or writing a
+     * field is a single unaligned copy and a byte swap. Adding a field
+     * changes offsets of the ones after it without any runtime branching.
+     * @tparam Ts field types, integers of 1, 2, 4 or 8 bytes.
+     */
+    template<typename... Ts>
+    class WireSchema {
+        static_assert(sizeof...(Ts) > 0u, "Schema must have fields");
+
+    public:
+        /// Field values.
+        using Values = std::tuple<Ts...>;
+
+        /// Type of the field at index.
+        template<std::size_t index>
+        using Field = typename std::tuple_element<index, Values>::type;
+
+        /// Number of bytes taken by all fields.
+        static constexpr std::size_t size
+                = packed_offset<Ts...>(sizeof...(Ts));
+
+        /**
+         * @tparam index field index.
+         * @return offset of the field.
+         */
+        template<std::size_t index>
+        static constexpr std::size_t offset() noexcept {
+            static_assert(index < sizeof...(Ts), "Field index out of range");
+            return packed_offset<Ts...>(index);
+        }
+
+        /**
+         * Reads field.
+         * @tparam index field index.
+         * @param bytes encoded fields, may be unaligned.
+         * @return field value.
+         */
+        template<std::size_t index>
+        static Field<index> get(const char *bytes) noexcept {
+            static_assert(std::is_integral<Field<index>>::value,
+                          "Fields must be integers");
+            Field<index> value;
+            std::memcpy(&value, bytes + offset<index>(), sizeof(value));
+            return ByteOrder<Field<index>>::to_host(value);
+        }
+
+        /**
+         * Writes field.
+         * @tparam index field index.
+         * @param bytes encoded fields, may be unaligned.
+         * @param value field value.
+         */
+        template<std::size_t index>
+        static void set(char *bytes, Field<index> value) noexcept {
+            static_assert(std::is_integral<Field<index>>::value,
+                          "Fields must be integers");
+            value = ByteOrder<Field<index>>::to_network(value);
+            std::memcpy(bytes + offset<index>(), &value, sizeof(value));
+        }
+
+        /**
+         * Writes all fields.
+         * @param bytes output of at least size bytes.
+         * @param values field values in order.
+         */
+        static void encode(char *bytes, Ts... values) noexcept {
+            encode_from<0u>(bytes, values...);
+        }
+
+        /**
+         * Reads all fields.
+         * @param bytes at least size bytes of encoded fields.
+         * @return field values in order.
+         */
+        static Values decode(const char *bytes) noexcept {
+            return decode_indices(bytes,
+                                  std::index_sequence_for<Ts...>());
+        }
+
+    private:
+        template<std::size_t index>
+        static void encode_from(char *) noexcept {}
+
+        template<std::size_t index, typename U, typename... Us>
+        static void encode_from(char *bytes, U value, Us... values) noexcept {
+            set<index>(bytes, value);
+            encode_from<index + 1u>(bytes, values...);
+        }
+
+        template<std::size_t... indices>
+        static Values decode_indices(const char *bytes,
+                                     std::index_sequence<indices...>) noexcept {
+            return Values(get<indices>(bytes)...);
+        }
+    };
+
+    template<typename... Ts>
+    constexpr std::size_t WireSchema<Ts...>::size;
+}
+
+#endif //SIK_UDP_WIRE_H